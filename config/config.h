@@ -28,6 +28,7 @@
 #endif
 
 #cmakedefine SMIP_COMPILING
+#cmakedefine SMIP_FFTW_THREADS
 
 #ifdef SMIP_COMPILING
 #define SMIP_PUBLIC EXPORT
@@ -64,6 +64,8 @@ public:
     Array2(std::size_t xsize, std::size_t ysize, const T& init);
     Array2(const extents& a_extends);
     Array2(const extents& a_extends, const T& init);
+    // Construct on externally allocated storage of at least xsize*ysize elements
+    Array2(std::size_t xsize, std::size_t ysize, std::shared_ptr<T[]> data);
     Array2(std::initializer_list<std::initializer_list<T>> l);
     ~Array2() = default;
 
@@ -129,7 +131,7 @@ public:
     std::vector<T> get_row(std::size_t row) const;
     Array2<T> get_subarray(const Rect<std::size_t>& rect);
     void shift(const DimVector<int, 2>& distance);
-    Array2<T> shifted(const DimVector<int, 2>& distance);
+    Array2<T> shifted(const DimVector<int, 2>& distance) const;
 
     std::size_t xsize() const { return m_xsize; }
     std::size_t ysize() const { return m_ysize; }
@@ -225,6 +227,14 @@ Array2<T>::Array2(std::size_t xsize, std::size_t ysize, const T& init)
 {
 }
 
+template <typename T>
+Array2<T>::Array2(std::size_t xsize, std::size_t ysize, std::shared_ptr<T[]> data)
+    : m_xsize(xsize)
+    , m_ysize(ysize)
+{
+    this->set_at(std::move(data), xsize * ysize);
+}
+
 template <typename T>
 Array2<T>::Array2(const extents& a_extends)
     : Array_base<T>(a_extends.product())
@@ -601,7 +611,7 @@ void Array2<T>::shift(const DimVector<int, 2>& distance)
 }
 
 template <typename T>
-Array2<T> Array2<T>::shifted(const DimVector<int, 2>& distance)
+Array2<T> Array2<T>::shifted(const DimVector<int, 2>& distance) const
 {
     Array2<T> shifted_arr(m_xsize, m_ysize, T {});
     Point<int> startpos {
@@ -5,6 +5,7 @@
 #include <cassert>
 #include <complex>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <errno.h>
 #include <fstream>
@@ -17,11 +18,20 @@
 #include <vector>
 
 #include "array2.h"
+#include "frame_spectrum.h"
 #include "types.h"
 #include "utility.h"
 
 namespace smip {
 
+/*! canonical storage location of a bispectrum element: address offset and whether the stored value has to be
+ * conjugated, packed into 64 bits for compact lists of precomputed locations
+ */
+struct BispectrumLocation {
+    std::uint64_t offset : 63 {};
+    std::uint64_t conjugate : 1 {};
+};
+
 //! 4-dim Container for handling a complex Bispectrum
 /*! ...
  */
@@ -39,10 +49,15 @@ public:
     struct ElementOutOfBounds : std::runtime_error {
         using std::runtime_error::runtime_error;
     };
+    using ElementLocation = BispectrumLocation;
 
     Bispectrum();
     /*! Creates Bispectrum with sizes [<i>i,j,k,l</i>] */
     Bispectrum(const extents& dimsizes);
+    /*! Creates Bispectrum with sizes [<i>i,j,k,l</i>] operating on the externally allocated storage \e data
+     * the storage must hold at least base_size(dimsizes) elements and is not initialized
+     */
+    Bispectrum(const extents& dimsizes, std::shared_ptr<T[]> data);
     Bispectrum(const Bispectrum& other);
     Bispectrum(Bispectrum&& other) noexcept = default;
     Bispectrum& operator=(Bispectrum&& other) noexcept = default;
@@ -60,9 +75,27 @@ public:
     void read_from_file(const std::string& filename);
     /*! returns element with indices [<i>i,j,k,l</i>] */
     [[nodiscard]] T get_element(s_indices indices) const;
+    /*! returns the storage location of the element with indices [<i>i,j,k,l</i>] after applying the symmetries
+     * of the bispectrum, throws std::out_of_range for indices outside of the bispectrum
+     */
+    [[nodiscard]] ElementLocation locate_element(s_indices indices) const;
+    /*! {@link #locate_element(s_indices) locate_element} without exceptions,
+     * returns no location for indices outside of the bispectrum
+     */
+    [[nodiscard]] std::optional<ElementLocation> find_element(s_indices indices) const noexcept;
+    /*! returns element at a storage location obtained from {@link #locate_element(s_indices) locate_element} */
+    [[nodiscard]] T element_at(const ElementLocation& location) const noexcept
+    {
+        return location.conjugate ? std::conj(data_at(location.offset)) : data_at(location.offset);
+    }
     T operator()(s_indices indices) const { return get_element(indices); }
     //T& operator()(s_indices indices);
     void get_elements(const std::vector<s_indices>& idx_list, std::vector<T>& results) const;
+    /*! writes the elements at the \e count precomputed \e locations to \e results
+     * no bounds checks are performed, the locations must be obtained from {@link #locate_element(s_indices) locate_element}
+     * for a bispectrum of the same extents
+     */
+    void gather(const ElementLocation* locations, std::size_t count, T* results) const noexcept;
     /*! write element \e value to position with indices [<i>i,j,k,l</i>] */
     void put_element(s_indices indices, const T& value);
     /*! overloaded = operator */
@@ -81,12 +114,26 @@ public:
     [[nodiscard]] std::size_t calc_offset(s_indices indices) const noexcept;
     template <concept_complex U>
     void accumulate_from_fft(const Array2<U>& fft);
+    /*! accumulates the triple products of the compact frame spectrum \e spectrum
+     * the spectrum must cover the frequency range of the first two dimensions of the bispectrum
+     */
+    template <concept_complex U>
+    void accumulate_from_fft(const FrameSpectrum<U>& spectrum);
+    /*! removes the triple products of a previously accumulated \e fft again */
+    template <concept_complex U>
+    void subtract_from_fft(const Array2<U>& fft);
+    template <concept_complex U>
+    void subtract_from_fft(const FrameSpectrum<U>& spectrum);
 
     [[nodiscard]] std::size_t size() const noexcept { return m_descriptor.base_size; }
+    /*! sizes [<i>i,j,k,l</i>] the Bispectrum was created with */
+    [[nodiscard]] extents dimsizes() const noexcept { return m_dimsizes; }
     [[nodiscard]] extents sizes() const noexcept { return m_descriptor.sizes; }
     [[nodiscard]] extents base_sizes() const noexcept { return m_descriptor.base_sizes; }
     [[nodiscard]] std::size_t base_size() const noexcept { return m_descriptor.base_size; }
     [[nodiscard]] std::size_t totalsize() const noexcept { return m_descriptor.totalsize; }
+    /*! number of stored elements of a Bispectrum with sizes \e dimsizes */
+    [[nodiscard]] static std::size_t base_size(const extents& dimsizes) { return compute_descriptor(dimsizes).base_size; }
     [[nodiscard]] s_indices min_indices() const noexcept { return m_descriptor.min_indices; }
     [[nodiscard]] s_indices max_indices() const noexcept { return m_descriptor.max_indices; }
 
@@ -114,7 +161,21 @@ private:
     [[nodiscard]] static extents base_sizes(extents dimsizes) noexcept;
     [[nodiscard]] static constexpr SymmetryCase classify_indices(const s_indices& indices) noexcept;
     [[nodiscard]] static s_indices canonicalize_indices(s_indices indices, bool& conjugate) noexcept;
-    [[nodiscard]] static std::size_t calc_offset(array_descriptor_t descriptor, s_indices indices) noexcept;
+    /*! true if the element with the storage indices \e uv lies within the stored half of the index ranges */
+    [[nodiscard]] bool is_stored(const s_indices& uv) const noexcept;
+    /*! true if the triple products of the element with the storage indices \e uv are accumulated
+     * from frame spectra, see combine_triple_products()
+     */
+    [[nodiscard]] bool is_accumulated(const s_indices& uv) const noexcept;
+    /*! searches the permutations and negations of the frequencies u, v and -(u+v) of \e indices for
+     * an accumulated equivalent element, returned in \e uv together with its \e conjugate flag
+     */
+    [[nodiscard]] bool find_accumulated_equivalent(const s_indices& indices, s_indices& uv, bool& conjugate) const noexcept;
+    [[nodiscard]] static std::size_t calc_offset(const array_descriptor_t& descriptor, s_indices indices) noexcept;
+    template <concept_complex U, typename BinaryOp>
+    void combine_triple_products(const Array2<U>& fft, BinaryOp op);
+    template <concept_complex U, typename BinaryOp>
+    void combine_triple_products(const FrameSpectrum<U>& spectrum, BinaryOp op);
     T& data_at(std::size_t offset) noexcept;
     const T& data_at(std::size_t offset) const noexcept;
     /*! returns address offset of element with indices [<i>i,j,k,l</i>] */
@@ -191,6 +252,14 @@ Bispectrum<T>::Bispectrum(const Bispectrum<T>::extents& dimsizes)
     std::fill_n(Array_base<T>::data().get(), base_size(), T {});
 }
 
+template <concept_complex T>
+Bispectrum<T>::Bispectrum(const Bispectrum<T>::extents& dimsizes, std::shared_ptr<T[]> data)
+    : m_dimsizes { dimsizes }
+    , m_descriptor { compute_descriptor(dimsizes) }
+{
+    this->set_at(std::move(data), base_size());
+}
+
 template <concept_complex T>
 Bispectrum<T>::Bispectrum(const Bispectrum<T>& other)
     : Array_base<T>(other.base_size())
@@ -322,7 +391,7 @@ std::size_t Bispectrum<T>::calc_offset(s_indices indices) const noexcept
 }
 
 template <concept_complex T>
-std::size_t Bispectrum<T>::calc_offset(Bispectrum<T>::array_descriptor_t descriptor, s_indices indices) noexcept
+std::size_t Bispectrum<T>::calc_offset(const Bispectrum<T>::array_descriptor_t& descriptor, s_indices indices) noexcept
 {
     indices *= { -1, 1, -1, 1 };
     // add dimension size to the index in case the index is negative
@@ -356,6 +425,34 @@ std::size_t Bispectrum<T>::calc_offset(Bispectrum<T>::array_descriptor_t descrip
 template <concept_complex T>
 template <concept_complex U>
 void Bispectrum<T>::accumulate_from_fft(const Array2<U>& fft)
+{
+    combine_triple_products(fft, std::plus<T>());
+}
+
+template <concept_complex T>
+template <concept_complex U>
+void Bispectrum<T>::accumulate_from_fft(const FrameSpectrum<U>& spectrum)
+{
+    combine_triple_products(spectrum, std::plus<T>());
+}
+
+template <concept_complex T>
+template <concept_complex U>
+void Bispectrum<T>::subtract_from_fft(const Array2<U>& fft)
+{
+    combine_triple_products(fft, std::minus<T>());
+}
+
+template <concept_complex T>
+template <concept_complex U>
+void Bispectrum<T>::subtract_from_fft(const FrameSpectrum<U>& spectrum)
+{
+    combine_triple_products(spectrum, std::minus<T>());
+}
+
+template <concept_complex T>
+template <concept_complex U, typename BinaryOp>
+void Bispectrum<T>::combine_triple_products(const Array2<U>& fft, BinaryOp op)
 {
     /** The following code block represents a modern C++ range-based loop
      * over the possible range of indices of the 4d bispectrum
@@ -400,7 +497,8 @@ void Bispectrum<T>::accumulate_from_fft(const Array2<U>& fft)
                         t *= fft.at({ k, l });
                         t *= std::conj(fft.at({ i + k, j + l }));
                         //cout<<"Indices="<<i<<";"<<j<<";"<<k<<";"<<l<<endl;
-                        this->data_at(calc_offset({ i, j, k, l })) += t;
+                        T& element { this->data_at(calc_offset({ i, j, k, l })) };
+                        element = op(element, t);
                     }
                 }
             }
@@ -408,6 +506,51 @@ void Bispectrum<T>::accumulate_from_fft(const Array2<U>& fft)
     }
 }
 
+template <concept_complex T>
+template <concept_complex U, typename BinaryOp>
+void Bispectrum<T>::combine_triple_products(const FrameSpectrum<U>& spectrum, BinaryOp op)
+{
+    /** Same index ranges as for the Array2 version above. The bounds checks of u+v are hoisted
+     * out of the innermost loop, which then runs over contiguous columns of the spectrum
+     * and, split at l=0, over contiguous elements of the bispectrum
+     */
+    const int min1 = std::max(spectrum.min_sindices()[0], min_indices()[0]);
+    const int min2 = std::max(spectrum.min_sindices()[1], min_indices()[1]);
+    const int min3 = std::max(spectrum.min_sindices()[0], min_indices()[2]);
+    const int min4 = std::max(spectrum.min_sindices()[1], min_indices()[3]);
+    const int max2 = std::min(spectrum.max_sindices()[1], max_indices()[1]);
+    const int max4 = std::min(spectrum.max_sindices()[1], max_indices()[3]);
+    const auto l_wrap { static_cast<std::ptrdiff_t>(m_descriptor.sizes[3]) };
+    T* data { Array_base<T>::data().get() };
+
+    for (int i = min1; i <= 0; i++) {
+        for (int j = min2; j <= max2; j++) {
+            const U u { spectrum.at({ i, j }) };
+            // v=(k,l) and w=u+v must both lie within [min1..max1] x [min2..max2]
+            const int lmin = std::max(min4, min2 - j);
+            const int lmax = std::min(max4, max2 - j);
+            for (int k = std::max(min3, min1 - i); k <= 0; k++) {
+                const U* v_col { spectrum.column(k) };
+                const U* w_col { spectrum.column(i + k) + j };
+                T* element { data + calc_offset({ i, j, k, 0 }) };
+                // negative l are stored at the end of the innermost dimension
+                for (int l = lmin; l <= std::min(lmax, -1); l++) {
+                    T t { u };
+                    t *= v_col[l];
+                    t *= std::conj(w_col[l]);
+                    element[l + l_wrap] = op(element[l + l_wrap], t);
+                }
+                for (int l = std::max(lmin, 0); l <= lmax; l++) {
+                    T t { u };
+                    t *= v_col[l];
+                    t *= std::conj(w_col[l]);
+                    element[l] = op(element[l], t);
+                }
+            }
+        }
+    }
+}
+
 template <concept_complex T>
 void Bispectrum<T>::write_to_file(const std::string& filename) const
 {
@@ -482,14 +625,33 @@ void Bispectrum<T>::print() const
 template <concept_complex T>
 T Bispectrum<T>::get_element(s_indices indices) const
 {
-    const s_indices max_idx = max_indices(); // cache once
+    return element_at(locate_element(std::move(indices)));
+}
+
+template <concept_complex T>
+typename Bispectrum<T>::ElementLocation Bispectrum<T>::locate_element(s_indices indices) const
+{
+    const std::optional<ElementLocation> location { find_element(indices) };
+    if (!location) [[unlikely]] {
+        throw std::out_of_range(build_error_message("Bispectrum: element not covered by the bispectrum", indices));
+    }
+    return *location;
+}
+
+template <concept_complex T>
+std::optional<typename Bispectrum<T>::ElementLocation> Bispectrum<T>::find_element(s_indices indices) const noexcept
+{
+    const s_indices& min_idx = m_descriptor.min_indices;
+    const s_indices& max_idx = m_descriptor.max_indices;
 
     if ((std::abs(indices[2]) > max_idx[2]) || (std::abs(indices[3]) > max_idx[3])) [[unlikely]] {
         std::swap(indices[0], indices[2]);
         std::swap(indices[1], indices[3]);
     }
-    if (!(this->range().contains(indices))) {
-        throw std::out_of_range(build_error_message("Bispectrum: Initial element access bounds check failed", indices));
+    for (std::size_t dim { 0 }; dim < 4; ++dim) {
+        if (indices[dim] < min_idx[dim] || indices[dim] > max_idx[dim]) {
+            return std::nullopt;
+        }
     }
 
     bool conjugate { false };
@@ -499,26 +661,50 @@ T Bispectrum<T>::get_element(s_indices indices) const
         std::swap(uv[0], uv[2]);
         std::swap(uv[1], uv[3]);
     }
+    // the canonical form may leave the stored index ranges, in which case its address would alias
+    // a different element. Fall back to any accumulated symmetric equivalent then
+    if (!is_stored(uv) && !find_accumulated_equivalent(indices, uv, conjugate)) [[unlikely]] {
+        return std::nullopt;
+    }
 
-    std::size_t addr = calc_offset(uv);
-
+    const std::size_t addr { calc_offset(uv) };
     if (addr >= this->base_size()) [[unlikely]] {
-        throw std::out_of_range(build_error_message("Bispectrum: element address out of bounds.", indices));
+        return std::nullopt;
     }
-
-    if (conjugate) [[likely]]
-        return std::conj(data_at(addr));
-    return data_at(addr);
+    return ElementLocation { addr, conjugate };
 }
 
 template <concept_complex T>
 void Bispectrum<T>::get_elements(const std::vector<s_indices>& idx_list, std::vector<T>& results) const
 {
-    results.clear();
-    results.reserve(idx_list.size());
-
+    std::vector<ElementLocation> locations {};
+    locations.reserve(idx_list.size());
     for (const auto& idx : idx_list) {
-        results.push_back(get_element(idx));
+        locations.push_back(locate_element(idx));
+    }
+    results.resize(locations.size());
+    gather(locations.data(), locations.size(), results.data());
+}
+
+template <concept_complex T>
+void Bispectrum<T>::gather(const ElementLocation* locations, std::size_t count, T* results) const noexcept
+{
+    // the locations are scattered over the whole storage, fetch the cache lines a few elements ahead
+    constexpr std::size_t c_prefetch_distance { 16 };
+    const T* const data { Array_base<T>::data().get() };
+    for (std::size_t i { 0 }; i < count; ++i) {
+#if defined(__GNUC__) || defined(__clang__)
+        if (i + c_prefetch_distance < count) {
+            __builtin_prefetch(data + locations[i + c_prefetch_distance].offset);
+        }
+#endif
+        results[i] = data[locations[i].offset];
+    }
+    // conjugation as branchless sign flip of the imaginary parts, vectorizable by the compiler
+    using value_type = typename T::value_type;
+    for (std::size_t i { 0 }; i < count; ++i) {
+        const value_type sign { static_cast<value_type>(1) - static_cast<value_type>(2 * locations[i].conjugate) };
+        results[i] = T { results[i].real(), results[i].imag() * sign };
     }
 }
 
@@ -588,6 +774,58 @@ typename Bispectrum<T>::s_indices Bispectrum<T>::canonicalize_indices(s_indices
     std::unreachable();
 }
 
+template <concept_complex T>
+bool Bispectrum<T>::is_stored(const s_indices& uv) const noexcept
+{
+    const s_indices& min_idx = m_descriptor.min_indices;
+    const s_indices& max_idx = m_descriptor.max_indices;
+    for (std::size_t dim { 0 }; dim < 4; ++dim) {
+        if (uv[dim] < min_idx[dim] || uv[dim] > max_idx[dim]) {
+            return false;
+        }
+    }
+    return uv[0] <= 0 && uv[2] <= 0;
+}
+
+template <concept_complex T>
+bool Bispectrum<T>::is_accumulated(const s_indices& uv) const noexcept
+{
+    if (!is_stored(uv)) {
+        return false;
+    }
+    // the frame spectra cover [-n/2, n-n/2-1], the positive nyquist frequency of an even size is never accumulated
+    const int max_y { static_cast<int>(m_dimsizes[1] - m_dimsizes[1] / 2) - 1 };
+    const s_indices& min_idx = m_descriptor.min_indices;
+    return uv[1] <= max_y && uv[3] <= max_y
+        && (uv[0] + uv[2]) >= min_idx[0]
+        && (uv[1] + uv[3]) >= min_idx[1] && (uv[1] + uv[3]) <= max_y;
+}
+
+template <concept_complex T>
+bool Bispectrum<T>::find_accumulated_equivalent(const s_indices& indices, s_indices& uv, bool& conjugate) const noexcept
+{
+    const std::array<std::array<int, 2>, 3> frequencies { { { indices[0], indices[1] },
+        { indices[2], indices[3] },
+        { -indices[0] - indices[2], -indices[1] - indices[3] } } };
+    for (const bool negate : { false, true }) {
+        const int sign { negate ? -1 : 1 };
+        for (std::size_t a { 0 }; a < 3; ++a) {
+            for (std::size_t b { 0 }; b < 3; ++b) {
+                if (a == b) {
+                    continue;
+                }
+                const s_indices candidate { sign * frequencies[a][0], sign * frequencies[a][1], sign * frequencies[b][0], sign * frequencies[b][1] };
+                if (is_accumulated(candidate)) {
+                    uv = candidate;
+                    conjugate = negate;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
 template <concept_complex T>
 std::string Bispectrum<T>::build_error_message(const std::string& prefix, const s_indices& indices) const
 {
@@ -2,12 +2,18 @@
 
 #include "array2.h"
 #include "dimvector.h"
+#include "fft_plans.h"
+#include "frame_spectrum.h"
+#include "types.h"
+#include "constants.h"
 #include <algorithm>
 #include <cmath>
+#include <complex>
 #include <concepts>
-#include <fftw3.h>
+#include <limits>
 #include <stdexcept>
 #include <type_traits>
+#include <vector>
 
 namespace smip {
 
@@ -35,6 +41,21 @@ class Array2;
  * static {@link #get_displacement(const Array2<T>&, const Array2<T>&)} function. 
  * The latter can be called without object and therefore needs to be supplied with the reference frame 
  * as the first argument.
+ * If the fft of the frame is already at hand as FrameSpectrum, it can be passed instead of the frame
+ * in order to save its forward transform. Frequencies beyond the region of the FrameSpectrum are treated as zero.
+ * The transforms are computed in the precision of T, i.e. by the single precision fftw for float frames and
+ * in double precision for all other types (see fft_real_t), and so are the correlation array and the internal
+ * spectra, which thus take half the memory for float frames.
+ * The conjugated spectrum of the reference frame is computed once on construction. The fft plans of the
+ * FftPlanRegistry and the workspace (allocated by fft_buffer(), i.e. aligned for the SIMD code of fftw) are
+ * kept for the lifetime of the object, so that a correlation performs no planning and no heap allocation.
+ * For the same reason objects of this class can not be copied. Objects may be constructed and used
+ * concurrently in different threads.
+ * With an upsampling factor set by {@link #set_upsampling(std::size_t)}, the displacement is additionally
+ * available with a precision of 1/factor pixel through {@link #get_subpixel_displacement()}. The correlation
+ * is then evaluated on a grid upsampled by the factor around the integer maximum by a matrix-multiply DFT of the
+ * kept cross spectrum (Guizar-Sicairos et al., Opt. Lett. 33, 156 (2008)), which costs a fraction of an fft
+ * of the upsampled size.
  * @note: Calling {@link #get_correlation_array()} or {@link #get_displacement()} without a previous
  * call to {@link #correlate(const Array2<T>&)} or {@link #operator()(const Array2<T>&) operator()} 
  * in order to provide the second argument required for the computation of the cross correlation
@@ -44,13 +65,29 @@ template <typename T>
 requires std::floating_point<T>
 class CrossCorrelation {
 public:
+    /*! real type of the transforms and the correlation array */
+    using real_type = fft_real_t<T>;
+    using complex_type = std::complex<real_type>;
+
     CrossCorrelation() = delete;
     CrossCorrelation(const Array2<T>& ref);
+    CrossCorrelation(const CrossCorrelation&) = delete;
+    CrossCorrelation& operator=(const CrossCorrelation&) = delete;
+    ~CrossCorrelation() = default;
     void correlate(const Array2<T>& frame);
-    auto get_correlation_array() -> const Array2<T>&;
+    template <concept_complex U>
+    void correlate(const FrameSpectrum<U>& spectrum);
+    auto get_correlation_array() -> const Array2<real_type>&;
     auto get_displacement() -> DimVector<int, 2>;
+    /*! displacement with a precision of 1/upsampling pixel, the integer displacement without upsampling */
+    auto get_subpixel_displacement() -> DimVector<double, 2>;
+    /*! enables the subpixel registration with a precision of 1/\e factor pixel, 0 or 1 disables it */
+    void set_upsampling(std::size_t factor);
+    [[nodiscard]] std::size_t upsampling() const noexcept { return m_upsampling; }
 
     auto operator()(const Array2<T>& frame) -> DimVector<int, 2>;
+    template <concept_complex U>
+    auto operator()(const FrameSpectrum<U>& spectrum) -> DimVector<int, 2>;
     static auto get_displacement(const Array2<T>& a, const Array2<T>& b) -> DimVector<int, 2>
     {
         CrossCorrelation<T> correl(a);
@@ -62,15 +99,34 @@ private:
     enum class readiness : std::uint8_t {
         none    = 0x00,
         correl  = 0x01,
-        shift   = 0x02
+        shift   = 0x02,
+        subpixel = 0x03
     } m_readiness { readiness::none };
     // clang-format on
 
     void calculate_displacement();
+    void refine_displacement();
+    void forward_transform();
+    void back_transform();
 
-    Array2<double> m_refframe;
-    Array2<double> m_correlation;
+    /*! input of the forward transform */
+    Array2<real_type> m_frame;
+    /*! conjugated half-plane spectrum of the reference frame */
+    Array2<complex_type> m_ref_spectrum;
+    /*! half-plane cross spectrum, overwritten by the back transform */
+    Array2<complex_type> m_cross_spectrum;
+    Array2<real_type> m_correlation;
+    /*! copy of the cross spectrum for the subpixel registration, empty without upsampling */
+    Array2<complex_type> m_cross_power {};
+    /*! DFT kernels along x and y and partial sums over x of the subpixel registration, sized by set_upsampling() */
+    std::vector<std::complex<double>> m_x_kernel {};
+    std::vector<std::complex<double>> m_y_kernel {};
+    std::vector<std::complex<double>> m_partial {};
+    FftExecutor<real_type> m_forward_plan {};
+    FftExecutor<real_type> m_backward_plan {};
     DimVector<int, 2> m_shift {};
+    DimVector<double, 2> m_subpixel_shift {};
+    std::size_t m_upsampling { 0 };
 };
 
 //********************
@@ -89,62 +145,87 @@ CrossCorrelation(const Array2<T>& ref)
 template <typename T>
 requires std::floating_point<T>
 CrossCorrelation<T>::CrossCorrelation(const Array2<T>& ref)
-    : m_refframe(ref)
+    : m_frame(ref.ncols(), ref.nrows(), fft_buffer<real_type, real_type>(ref.size()))
+    , m_ref_spectrum(ref.ncols() / 2 + 1, ref.nrows())
+    , m_cross_spectrum(ref.ncols() / 2 + 1, ref.nrows(), fft_buffer<complex_type, real_type>((ref.ncols() / 2 + 1) * ref.nrows()))
+    , m_correlation(ref.ncols(), ref.nrows(), fft_buffer<real_type, real_type>(ref.size()))
+{
+    // set up real-to-complex DFT
+    // ref: https://www.fftw.org/fftw3_doc/Real_002ddata-DFTs.html#Real_002ddata-DFTs
+    // see definition of FFTW3's real-data DFT data format:
+    // https://www.fftw.org/fftw3_doc/Real_002ddata-DFT-Array-Format.html
+    FftPlanRegistry& registry { FftPlanRegistry::instance() };
+    m_forward_plan = registry.executor<real_type>({ ref.ncols(), ref.nrows(), FftKind::r2c });
+    // complex-to-real back transformation of the cross spectrum to the cross correlation
+    m_backward_plan = registry.executor<real_type>({ ref.ncols(), ref.nrows(), FftKind::c2r });
+    std::transform(ref.begin(), ref.end(), m_frame.begin(), [](const T& val) { return static_cast<real_type>(val); });
+    forward_transform();
+    std::transform(m_cross_spectrum.begin(), m_cross_spectrum.end(), m_ref_spectrum.begin(),
+        [](const complex_type& val) { return std::conj(val); });
+}
+
+template <typename T>
+requires std::floating_point<T>
+void CrossCorrelation<T>::forward_transform()
+{
+    // forward transform of m_frame to m_cross_spectrum
+    m_forward_plan.execute(m_frame.data().get(), m_cross_spectrum.data().get());
+}
+
+template <typename T>
+requires std::floating_point<T>
+void CrossCorrelation<T>::back_transform()
 {
+    if (m_upsampling > 1) {
+        // the c2r transform destroys its input
+        std::copy(m_cross_spectrum.begin(), m_cross_spectrum.end(), m_cross_power.begin());
+    }
+    // back transformed cross spectrum = cross correlation to m_correlation
+    m_backward_plan.execute(m_cross_spectrum.data().get(), m_correlation.data().get());
+    m_readiness = readiness::correl;
 }
 
 template <typename T>
 requires std::floating_point<T>
 void CrossCorrelation<T>::correlate(const Array2<T>& frame)
 {
-    if ((frame.ncols() != m_refframe.ncols()) || (frame.nrows() != m_refframe.nrows())) {
+    if ((frame.ncols() != m_frame.ncols()) || (frame.nrows() != m_frame.nrows())) {
         throw std::invalid_argument("Matrix dimensions must match for correlation");
     }
-    Array2<double> y(frame);
-    assert(y.size() == m_refframe.size());
-    Array2<std::complex<double>> fft1(m_refframe.ncols() / 2 + 1, m_refframe.nrows());
-    Array2<std::complex<double>> fft2(m_refframe.ncols() / 2 + 1, m_refframe.nrows());
+    std::transform(frame.begin(), frame.end(), m_frame.begin(), [](const T& val) { return static_cast<real_type>(val); });
+    forward_transform();
 
-    // set up real-to-complex DFTs
-    // ref: https://www.fftw.org/fftw3_doc/Real_002ddata-DFTs.html#Real_002ddata-DFTs
-    // see definition of FFTW3's real-data DFT data format:
-    // https://www.fftw.org/fftw3_doc/Real_002ddata-DFT-Array-Format.html
-    fftw_plan p1 = fftw_plan_dft_r2c_2d(m_refframe.nrows(), m_refframe.ncols(),
-        m_refframe.data().get(),
-        reinterpret_cast<fftw_complex*>(fft1.data().get()),
-        FFTW_ESTIMATE);
-    fftw_plan p2 = fftw_plan_dft_r2c_2d(m_refframe.nrows(), m_refframe.ncols(),
-        y.data().get(),
-        reinterpret_cast<fftw_complex*>(fft2.data().get()),
-        FFTW_ESTIMATE);
-
-    fftw_execute(p1);
-    fftw_execute(p2);
-    fftw_destroy_plan(p1);
-    fftw_destroy_plan(p2);
-
-    // execute element-wise conj(fft1) * fft2 for power spectrum
-    std::transform(fft1.begin(), fft1.end(), fft2.begin(), fft1.begin(),
-        [](const std::complex<double>& a, const std::complex<double>& b) {
-            return std::conj(a) * b;
+    // execute element-wise conj(ref) * frame for the cross spectrum
+    std::transform(m_ref_spectrum.begin(), m_ref_spectrum.end(), m_cross_spectrum.begin(), m_cross_spectrum.begin(),
+        [](const complex_type& a, const complex_type& b) {
+            return a * b;
         });
-    // prepare m_correlation for data reception
-    m_correlation = Array2<double>(m_refframe.ncols(), m_refframe.nrows());
-    // fft1 holds the power spectrum now
-    // set up complex-to-real back transformation
-    fftw_plan q = fftw_plan_dft_c2r_2d(m_refframe.nrows(), m_refframe.ncols(),
-        reinterpret_cast<fftw_complex*>(fft1.data().get()),
-        m_correlation.data().get(),
-        FFTW_ESTIMATE);
-    // back transformed power spectrum = cross correlation to m_correlation
-    fftw_execute(q);
-    fftw_destroy_plan(q);
-    m_readiness = readiness::correl;
+    back_transform();
 }
 
 template <typename T>
 requires std::floating_point<T>
-auto CrossCorrelation<T>::get_correlation_array() -> const Array2<T>&
+template <concept_complex U>
+void CrossCorrelation<T>::correlate(const FrameSpectrum<U>& spectrum)
+{
+    if ((spectrum.frame_sizes()[0] != m_frame.ncols()) || (spectrum.frame_sizes()[1] != m_frame.nrows())) {
+        throw std::invalid_argument("Matrix dimensions must match for correlation");
+    }
+    // the r2c half plane holds the non-negative x frequencies, the last one wraps around for even sizes
+    const int ncols { static_cast<int>(m_frame.ncols()) };
+    const int x_hi { ncols - ncols / 2 - 1 };
+    for (int x { 0 }; x <= ncols / 2; ++x) {
+        const int sx { (x > x_hi) ? x - ncols : x };
+        for (int y { m_cross_spectrum.min_sindices()[1] }; y <= m_cross_spectrum.max_sindices()[1]; ++y) {
+            m_cross_spectrum.at({ x, y }) = m_ref_spectrum.at({ x, y }) * static_cast<complex_type>(spectrum.value({ sx, y }));
+        }
+    }
+    back_transform();
+}
+
+template <typename T>
+requires std::floating_point<T>
+auto CrossCorrelation<T>::get_correlation_array() -> const Array2<real_type>&
 {
     if (m_readiness < readiness::correl)
         throw std::bad_function_call();
@@ -163,6 +244,97 @@ auto CrossCorrelation<T>::get_displacement() -> DimVector<int, 2>
     return m_shift;
 }
 
+template <typename T>
+requires std::floating_point<T>
+auto CrossCorrelation<T>::get_subpixel_displacement() -> DimVector<double, 2>
+{
+    if (m_readiness < readiness::correl)
+        throw std::bad_function_call();
+    calculate_displacement();
+    if (m_readiness == readiness::shift) {
+        refine_displacement();
+    }
+    return m_subpixel_shift;
+}
+
+template <typename T>
+requires std::floating_point<T>
+void CrossCorrelation<T>::set_upsampling(std::size_t factor)
+{
+    m_upsampling = factor;
+    m_cross_power = (factor > 1) ? Array2<complex_type>(m_cross_spectrum.ncols(), m_cross_spectrum.nrows()) : Array2<complex_type> {};
+    // the upsampled grid reaches 0.75 pixel around the integer maximum, see refine_displacement()
+    const std::size_t npoints { (factor > 1) ? static_cast<std::size_t>(2 * std::ceil(0.75 * static_cast<double>(factor)) + 1) : 0 };
+    m_x_kernel.assign(m_cross_power.ncols() * npoints, {});
+    m_y_kernel.assign(m_cross_power.nrows() * npoints, {});
+    m_partial.assign(m_cross_power.nrows() * npoints, {});
+    m_readiness = readiness::none;
+}
+
+template <typename T>
+requires std::floating_point<T>
+void CrossCorrelation<T>::refine_displacement()
+{
+    m_subpixel_shift = { static_cast<double>(m_shift[0]), static_cast<double>(m_shift[1]) };
+    m_readiness = readiness::subpixel;
+    if (m_upsampling <= 1) {
+        return;
+    }
+    // correlation on a grid of spacing 1/upsampling reaching 0.75 pixel around the integer maximum
+    const double factor { static_cast<double>(m_upsampling) };
+    const int half_width { static_cast<int>(std::ceil(0.75 * factor)) };
+    const std::size_t npoints { static_cast<std::size_t>(2 * half_width + 1) };
+    const std::size_t ncols { m_correlation.ncols() };
+    const std::size_t nrows { m_correlation.nrows() };
+    const std::size_t hcols { m_cross_power.ncols() };
+    // kernel of the inverse DFT along x on the half plane: the columns 1 ... (ncols-1)/2 stand for their
+    // hermitian counterpart as well, the real part of the sum is the correlation
+    std::complex<double>* const x_kernel { m_x_kernel.data() };
+    for (std::size_t i { 0 }; i < npoints; ++i) {
+        const double x { m_shift[0] + (static_cast<double>(i) - half_width) / factor };
+        for (std::size_t kx { 0 }; kx < hcols; ++kx) {
+            const double weight { (kx == 0 || 2 * kx == ncols) ? 1. : 2. };
+            x_kernel[i * hcols + kx] = std::polar(weight, 2. * constants::pi<double> * static_cast<double>(kx) * x / ncols);
+        }
+    }
+    std::complex<double>* const y_kernel { m_y_kernel.data() };
+    for (std::size_t j { 0 }; j < npoints; ++j) {
+        const double y { m_shift[1] + (static_cast<double>(j) - half_width) / factor };
+        for (std::size_t ky { 0 }; ky < nrows; ++ky) {
+            const double frequency { (2 * ky < nrows) ? static_cast<double>(ky) : static_cast<double>(ky) - static_cast<double>(nrows) };
+            y_kernel[j * nrows + ky] = std::polar(1., 2. * constants::pi<double> * frequency * y / nrows);
+        }
+    }
+    // partial sums over x for each row of the cross spectrum, accumulated in double precision
+    std::complex<double>* const partial { m_partial.data() };
+    const complex_type* const cross_power { m_cross_power.data().get() };
+    for (std::size_t ky { 0 }; ky < nrows; ++ky) {
+        const complex_type* const row { cross_power + ky * hcols };
+        for (std::size_t i { 0 }; i < npoints; ++i) {
+            const std::complex<double>* const kernel { x_kernel + i * hcols };
+            std::complex<double> sum {};
+            for (std::size_t kx { 0 }; kx < hcols; ++kx) {
+                sum += static_cast<std::complex<double>>(row[kx]) * kernel[kx];
+            }
+            partial[ky * npoints + i] = sum;
+        }
+    }
+    double max_value { -std::numeric_limits<double>::infinity() };
+    for (std::size_t j { 0 }; j < npoints; ++j) {
+        for (std::size_t i { 0 }; i < npoints; ++i) {
+            double value { 0. };
+            for (std::size_t ky { 0 }; ky < nrows; ++ky) {
+                value += (y_kernel[j * nrows + ky] * partial[ky * npoints + i]).real();
+            }
+            if (value > max_value) {
+                max_value = value;
+                m_subpixel_shift = { m_shift[0] + (static_cast<double>(i) - half_width) / factor,
+                    m_shift[1] + (static_cast<double>(j) - half_width) / factor };
+            }
+        }
+    }
+}
+
 template <typename T>
 requires std::floating_point<T>
 void CrossCorrelation<T>::calculate_displacement()
@@ -188,4 +360,15 @@ auto CrossCorrelation<T>::operator()(const Array2<T>& frame) -> DimVector<int, 2
     return m_shift;
 }
 
+template <typename T>
+requires std::floating_point<T>
+template <concept_complex U>
+auto CrossCorrelation<T>::operator()(const FrameSpectrum<U>& spectrum) -> DimVector<int, 2>
+{
+    m_readiness = readiness::none;
+    correlate(spectrum);
+    calculate_displacement();
+    return m_shift;
+}
+
 } // namespace smip
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <compare>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fftw3.h>
+
+#include "global.h"
+
+namespace smip {
+
+/*! planner rigor of fftw: the more rigorous planners time candidate algorithms on the actual machine */
+enum class FftRigor : std::uint8_t {
+    estimate,
+    measure,
+    patient
+};
+
+/*! kind of a 2d transform: real-to-complex, complex-to-real or complex forward/backward */
+enum class FftKind : std::uint8_t {
+    r2c,
+    c2r,
+    forward,
+    backward
+};
+
+enum class FftPrecision : std::uint8_t {
+    single_precision,
+    double_precision
+};
+
+/*! distance in elements between the consecutive arrays of \e count elements in the buffers of a batched plan
+ * the arrays are padded to multiples of 8 elements, so that each array of an aligned buffer starts aligned
+ */
+constexpr std::size_t fft_batch_distance(std::size_t count) noexcept
+{
+    return (count + 7) / 8 * 8;
+}
+
+/*! key of a plan in the FftPlanRegistry
+ * a transform of \e xsize x \e ysize (real) elements, on buffers allocated by fft_buffer() if \e aligned is set,
+ * with output and input in the same buffer if \e in_place is set. In-place r2c and c2r transforms require the rows
+ * of the real array to be padded to 2 (xsize/2+1) elements, see the fftw documentation.
+ * With \e howmany > 1 the plan transforms a batch of arrays in one call, the arrays follow each other in the
+ * input and output buffers at the distance fft_batch_distance() of their element count. Batched plans are
+ * out-of-place only.
+ * The number of \e threads executing the plan is chosen by the registry, see FftPlanRegistry::threads_for().
+ */
+struct FftPlanKey {
+    std::size_t xsize { 0 };
+    std::size_t ysize { 0 };
+    FftKind kind { FftKind::r2c };
+    FftPrecision precision { FftPrecision::double_precision };
+    bool aligned { true };
+    bool in_place { false };
+    std::size_t howmany { 1 };
+    std::size_t threads { 1 };
+
+    auto operator<=>(const FftPlanKey&) const = default;
+};
+
+/*! transforms of at least \e min_elements (real) elements, including all transforms of a batch, are executed by
+ * \e threads threads, 0 meaning the maximum number of threads of the FftPlanRegistry
+ */
+struct FftThreadCrossover {
+    std::size_t min_elements { 0 };
+    std::size_t threads { 1 };
+};
+
+/*! plan and array types of the fftw interface of precision \e R */
+template <typename R>
+struct FftTraits;
+
+template <>
+struct FftTraits<double> {
+    using plan_type = fftw_plan;
+    using complex_type = fftw_complex;
+    static constexpr FftPrecision precision { FftPrecision::double_precision };
+    static void execute(plan_type p, double* in, complex_type* out) { fftw_execute_dft_r2c(p, in, out); }
+    static void execute(plan_type p, complex_type* in, double* out) { fftw_execute_dft_c2r(p, in, out); }
+    static void execute(plan_type p, complex_type* in, complex_type* out) { fftw_execute_dft(p, in, out); }
+    static int alignment_of(double* p) { return fftw_alignment_of(p); }
+    static void* malloc(std::size_t n) { return fftw_malloc(n); }
+    static void free(void* p) { fftw_free(p); }
+};
+
+template <>
+struct FftTraits<float> {
+    using plan_type = fftwf_plan;
+    using complex_type = fftwf_complex;
+    static constexpr FftPrecision precision { FftPrecision::single_precision };
+    static void execute(plan_type p, float* in, complex_type* out) { fftwf_execute_dft_r2c(p, in, out); }
+    static void execute(plan_type p, complex_type* in, float* out) { fftwf_execute_dft_c2r(p, in, out); }
+    static void execute(plan_type p, complex_type* in, complex_type* out) { fftwf_execute_dft(p, in, out); }
+    static int alignment_of(float* p) { return fftwf_alignment_of(p); }
+    static void* malloc(std::size_t n) { return fftwf_malloc(n); }
+    static void free(void* p) { fftwf_free(p); }
+};
+
+/*! real type of the transforms of data of type \e T: float data is transformed in single precision, all other
+ * floating point types in double precision
+ */
+template <typename T>
+using fft_real_t = std::conditional_t<std::is_same_v<T, float>, float, double>;
+
+/*! uninitialized storage of \e count elements of type \e E (real or complex of precision \e R), allocated by
+ * fftw_malloc, i.e. aligned for the SIMD code of fftw, as required by the plans with FftPlanKey::aligned set
+ * @throw std::bad_alloc if the allocation fails
+ */
+template <typename E, typename R = double>
+std::shared_ptr<E[]> fft_buffer(std::size_t count)
+{
+    E* const data { static_cast<E*>(FftTraits<R>::malloc(sizeof(E) * std::max<std::size_t>(1, count))) };
+    if (data == nullptr) {
+        throw std::bad_alloc();
+    }
+    return std::shared_ptr<E[]>(data, [](E* p) { FftTraits<R>::free(p); });
+}
+
+/**
+ * @brief Handle of a plan of the FftPlanRegistry for the execution on caller supplied buffers
+ * @details The plan is applied with the new-array execute functions of fftw, which may be called concurrently
+ * from any number of threads on different buffers. The buffers must match the key of the plan: the transform
+ * size, in-place or out-of-place and, for aligned plans, the alignment provided by fft_buffer().
+ * Executors are cheap to copy, the plan itself is owned by the registry.
+ */
+template <typename R>
+class FftExecutor {
+public:
+    using real_type = R;
+    using complex_type = std::complex<R>;
+
+    FftExecutor() = default;
+
+    /*! r2c transform of \e in to \e out
+     * @throw std::invalid_argument if the plan is no r2c transform or the buffers do not match the key
+     */
+    void execute(R* in, complex_type* out) const
+    {
+        check(FftKind::r2c, in, reinterpret_cast<R*>(out));
+        FftTraits<R>::execute(m_plan, in, fftw_cast(out));
+    }
+    /*! c2r transform of \e in to \e out, the input is overwritten */
+    void execute(complex_type* in, R* out) const
+    {
+        check(FftKind::c2r, reinterpret_cast<R*>(in), out);
+        FftTraits<R>::execute(m_plan, fftw_cast(in), out);
+    }
+    /*! complex transform of \e in to \e out in the direction of the key */
+    void execute(complex_type* in, complex_type* out) const
+    {
+        if (m_key.kind != FftKind::backward) {
+            check(FftKind::forward, reinterpret_cast<R*>(in), reinterpret_cast<R*>(out));
+        } else {
+            check(FftKind::backward, reinterpret_cast<R*>(in), reinterpret_cast<R*>(out));
+        }
+        FftTraits<R>::execute(m_plan, fftw_cast(in), fftw_cast(out));
+    }
+
+    [[nodiscard]] const FftPlanKey& key() const noexcept { return m_key; }
+    [[nodiscard]] bool valid() const noexcept { return m_plan != nullptr; }
+
+private:
+    friend class FftPlanRegistry;
+    FftExecutor(const FftPlanKey& key, typename FftTraits<R>::plan_type plan)
+        : m_key(key)
+        , m_plan(plan)
+    {
+    }
+
+    static auto fftw_cast(complex_type* p) { return reinterpret_cast<typename FftTraits<R>::complex_type*>(p); }
+
+    void check(FftKind kind, R* in, R* out) const
+    {
+        if (m_plan == nullptr || m_key.kind != kind) {
+            throw std::invalid_argument("FftExecutor::execute: transform kind does not match the plan");
+        }
+        if (m_key.in_place != (static_cast<void*>(in) == static_cast<void*>(out))) {
+            throw std::invalid_argument("FftExecutor::execute: in-place/out-of-place buffers do not match the plan");
+        }
+        if (m_key.aligned && (FftTraits<R>::alignment_of(in) != 0 || FftTraits<R>::alignment_of(out) != 0)) {
+            throw std::invalid_argument("FftExecutor::execute: buffers are not aligned as required by the plan");
+        }
+    }
+
+    FftPlanKey m_key {};
+    typename FftTraits<R>::plan_type m_plan { nullptr };
+};
+
+/**
+ * @brief Process-wide registry of the fftw plans used by the library
+ * @details All plans of the library are created through the registry, which creates each plan once per
+ * FftPlanKey on first request, on internal scratch buffers, so that the data of the caller is never touched by
+ * the planner. Since the fftw planner is not thread safe, planning is serialized by the registry, the returned
+ * executors can be used from any thread. thread_executor() additionally caches the executors per thread, so that
+ * repeated requests of worker threads do not contend for the lock.
+ * The rigor of the planner (see {@link #set_rigor}) applies to plans created afterwards. With FftRigor::measure
+ * or FftRigor::patient the planning time can be saved in later runs by storing the accumulated wisdom of fftw
+ * with {@link #export_wisdom} and loading it on startup with {@link #import_wisdom}.
+ * If the library is built with the threaded fftw libraries, large transforms are executed by several threads.
+ * The number of threads of a plan is looked up by the transform size in a table of crossovers, which
+ * starts from a conservative default and can be measured on the actual machine with {@link #calibrate_threads},
+ * and is limited by {@link #set_max_threads} (1 by default, i.e. serial). Like the rigor, the thread settings
+ * apply to plans created afterwards, a change of the thread settings also empties the caches of thread_executor().
+ * The threads of fftw do not survive a fork(): a forked child has to call set_max_threads(1) before its first
+ * transform, so that it plans its own single-threaded transforms instead of executing the inherited ones.
+ * The plans are destroyed on exit.
+ */
+class SMIP_PUBLIC FftPlanRegistry {
+public:
+    FftPlanRegistry(const FftPlanRegistry&) = delete;
+    FftPlanRegistry& operator=(const FftPlanRegistry&) = delete;
+
+    /*! the registry of the process */
+    [[nodiscard]] static FftPlanRegistry& instance();
+
+    void set_rigor(FftRigor rigor);
+    [[nodiscard]] FftRigor rigor() const;
+
+    /*! true, if the library is built with the threaded fftw libraries */
+    [[nodiscard]] static bool threads_supported() noexcept;
+    /*! limit the number of threads of a single transform to \e nthreads, 0 selects all cores */
+    void set_max_threads(std::size_t nthreads);
+    [[nodiscard]] std::size_t max_threads() const;
+    /*! replace the crossover table, entries are sorted by FftThreadCrossover::min_elements */
+    void set_thread_crossovers(std::vector<FftThreadCrossover> crossovers);
+    [[nodiscard]] std::vector<FftThreadCrossover> thread_crossovers() const;
+    /*! measure the fastest number of threads, up to max_threads(), of r2c transforms of square frames of
+     * 32 to 1024 pixels and replace the crossover table by the result; takes up to a second
+     */
+    void calibrate_threads();
+    /*! number of threads of a plan for \e key: the entry of the crossover table for its size, limited by max_threads() */
+    [[nodiscard]] std::size_t threads_for(const FftPlanKey& key) const;
+
+    /*! executor of the plan for \e key, the precision of the key is set from \e R
+     * @throw std::runtime_error if fftw can not create the plan
+     */
+    template <typename R>
+    [[nodiscard]] FftExecutor<R> executor(FftPlanKey key);
+    /*! executor() with a cache local to the calling thread */
+    template <typename R>
+    [[nodiscard]] FftExecutor<R> thread_executor(FftPlanKey key);
+
+    /*! merges the wisdom of fftw (both precisions) from \e filename
+     * @return false, if the file does not exist or holds no valid wisdom
+     */
+    bool import_wisdom(const std::string& filename);
+    /*! writes the wisdom of fftw (both precisions) to \e filename
+     * @return false, if the file could not be written
+     */
+    bool export_wisdom(const std::string& filename) const;
+
+    /*! number of plans in the registry */
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    FftPlanRegistry();
+    ~FftPlanRegistry();
+
+    /*! the plan for \e key, created on first request, with the lock held */
+    void* plan(const FftPlanKey& key);
+    /*! threads_for() with the lock held */
+    [[nodiscard]] std::size_t lookup_threads(const FftPlanKey& key) const;
+
+    mutable std::mutex m_mutex {};
+    FftRigor m_rigor { FftRigor::estimate };
+    std::size_t m_max_threads { 1 };
+    std::vector<FftThreadCrossover> m_crossovers {};
+    std::map<FftPlanKey, void*> m_plans {};
+    /*! incremented on each change of the thread settings, invalidates the caches of thread_executor() */
+    std::atomic<std::size_t> m_thread_generation { 0 };
+};
+
+//********************
+// implementation part
+//********************
+
+template <typename R>
+FftExecutor<R> FftPlanRegistry::executor(FftPlanKey key)
+{
+    key.precision = FftTraits<R>::precision;
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    key.threads = lookup_threads(key);
+    return FftExecutor<R>(key, static_cast<typename FftTraits<R>::plan_type>(plan(key)));
+}
+
+template <typename R>
+FftExecutor<R> FftPlanRegistry::thread_executor(FftPlanKey key)
+{
+    key.precision = FftTraits<R>::precision;
+    thread_local std::map<FftPlanKey, FftExecutor<R>> cache {};
+    thread_local std::size_t cache_generation { 0 };
+    const std::size_t generation { m_thread_generation.load(std::memory_order_acquire) };
+    if (generation != cache_generation) {
+        cache.clear();
+        cache_generation = generation;
+    }
+    auto it { cache.find(key) };
+    if (it == cache.end()) {
+        it = cache.emplace(key, executor<R>(key)).first;
+    }
+    return it->second;
+}
+
+} // namespace smip
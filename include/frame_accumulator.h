@@ -0,0 +1,151 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "array2.h"
+#include "bispectrum.h"
+#include "crosscorrel.h"
+#include "fft_plans.h"
+#include "frame_spectrum.h"
+#include "frame_stack.h"
+#include "pyramid_correl.h"
+#include "global.h"
+#include "types.h"
+#include "videoio.h"
+
+namespace smip {
+
+/**
+ * @brief FrameAccumulator class for the accumulation of sum image, power spectrum and bispectrum of a frame sequence
+ * @details The FrameAccumulator bundles the per-frame processing chain: each frame passed to
+ * {@link #add_frame(const Array2<double>&) add_frame} is transformed once by a real-to-complex fft, which
+ * yields the half-plane of the hermitian frame spectrum, and staged into a compact FrameSpectrum
+ * (single precision). The spectrum is registered wrt. the reference frame supplied on construction, the
+ * back-shifted frame is added to the sum image and the spectrum is accumulated to the bispectrum and power spectrum.
+ * The power spectrum is real and kept in the half-plane layout of the r2c transform (<i>xsize/2+1</i> columns). The sums are not normalized, the number of accumulated frames is available through {@link #nframes()}.
+ * The storage of the sums can be provided by the caller (e.g. placed in shared memory) through the
+ * second constructor. A callback can be installed with {@link #set_spectrum_callback(spectrum_callback_t)}
+ * in order to receive the spectrum of each frame.
+ * With an upsampling factor set by {@link #set_upsampling(std::size_t)} the frames are registered with subpixel
+ * precision (see CrossCorrelation) and added to the sum image shifted by a phase ramp applied to their spectrum,
+ * i.e. the shift is cyclic. This costs a complex-to-real back transform per frame.
+ * For large frames the integer registration can be done coarse-to-fine by a PyramidCorrelation instead, see
+ * {@link #set_pyramid_levels(std::size_t)}, which avoids the full-size back transform of the cross correlation.
+ * Batches of frames gathered in a FrameStack are transformed by one batched fft and accumulated directly from the
+ * buffers of the stack with {@link #add_frames(FrameStack&) add_frames}; accumulate_frames() batches the decoded
+ * frames by {@link #batch_size()} and decodes {@link #prefetch_depth()} frames ahead on a FramePrefetcher thread.
+ * With {@link #set_single_precision(bool)} single frames are transformed and registered in single precision,
+ * the results differ from the default double precision path only by rounding.
+ */
+class SMIP_PUBLIC FrameAccumulator {
+public:
+    using spectrum_callback_t = std::function<void(const FrameSpectrum<bispec_complex_t>&)>;
+
+    FrameAccumulator() = delete;
+    /*! Creates FrameAccumulator for frames of the size of \e ref_frame with bispectrum extent \e bispectrum_depth
+     * accumulation of the bispectrum is skipped if \e with_bispectrum is false
+     */
+    FrameAccumulator(const Array2<double>& ref_frame, std::size_t bispectrum_depth, bool with_bispectrum = true);
+    /*! Creates FrameAccumulator accumulating into the caller supplied (zero-initialized) storage
+     * accumulation of the bispectrum is skipped if \e bispectrum is empty
+     */
+    FrameAccumulator(const Array2<double>& ref_frame,
+        Bispectrum<bispec_complex_t>&& bispectrum,
+        Array2<double>&& powerspec,
+        Array2<double>&& sum);
+    FrameAccumulator(const FrameAccumulator&) = delete;
+    FrameAccumulator& operator=(const FrameAccumulator&) = delete;
+    ~FrameAccumulator() = default;
+
+    /*! register \e frame, add it to the sum image and accumulate its fft to bispectrum and power spectrum */
+    void add_frame(const Array2<double>& frame);
+    /*! add all frames of \e stack as add_frame() does, the stack is transformed first unless already done
+     * @throw std::invalid_argument if the frame size of the stack does not match
+     */
+    void add_frames(FrameStack& stack);
+    /*! add already accumulated (non-normalized) sums of \e nframes frames */
+    void merge(const Bispectrum<bispec_complex_t>& bispectrum,
+        const Array2<double>& powerspec,
+        const Array2<double>& sum,
+        std::size_t nframes);
+    void set_spectrum_callback(spectrum_callback_t callback) { m_spectrum_callback = std::move(callback); }
+    /*! register the frames with a precision of 1/\e factor pixel, 0 or 1 selects the integer registration (default) */
+    void set_upsampling(std::size_t factor);
+    [[nodiscard]] std::size_t upsampling() const noexcept { return m_cross_correl.upsampling(); }
+    /*! register the frames by a PyramidCorrelation with frames binned by 2^\e levels for the coarse stage,
+     * 0 selects the full-size cross correlation (default), ignored with subpixel registration
+     * @throw std::invalid_argument if the binned frames are too small
+     */
+    void set_pyramid_levels(std::size_t levels);
+    [[nodiscard]] std::size_t pyramid_levels() const noexcept { return m_pyramid_levels; }
+    /*! number of frames transformed together by accumulate_frames(), 1 transforms each frame separately (default) */
+    void set_batch_size(std::size_t frames);
+    [[nodiscard]] std::size_t batch_size() const noexcept { return m_batch_size; }
+    /*! number of frames decoded ahead in a background thread by accumulate_frames(), 0 decodes synchronously (default) */
+    void set_prefetch_depth(std::size_t frames) noexcept { m_prefetch_depth = frames; }
+    [[nodiscard]] std::size_t prefetch_depth() const noexcept { return m_prefetch_depth; }
+    /*! transform (unless batched) and register the frames in single precision, the sums are kept in double precision */
+    void set_single_precision(bool single_precision);
+    [[nodiscard]] bool single_precision() const noexcept { return m_single_correl != nullptr; }
+
+    [[nodiscard]] Bispectrum<bispec_complex_t>& bispectrum() { return m_bispectrum; }
+    [[nodiscard]] const Bispectrum<bispec_complex_t>& bispectrum() const { return m_bispectrum; }
+    [[nodiscard]] Array2<double>& powerspectrum() { return m_powerspec; }
+    [[nodiscard]] const Array2<double>& powerspectrum() const { return m_powerspec; }
+    [[nodiscard]] Array2<double>& sum_image() { return m_sum; }
+    [[nodiscard]] const Array2<double>& sum_image() const { return m_sum; }
+    [[nodiscard]] std::size_t nframes() const noexcept { return m_nframes; }
+    [[nodiscard]] bool with_bispectrum() const noexcept { return m_with_bispectrum; }
+
+private:
+    void setup_plan();
+    /*! register and accumulate \e frame with its half-plane spectrum \e spectrum of precision \e R */
+    template <typename R>
+    void accumulate(const Array2<double>& frame, const Array2<std::complex<R>>& spectrum);
+    /*! add the frame of \e spectrum shifted by \e shift through a phase ramp of its spectrum to the sum image */
+    template <typename R>
+    void add_shifted(const Array2<std::complex<R>>& spectrum, const DimVector<double, 2>& shift);
+
+    CrossCorrelation<double> m_cross_correl;
+    Array2<double> m_ref_frame {};
+    std::unique_ptr<PyramidCorrelation<double>> m_pyramid {};
+    std::size_t m_pyramid_levels { 0 };
+    Array2<double> m_frame {};
+    Array2<complex_t> m_spectrum {};
+    FrameSpectrum<bispec_complex_t> m_frame_spectrum {};
+    FftExecutor<double> m_forward_plan {};
+    /*! registration and transform in single precision, only with set_single_precision() */
+    std::unique_ptr<CrossCorrelation<float>> m_single_correl {};
+    Array2<float> m_single_frame {};
+    Array2<std::complex<float>> m_single_spectrum {};
+    FftExecutor<float> m_single_plan {};
+    /*! back transform of the phase shifted spectrum, only with subpixel registration */
+    FftExecutor<double> m_backward_plan {};
+    Array2<complex_t> m_shifted_spectrum {};
+    Array2<double> m_shifted_frame {};
+    /*! phase ramp along x of the shifted spectrum */
+    std::vector<complex_t> m_x_ramp {};
+    Bispectrum<bispec_complex_t> m_bispectrum {};
+    Array2<double> m_powerspec {};
+    Array2<double> m_sum {};
+    bool m_with_bispectrum { true };
+    std::size_t m_nframes { 0 };
+    std::size_t m_batch_size { 1 };
+    std::size_t m_prefetch_depth { 0 };
+    spectrum_callback_t m_spectrum_callback {};
+};
+
+/*! decode \e count frames starting at frame index \e first_frame from \e fe and add them to \e accumulator
+ * \returns the number of frames actually added
+ */
+std::size_t SMIP_PUBLIC accumulate_frames(FrameExtractor& fe,
+    color_channel_t color_channel,
+    std::size_t first_frame,
+    std::size_t count,
+    FrameAccumulator& accumulator);
+
+} // namespace smip
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "global.h"
+#include "videoio.h"
+
+namespace smip {
+
+/**
+ * @brief Reader decoding the frames of a FrameExtractor ahead on a dedicated thread
+ * @details The FramePrefetcher decodes the frames [<i>first_frame</i>, <i>first_frame</i>+<i>count</i>) of the
+ * extractor in a background thread into a bounded pool of {@link #capacity()} reusable frame buffers, so that
+ * decoding overlaps with the transform and accumulation of the previous frames. The frames are handed out in
+ * decoding order by {@link #next()} as move-only {@link Handle}s, each owning one buffer of the pool until it is
+ * released or destroyed. When all buffers are decoded or held by the consumer, the decoder waits for a buffer to
+ * return (backpressure), i.e. at most {@link #capacity()} frames are kept in memory. Since the buffers are
+ * reused, the decoder writes into already allocated storage once the pool has been cycled.
+ * A consumer holding all {@link #capacity()} handles must release one before asking for the next frame.
+ * The extractor must not be used by others while the prefetcher exists; afterwards it is positioned after the last
+ * decoded frame. The destructor stops the decoder after the frame it currently decodes and joins the thread, all
+ * handles have to be released before.
+ */
+class SMIP_PUBLIC FramePrefetcher {
+public:
+    /*! move-only access to one decoded frame, the buffer returns to the pool on release or destruction */
+    class SMIP_PUBLIC Handle {
+    public:
+        Handle() = default;
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+        Handle(Handle&& other) noexcept;
+        Handle& operator=(Handle&& other) noexcept;
+        ~Handle() { release(); }
+
+        /*! true if the handle holds a frame, false at the end of the sequence */
+        explicit operator bool() const noexcept { return m_owner != nullptr; }
+        [[nodiscard]] cv::Mat& frame() const;
+        /*! index of the frame in the video */
+        [[nodiscard]] std::size_t index() const;
+        /*! return the buffer to the pool, the handle is empty afterwards */
+        void release() noexcept;
+
+    private:
+        friend class FramePrefetcher;
+        Handle(FramePrefetcher* owner, std::size_t slot)
+            : m_owner(owner)
+            , m_slot(slot)
+        {
+        }
+
+        FramePrefetcher* m_owner { nullptr };
+        std::size_t m_slot { 0 };
+    };
+
+    FramePrefetcher() = delete;
+    /*! Starts decoding \e count frames from frame index \e first_frame of \e fe into \e capacity buffers
+     * @throw std::invalid_argument if \e capacity is zero
+     */
+    FramePrefetcher(FrameExtractor& fe, std::size_t first_frame, std::size_t count, std::size_t capacity);
+    FramePrefetcher(const FramePrefetcher&) = delete;
+    FramePrefetcher& operator=(const FramePrefetcher&) = delete;
+    ~FramePrefetcher();
+
+    /*! the next frame in decoding order, waits until it is decoded
+     * \returns an empty handle after the last frame of the range or of the video
+     * @throw rethrows the exception of a failed decode
+     */
+    [[nodiscard]] Handle next();
+    [[nodiscard]] std::size_t capacity() const noexcept { return m_slots.size(); }
+
+private:
+    struct Slot {
+        cv::Mat frame {};
+        std::size_t index { 0 };
+    };
+
+    void decode(std::size_t first_frame, std::size_t count);
+    void recycle(std::size_t slot);
+
+    FrameExtractor& m_extractor;
+    std::vector<Slot> m_slots {};
+    /*! buffers available to the decoder */
+    std::vector<std::size_t> m_free {};
+    /*! decoded buffers in decoding order */
+    std::deque<std::size_t> m_ready {};
+    bool m_finished { false };
+    bool m_stop { false };
+    std::exception_ptr m_error {};
+    std::mutex m_mutex {};
+    std::condition_variable m_buffer_free {};
+    std::condition_variable m_frame_ready {};
+    std::thread m_decoder {};
+};
+
+} // namespace smip
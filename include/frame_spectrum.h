@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <complex>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "array2.h"
+#include "dimvector.h"
+#include "types.h"
+
+namespace smip {
+
+/**
+ * @brief Compact storage of the low-frequency region of a frame spectrum
+ * @tparam T complex value type, typically bispec_complex_t
+ * @details The FrameSpectrum holds the frequencies [<i>-fx..fx</i>] x [<i>-fy..fy</i>] (clipped to the frequency
+ * range of the frame) of the fft of a frame, accessed through centred signed indices with
+ * {@link #at(s_indices) at}. Frequencies beyond the region are not stored at all.
+ * In contrast to Array2, the elements are stored with the y index running fastest, such that a column of
+ * constant x is contiguous in memory and can be accessed through the pointer returned by
+ * {@link #column(int) column}. This matches the access pattern of the innermost loop of the
+ * triple product accumulation in Bispectrum, which runs over the y component of the frequencies.
+ * The full spectrum of the (real) frame is available through {@link #value(s_indices) value},
+ * which applies the hermitian symmetry for frequencies only stored with opposite sign.
+ * The region can be filled either from a full complex fft or from the half-plane output of a real-to-complex
+ * transform with {@link #assign_halfplane(const Array2<U>&) assign_halfplane}.
+ */
+template <concept_complex T>
+class FrameSpectrum {
+public:
+    using s_indices = DimVector<int, 2>;
+    using extents = DimVector<std::size_t, 2>;
+
+    FrameSpectrum() = default;
+    /*! Creates zero-valued FrameSpectrum for frames of size \e frame_sizes with maximum frequencies \e max_frequency */
+    FrameSpectrum(const extents& frame_sizes, const extents& max_frequency);
+    /*! Creates FrameSpectrum from the region of \e fft (in fftw order) up to the maximum frequencies \e max_frequency */
+    template <concept_complex U>
+    FrameSpectrum(const Array2<U>& fft, const extents& max_frequency);
+
+    /*! copy the stored region from \e fft, which must have the frame size of this FrameSpectrum */
+    template <concept_complex U>
+    void assign(const Array2<U>& fft);
+    /*! copy the stored region from the half-plane spectrum \e halfplane of a real frame in the layout of
+     * fftw's r2c transform (<i>xsize/2+1</i> columns), negative x frequencies are obtained through hermitian symmetry
+     */
+    template <concept_complex U>
+    void assign_halfplane(const Array2<U>& halfplane);
+
+    [[nodiscard]] const T& at(s_indices indices) const noexcept { return m_data[offset(indices)]; }
+    [[nodiscard]] T& at(s_indices indices) noexcept { return m_data[offset(indices)]; }
+    /*! pointer to the element with indices [<i>x</i>,0], valid for y indices within [min_sindices()[1], max_sindices()[1]] */
+    [[nodiscard]] const T* column(int x) const noexcept { return m_data.data() + offset({ x, 0 }); }
+    /*! element of the full (periodic) frame spectrum at \e indices, zero if neither the frequency nor its negative is stored */
+    [[nodiscard]] T value(s_indices indices) const noexcept;
+    [[nodiscard]] bool contains(const s_indices& indices) const noexcept;
+
+    /*! add the squared moduli, weighted with \e weight, to the real half-plane power spectrum \e powerspec
+     * (<i>xsize/2+1</i> columns in fftw r2c order)
+     */
+    template <typename U>
+    void add_powerspectrum_to(Array2<U>& powerspec, double weight = 1.) const;
+
+    [[nodiscard]] s_indices min_sindices() const noexcept { return m_min; }
+    [[nodiscard]] s_indices max_sindices() const noexcept { return m_max; }
+    [[nodiscard]] extents frame_sizes() const noexcept { return m_frame_sizes; }
+    [[nodiscard]] std::size_t xsize() const noexcept { return m_xsize; }
+    [[nodiscard]] std::size_t ysize() const noexcept { return m_ysize; }
+    [[nodiscard]] std::size_t size() const noexcept { return m_data.size(); }
+    [[nodiscard]] const T* data() const noexcept { return m_data.data(); }
+    [[nodiscard]] T* data() noexcept { return m_data.data(); }
+
+private:
+    [[nodiscard]] std::size_t offset(const s_indices& indices) const noexcept
+    {
+        assert(contains(indices));
+        return static_cast<std::size_t>(indices[0] - m_min[0]) * m_ysize + static_cast<std::size_t>(indices[1] - m_min[1]);
+    }
+
+    extents m_frame_sizes { 0, 0 };
+    s_indices m_min { 0, 0 };
+    s_indices m_max { -1, -1 };
+    std::size_t m_xsize { 0 };
+    std::size_t m_ysize { 0 };
+    std::vector<T> m_data {};
+};
+
+//********************
+// implementation part
+//********************
+
+template <concept_complex T>
+FrameSpectrum<T>::FrameSpectrum(const extents& frame_sizes, const extents& max_frequency)
+    : m_frame_sizes(frame_sizes)
+{
+    // same signed index convention as Array2::min_sindices() / max_sindices()
+    for (std::size_t dim { 0 }; dim < 2; ++dim) {
+        const int n { static_cast<int>(frame_sizes[dim]) };
+        m_min[dim] = std::max(-n / 2, -static_cast<int>(max_frequency[dim]));
+        m_max[dim] = std::min(-n / 2 + n - 1, static_cast<int>(max_frequency[dim]));
+    }
+    m_xsize = static_cast<std::size_t>(std::max(0, m_max[0] - m_min[0] + 1));
+    m_ysize = static_cast<std::size_t>(std::max(0, m_max[1] - m_min[1] + 1));
+    m_data.assign(m_xsize * m_ysize, T {});
+}
+
+template <concept_complex T>
+template <concept_complex U>
+FrameSpectrum<T>::FrameSpectrum(const Array2<U>& fft, const extents& max_frequency)
+    : FrameSpectrum({ fft.ncols(), fft.nrows() }, max_frequency)
+{
+    assign(fft);
+}
+
+template <concept_complex T>
+template <concept_complex U>
+void FrameSpectrum<T>::assign(const Array2<U>& fft)
+{
+    if (fft.ncols() != m_frame_sizes[0] || fft.nrows() != m_frame_sizes[1]) {
+        throw std::invalid_argument("FrameSpectrum::assign(const Array2) : frame size mismatch");
+    }
+    // transpose the region into column-major order
+    T* dest { m_data.data() };
+    for (int x { m_min[0] }; x <= m_max[0]; ++x) {
+        for (int y { m_min[1] }; y <= m_max[1]; ++y) {
+            *dest++ = static_cast<T>(fft.at({ x, y }));
+        }
+    }
+}
+
+template <concept_complex T>
+template <concept_complex U>
+void FrameSpectrum<T>::assign_halfplane(const Array2<U>& halfplane)
+{
+    if (halfplane.ncols() != m_frame_sizes[0] / 2 + 1 || halfplane.nrows() != m_frame_sizes[1]) {
+        throw std::invalid_argument("FrameSpectrum::assign_halfplane(const Array2) : frame size mismatch");
+    }
+    const int ysize { static_cast<int>(m_frame_sizes[1]) };
+    auto row = [ysize](int y) { return static_cast<std::size_t>(y < 0 ? y + ysize : y); };
+    T* dest { m_data.data() };
+    for (int x { m_min[0] }; x <= m_max[0]; ++x) {
+        for (int y { m_min[1] }; y <= m_max[1]; ++y) {
+            *dest++ = (x >= 0) ? static_cast<T>(halfplane(x, row(y)))
+                               : static_cast<T>(std::conj(halfplane(-x, row(-y))));
+        }
+    }
+}
+
+template <concept_complex T>
+bool FrameSpectrum<T>::contains(const s_indices& indices) const noexcept
+{
+    return indices[0] >= m_min[0] && indices[0] <= m_max[0] && indices[1] >= m_min[1] && indices[1] <= m_max[1];
+}
+
+template <concept_complex T>
+T FrameSpectrum<T>::value(s_indices indices) const noexcept
+{
+    // map to the signed frequency range of the frame, frequencies are periodic with the frame size
+    auto wrap = [this](s_indices& ind) {
+        for (std::size_t dim { 0 }; dim < 2; ++dim) {
+            const int n { std::max(1, static_cast<int>(m_frame_sizes[dim])) };
+            ind[dim] = ((ind[dim] + n / 2) % n + n) % n - n / 2;
+        }
+    };
+    wrap(indices);
+    if (contains(indices)) {
+        return at(indices);
+    }
+    indices *= -1;
+    wrap(indices);
+    if (contains(indices)) {
+        return std::conj(at(indices));
+    }
+    return T {};
+}
+
+template <concept_complex T>
+template <typename U>
+void FrameSpectrum<T>::add_powerspectrum_to(Array2<U>& powerspec, double weight) const
+{
+    if (powerspec.ncols() != m_frame_sizes[0] / 2 + 1 || powerspec.nrows() != m_frame_sizes[1]) {
+        throw std::invalid_argument("FrameSpectrum::add_powerspectrum_to(Array2) : frame size mismatch");
+    }
+    const int ysize { static_cast<int>(m_frame_sizes[1]) };
+    for (std::size_t y { 0 }; y < powerspec.nrows(); ++y) {
+        const int sy { static_cast<int>(y) > ysize - ysize / 2 - 1 ? static_cast<int>(y) - ysize : static_cast<int>(y) };
+        U* dest { powerspec[static_cast<int>(y)] };
+        for (std::size_t x { 0 }; x < powerspec.ncols(); ++x) {
+            dest[x] += static_cast<U>(weight * static_cast<double>(std::norm(value({ static_cast<int>(x), sy }))));
+        }
+    }
+}
+
+} // namespace smip
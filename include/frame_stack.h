@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "array2.h"
+#include "fft_plans.h"
+#include "global.h"
+#include "types.h"
+
+namespace smip {
+
+/**
+ * @brief Batch of frames in one contiguous buffer, transformed by a single batched fft
+ * @details The FrameStack gathers up to {@link #capacity()} frames of equal size in one aligned buffer, where
+ * consecutive frames are spaced by fft_batch_distance() of the frame size. Once filled, all frames are
+ * transformed by {@link #transform()} with one batched real-to-complex plan of the FftPlanRegistry into a
+ * second contiguous buffer of half-plane spectra (<i>xsize/2+1</i> columns, as for the single frame plan). For
+ * small frames this saves the per-call overhead of the fft and keeps the data of the batch close together in memory.
+ * Frames and spectra are accessible through {@link #frame(std::size_t)} and {@link #spectrum(std::size_t)} as
+ * Array2 sharing the storage of the stack, i.e. without copies. A partially filled stack, e.g. the last batch of a
+ * sequence, is transformed frame by frame with the single frame plan.
+ */
+class SMIP_PUBLIC FrameStack {
+public:
+    FrameStack() = delete;
+    /*! Creates an empty stack for up to \e capacity frames of \e xsize x \e ysize pixels
+     * @throw std::invalid_argument if any of the sizes is zero
+     */
+    FrameStack(std::size_t xsize, std::size_t ysize, std::size_t capacity);
+    FrameStack(const FrameStack&) = delete;
+    FrameStack& operator=(const FrameStack&) = delete;
+
+    /*! copy \e frame into the next free slot of the stack
+     * @throw std::invalid_argument if the frame size does not match
+     * @throw std::length_error if the stack is full
+     */
+    void push_back(const Array2<double>& frame);
+    /*! fft of all frames in the stack */
+    void transform();
+    /*! empty the stack for the next batch, the storage is kept */
+    void clear() noexcept;
+
+    [[nodiscard]] const Array2<double>& frame(std::size_t index) const { return m_frames.at(index); }
+    /*! half-plane spectrum of the frame at \e index, valid after transform() */
+    [[nodiscard]] const Array2<complex_t>& spectrum(std::size_t index) const { return m_spectra.at(index); }
+
+    [[nodiscard]] std::size_t size() const noexcept { return m_size; }
+    [[nodiscard]] std::size_t capacity() const noexcept { return m_frames.size(); }
+    [[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+    [[nodiscard]] bool full() const noexcept { return m_size == m_frames.size(); }
+    [[nodiscard]] bool transformed() const noexcept { return m_transformed; }
+    [[nodiscard]] std::size_t xsize() const noexcept { return m_xsize; }
+    [[nodiscard]] std::size_t ysize() const noexcept { return m_ysize; }
+
+private:
+    std::size_t m_xsize { 0 };
+    std::size_t m_ysize { 0 };
+    std::shared_ptr<double[]> m_frame_buffer {};
+    std::shared_ptr<complex_t[]> m_spectrum_buffer {};
+    /*! views of the frames and spectra in the buffers */
+    std::vector<Array2<double>> m_frames {};
+    std::vector<Array2<complex_t>> m_spectra {};
+    FftExecutor<double> m_batch_plan {};
+    FftExecutor<double> m_frame_plan {};
+    std::size_t m_size { 0 };
+    bool m_transformed { false };
+};
+
+} // namespace smip
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "array2.h"
+#include "bispectrum.h"
+#include "phasemap.h"
+#include "phasereco.h"
+#include "reconstruction_plan.h"
+#include "types.h"
+
+namespace smip {
+
+/**
+ * @brief Incremental phase reconstruction for repeated reconstructions of a growing bispectrum
+ * @details The IncrementalReconstruction keeps the phases and phase map of its last {@link #update} and
+ * reconstructs the phases of a new (normalized) bispectrum following \e plan in the order of the sequential
+ * reconstruction. A target is recomputed only if its planned bispectrum elements have changed by more than
+ * \e min_change relative to the last recomputation, measured as the euclidean norm of the element changes relative
+ * to that of the elements, or if the phase of one of its pairs has moved by more than \e min_change (as phasor
+ * distance) in the same update. Since every element enters the norm, opposite changes of the elements do not
+ * cancel; the elements of the last recomputation are kept for this, one per planned pair. All other targets keep their previous phase and
+ * consistency. The first update recomputes all targets; with \e min_change = 0 every update yields the result of
+ * reconstruct_phases(). The plan must outlive the object.
+ */
+template <typename T>
+class IncrementalReconstruction {
+public:
+    IncrementalReconstruction() = delete;
+    /*! Creates an incremental reconstruction following \e plan, each target is averaged from at most
+     * \e max_pairs pairs if set (see reconstruct_phases())
+     */
+    explicit IncrementalReconstruction(const ReconstructionPlan& plan, double min_change = 0.01, std::size_t max_pairs = 0);
+
+    /*! reconstruct the phases of \e bispec, which must match the bispectrum extents of the plan
+     * @throw std::invalid_argument if \e bispec does not match the plan
+     * @return the number of recomputed targets
+     */
+    template <typename U>
+    std::size_t update(const Bispectrum<U>& bispec);
+
+    [[nodiscard]] const Array2<T>& phases() const noexcept { return m_phases; }
+    [[nodiscard]] const PhaseMap& phasemap() const noexcept { return m_pm; }
+    [[nodiscard]] std::size_t nupdates() const noexcept { return m_nupdates; }
+
+private:
+    const ReconstructionPlan& m_plan;
+    double m_min_change { 0.01 };
+    std::size_t m_max_pairs { 0 };
+    Array2<T> m_phases {};
+    PhaseMap m_pm {};
+    /*! bispectrum elements of the planned pairs at the last recomputation of their target */
+    std::vector<bispec_complex_t> m_elements {};
+    std::size_t m_nupdates { 0 };
+};
+
+//********************
+// implementation part
+//********************
+
+template <typename T>
+IncrementalReconstruction<T>::IncrementalReconstruction(const ReconstructionPlan& plan, double min_change, std::size_t max_pairs)
+    : m_plan(plan)
+    , m_min_change(min_change)
+    , m_max_pairs(max_pairs)
+    , m_phases(plan.xsize(), plan.ysize())
+    , m_pm(plan.xsize(), plan.ysize())
+    , m_elements(plan.locations().size())
+{
+}
+
+template <typename T>
+template <typename U>
+std::size_t IncrementalReconstruction<T>::update(const Bispectrum<U>& bispec)
+{
+    if (!(m_plan.bispectrum_dims() == bispec.dimsizes())) {
+        throw std::invalid_argument("IncrementalReconstruction::update: reconstruction plan does not match bispectrum extents");
+    }
+    PhaseMap pm(m_plan.xsize(), m_plan.ysize());
+    Array2<T> phases(m_plan.xsize(), m_plan.ysize());
+    detail::init_reco_phases(phases, pm);
+
+    T* const phase_data { phases.data().get() };
+    const T* const previous { m_phases.data().get() };
+    detail::TargetBuffers<U> buffers(m_plan);
+    // phases which moved in this update, their dependent targets have to be recomputed
+    std::vector<char> moved(pm.size(), 0);
+    // targets evaluated in this update, a repeated visit always recomputes
+    std::vector<char> evaluated(m_plan.targets().size(), 0);
+    std::size_t nrecomputed { 0 };
+    for (const std::uint32_t target_index : m_plan.visit_order()) {
+        const ReconstructionPlan::Target& target { m_plan.targets()[target_index] };
+        const std::uint32_t offset { target.phase_offset };
+        if (pm.flag(offset)) {
+            continue;
+        }
+        bispec.gather(m_plan.locations().data() + target.first_pair, target.npairs, buffers.elements.data());
+        // squared norms need no square roots, the test costs a fraction of the recomputation
+        bispec_complex_t* const last_elements { m_elements.data() + target.first_pair };
+        double change { 0. };
+        double norm { 0. };
+        for (std::size_t i { 0 }; i < target.npairs; ++i) {
+            const bispec_complex_t element { static_cast<bispec_complex_t>(buffers.elements[i]) };
+            change += std::norm(element - last_elements[i]);
+            norm += std::norm(last_elements[i]);
+        }
+        bool recompute { evaluated[target_index] || !m_pm.flag(offset) || change > m_min_change * m_min_change * norm };
+        const ReconstructionPlan::Pair* const pairs { m_plan.pairs().data() + target.first_pair };
+        for (std::size_t i { 0 }; !recompute && i < target.npairs; ++i) {
+            recompute = moved[pairs[i].u_offset] || moved[pairs[i].v_offset];
+        }
+        if (!recompute) {
+            pm.set(offset, m_pm[offset]);
+            phase_data[offset] = previous[offset];
+            continue;
+        }
+        evaluated[target_index] = 1;
+        for (std::size_t i { 0 }; i < target.npairs; ++i) {
+            last_elements[i] = static_cast<bispec_complex_t>(buffers.elements[i]);
+        }
+        ++nrecomputed;
+        T phase {};
+        const PhaseMapElement element { detail::planned_phase(bispec, m_plan, target, phase_data, pm, buffers, m_max_pairs, phase, true) };
+        if (element.flag) {
+            pm.set(offset, element);
+            phase_data[offset] = phase;
+        }
+        moved[offset] = (element.flag != m_pm.flag(offset)) || (element.flag && std::abs(phase - previous[offset]) > m_min_change);
+    }
+    m_phases = std::move(phases);
+    m_pm = std::move(pm);
+    ++m_nupdates;
+    return nrecomputed;
+}
+
+} // namespace smip
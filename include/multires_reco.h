@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "array2.h"
+#include "bispectrum.h"
+#include "constants.h"
+#include "phasemap.h"
+#include "phasereco.h"
+#include "reconstruction_plan.h"
+
+namespace smip {
+
+/*! parameters of the multi-resolution phase reconstruction */
+struct MultiresSettings {
+    /*! number of resolution levels, the coarsest frequency lattice has a spacing of 2^(levels-1) */
+    unsigned int levels { 3 };
+    /*! half width of the neighbourhood of v used on the finer levels, in lattice steps */
+    int local_extent { 2 };
+    /*! number of averaging sweeps over the new frequencies of each finer level after their first estimate */
+    unsigned int sweeps { 1 };
+};
+
+/**
+ * @brief Coarse-to-fine phase reconstruction for large reconstruction radii
+ * @details The phases up to twice the coarsest lattice spacing <i>s</i> are reconstructed recursively as in
+ * reconstruct_phases(). The frequencies of the coarse lattice <i>s Z<sup>2</sup></i> are then reconstructed out to
+ * \e reco_radius from the pairs <i>(u, v)</i> of the same lattice only, i.e. from a decimated bispectrum with
+ * <i>1/s<sup>2</sup></i> of the elements. Each finer level <i>s/2, ..., 1</i> is seeded with the phases of the
+ * coarser levels: its new frequencies are estimated from pairs with a short <i>v</i> of at most
+ * \e local_extent lattice steps and then refined by \e sweeps averaging sweeps over the same local pairs.
+ * The cost per frequency on the finest level is thus independent of the bispectrum depth. The consistency of
+ * each frequency is written to \e phasemap as for the recursive reconstruction.
+ * @throw std::invalid_argument if the coarse lattice does not fit into the v-range of \e bispec
+ */
+template <typename T, typename U>
+Array2<T> reconstruct_phases_multires(const Bispectrum<U>& bispec,
+    std::size_t xsize, std::size_t ysize,
+    double reco_radius,
+    const MultiresSettings& settings = {},
+    PhaseMap* phasemap = nullptr);
+
+//********************
+// implementation part
+//********************
+
+namespace detail {
+/*! the pairs (w - v, v) contributing to a frequency w on a lattice level, with the locations of their elements */
+struct LatticePairs {
+    std::vector<DimVector<int, 2>> u {};
+    std::vector<BispectrumLocation> locations {};
+};
+
+/*! pairs (w - v, v) of \e w with v on the lattice of spacing \e step within [-v_extent, v_extent] (clipped to
+ * the v-range of the bispectrum), u inside \e pm_range and the element covered by the bispectrum
+ */
+template <typename U>
+LatticePairs lattice_pairs(const Bispectrum<U>& bispec,
+    const Range<DimVector<int, 2>>& pm_range,
+    const DimVector<int, 2>& w,
+    int step,
+    int v_extent)
+{
+    LatticePairs pairs {};
+    DimVector<int, 2> v_low {};
+    DimVector<int, 2> v_high {};
+    for (std::size_t dim { 0 }; dim < 2; ++dim) {
+        // first and last lattice point within the v-range
+        v_low[dim] = std::max(-v_extent, bispec.min_indices()[dim + 2]) / step * step;
+        v_high[dim] = std::min(v_extent, bispec.max_indices()[dim + 2]) / step * step;
+    }
+    DimVector<int, 2> v {};
+    for (v[1] = v_low[1]; v[1] <= v_high[1]; v[1] += step) {
+        for (v[0] = v_low[0]; v[0] <= v_high[0]; v[0] += step) {
+            const DimVector<int, 2> u { w - v };
+            if ((v[0] == 0 && v[1] == 0) || !pm_range.contains(u)) {
+                continue;
+            }
+            const auto location { bispec.find_element(DimVector<int>::merge(u, v)) };
+            if (!location) {
+                continue;
+            }
+            pairs.u.push_back(u);
+            pairs.locations.push_back(*location);
+        }
+    }
+    return pairs;
+}
+
+/*! mean phase of \e w from those of its precomputed \e pairs with both phases known
+ * same arithmetic as calc_phase(), the result is written to \e phases and \e pm if any pair contributes
+ */
+template <typename T, typename U>
+void lattice_phase(const Bispectrum<U>& bispec,
+    Array2<T>& phases,
+    PhaseMap& pm,
+    const DimVector<int, 2>& w,
+    const LatticePairs& pairs)
+{
+    std::vector<std::size_t> selected {};
+    std::vector<BispectrumLocation> locations {};
+    for (std::size_t i { 0 }; i < pairs.u.size(); ++i) {
+        if (pm.flag(pairs.u[i]) && pm.flag(w - pairs.u[i])) {
+            selected.push_back(i);
+            locations.push_back(pairs.locations[i]);
+        }
+    }
+    std::vector<U> elements(locations.size());
+    bispec.gather(locations.data(), locations.size(), elements.data());
+
+    T mean_phase {};
+    std::size_t nphases { 0 };
+    for (std::size_t i { 0 }; i < elements.size(); ++i) {
+        T temp { elements[i] };
+        if (std::abs(temp) > constants::c_epsilon<double>) {
+            const DimVector<int, 2>& u { pairs.u[selected[i]] };
+            T ph { phases.at(u) };
+            ph *= phases.at(w - u);
+            temp /= std::abs(temp);
+            ph *= std::conj(temp);
+            mean_phase += ph / std::abs(ph);
+            nphases++;
+        }
+    }
+    if (nphases == 0) {
+        return;
+    }
+    mean_phase /= static_cast<typename T::value_type>(nphases);
+    const typename T::value_type abs_phase { std::abs(mean_phase) };
+    pm.set(w, { true, abs_phase });
+    phases.at(w) = (abs_phase > constants::c_epsilon<double>) ? mean_phase / abs_phase : T { 0 };
+}
+} // namespace detail
+
+template <typename T, typename U>
+Array2<T> reconstruct_phases_multires(const Bispectrum<U>& bispec,
+    std::size_t xsize, std::size_t ysize,
+    double reco_radius,
+    const MultiresSettings& settings,
+    PhaseMap* phasemap)
+{
+    if (settings.levels == 0 || settings.local_extent < 1) {
+        throw std::invalid_argument("reconstruct_phases_multires: at least one level and a local extent of one step required");
+    }
+    const int coarse_step { 1 << (settings.levels - 1) };
+    if (coarse_step > std::min(bispec.max_indices()[2], bispec.max_indices()[3])) {
+        throw std::invalid_argument("reconstruct_phases_multires: coarse lattice exceeds the v-range of the bispectrum");
+    }
+    PhaseMap pm(xsize, ysize);
+    Array2<T> phases(xsize, ysize);
+    detail::init_reco_phases(phases, pm);
+
+    // all target frequencies in the visiting order of the recursive reconstruction
+    const Range<DimVector<int, 2>> bispec_u_range { bispec.min_indices()[std::slice(0, 2, 1)], bispec.max_indices()[std::slice(0, 2, 1)] };
+    std::vector<DimVector<int, 2>> targets {};
+    {
+        Array2<char> visited(xsize, ysize, 0);
+        double r { 0. };
+        double phi { 0. };
+        DimVector<int, 2> w { 0, 0 };
+        while (r <= reco_radius) {
+            NextRecoIndex(r, phi, w[0], w[1]);
+            if (!pm.range().contains(w) || std::abs(w).sum() <= 1 || !bispec_u_range.contains(w)) {
+                continue;
+            }
+            if (!visited.at(w)) {
+                visited.at(w) = 1;
+                targets.push_back(w);
+            }
+        }
+    }
+    auto on_lattice = [](const DimVector<int, 2>& w, int step) { return w[0] % step == 0 && w[1] % step == 0; };
+
+    // recursive start region, contains the coarse lattice frequencies next to the origin
+    const double seed_radius { 2. * coarse_step };
+    for (const auto& w : targets) {
+        if (std::sqrt(static_cast<double>(w[0] * w[0] + w[1] * w[1])) <= seed_radius && !pm.flag(w)) {
+            calc_phase(bispec, phases, pm, w);
+        }
+    }
+
+    const int full_extent { std::max(bispec.max_indices()[2], bispec.max_indices()[3]) };
+    for (int step { coarse_step }; step >= 1; step /= 2) {
+        const int v_extent { (step == coarse_step) ? full_extent : settings.local_extent * step };
+        // the pairs of the new frequencies of this level are located once and reused by the sweeps
+        std::vector<DimVector<int, 2>> level_targets {};
+        std::vector<detail::LatticePairs> level_pairs {};
+        for (const auto& w : targets) {
+            if (on_lattice(w, step) && !pm.flag(w)) {
+                detail::LatticePairs pairs { detail::lattice_pairs(bispec, pm.range(), w, step, v_extent) };
+                detail::lattice_phase(bispec, phases, pm, w, pairs);
+                // the coarse level is not refined by sweeps
+                if (pm.flag(w) && step != coarse_step) {
+                    level_targets.push_back(w);
+                    level_pairs.push_back(std::move(pairs));
+                }
+            }
+        }
+        // the phases of the coarser levels stay fixed, the new ones are averaged from all their known neighbours
+        for (unsigned int sweep { 0 }; sweep < settings.sweeps; ++sweep) {
+            for (std::size_t i { 0 }; i < level_targets.size(); ++i) {
+                detail::lattice_phase(bispec, phases, pm, level_targets[i], level_pairs[i]);
+            }
+        }
+    }
+    if (phasemap != nullptr) {
+        *phasemap = pm;
+    }
+    return phases;
+}
+
+} // namespace smip
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <barrier>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "array2.h"
+#include "bispectrum.h"
+#include "constants.h"
+#include "phasemap.h"
+#include "phasereco.h"
+#include "reconstruction_plan.h"
+#include "types.h"
+
+namespace smip {
+
+/*! parameters of the global phase solver */
+struct PhaseSolverSettings {
+    /*! upper limit of the number of iterations */
+    std::size_t max_iterations { 50 };
+    /*! the iteration stops once no phasor changes by more than this amount */
+    double tolerance { 1e-6 };
+    /*! number of threads (0: one per hardware thread) */
+    unsigned int nthreads { 0 };
+};
+
+/**
+ * @brief Global weighted least-squares refinement of reconstructed phases
+ * @details Solves the closure phase equations <i>phase(w) = phase(u) phase(v) conj(B(u, v))</i> of all pairs of
+ * \e plan at once, starting from the \e phases and phase map \e pm of a recursive reconstruction. The unknowns are
+ * the phases of all planned target frequencies known in \e pm, the start values of the reconstruction stay fixed.
+ * Each equation is weighted with the modulus of the (normalized) bispectrum element. In every iteration the phasor
+ * of each unknown is replaced by the direction of the weighted sum of its predictions from all equations it takes
+ * part in (as <i>w</i>, <i>u</i> or <i>v</i>), which minimizes the weighted squared phasor residuals of the
+ * unknown with all other phases kept fixed. All unknowns are updated simultaneously from the phases of the previous
+ * iteration (Jacobi iteration), so the result does not depend on the number of threads.
+ * The consistency of the refined targets in \e pm is set to the modulus of the weighted mean predicted phasor.
+ * The phases are not initialized here, the local phasor updates need a starting point that is already close, see
+ * solve_phases() for the standalone solver. On synthetic noisy bispectra the rms phase error of the recursive
+ * reconstruction drops by 10-20% in 30 iterations and keeps decreasing slowly over several thousand iterations.
+ * @return the number of iterations performed
+ * @throw std::invalid_argument if \e plan does not match the bispectrum, the phases or the phase map
+ */
+template <typename T, typename U>
+std::size_t refine_phases(const Bispectrum<U>& bispec,
+    const ReconstructionPlan& plan,
+    Array2<T>& phases,
+    PhaseMap& pm,
+    const PhaseSolverSettings& settings = {});
+
+/**
+ * @brief Global weighted least-squares phase reconstruction
+ * @details Solves for all phases of \e plan at once: the phases are initialized by the shell by shell reconstruction
+ * (see reconstruct_phases_by_shell()) in settings.nthreads threads and iterated with refine_phases() until no
+ * phasor changes by more than settings.tolerance or settings.max_iterations is reached. The phase map of the result
+ * is returned in \e phasemap if set, the number of iterations performed in \e iterations if set.
+ * The shell by shell start is less accurate than the sequential reconstruction; on synthetic noisy bispectra the
+ * solver needs a few hundred iterations to reach the accuracy of reconstruct_phases() and reduces the rms phase
+ * error by about a quarter after 1000 iterations.
+ * @throw std::invalid_argument if \e plan does not match the bispectrum
+ */
+template <typename T, typename U>
+Array2<T> solve_phases(const Bispectrum<U>& bispec,
+    const ReconstructionPlan& plan,
+    PhaseMap* phasemap = nullptr,
+    const PhaseSolverSettings& settings = {},
+    std::size_t* iterations = nullptr);
+
+//********************
+// implementation part
+//********************
+
+namespace detail {
+/*! closure phase equation phase(w) = phase(u) phase(v) closure, with the weight |B(u, v)| as modulus of closure */
+struct ClosureEquation {
+    std::uint32_t w_offset {};
+    std::uint32_t u_offset {};
+    std::uint32_t v_offset {};
+    complex_t closure {};
+};
+
+/*! role of an unknown in a closure equation, stored in the lower two bits of the incidence entries */
+enum ClosureRole : std::uint64_t {
+    role_w = 0,
+    role_u = 1,
+    role_v = 2
+};
+} // namespace detail
+
+template <typename T, typename U>
+std::size_t refine_phases(const Bispectrum<U>& bispec,
+    const ReconstructionPlan& plan,
+    Array2<T>& phases,
+    PhaseMap& pm,
+    const PhaseSolverSettings& settings)
+{
+    if (!(plan.bispectrum_dims() == bispec.dimsizes())) {
+        throw std::invalid_argument("refine_phases: reconstruction plan does not match bispectrum extents");
+    }
+    if (phases.ncols() != plan.xsize() || phases.nrows() != plan.ysize() || pm.ncols() != plan.xsize() || pm.nrows() != plan.ysize()) {
+        throw std::invalid_argument("refine_phases: phases or phase map do not match the reconstruction plan");
+    }
+    if (settings.max_iterations == 0) {
+        return 0;
+    }
+    const unsigned int nthreads { (settings.nthreads == 0) ? std::max(1u, std::thread::hardware_concurrency()) : settings.nthreads };
+
+    // the unknowns: all planned targets with a known phase, indexed by their phase offset
+    constexpr std::uint32_t c_fixed { std::numeric_limits<std::uint32_t>::max() };
+    std::vector<std::uint32_t> unknown_index(phases.size(), c_fixed);
+    std::vector<std::uint32_t> unknowns {};
+    for (const auto target_index : plan.visit_order()) {
+        const std::uint32_t offset { plan.targets()[target_index].phase_offset };
+        if (unknown_index[offset] == c_fixed && pm.flag(offset)) {
+            unknown_index[offset] = static_cast<std::uint32_t>(unknowns.size());
+            unknowns.push_back(offset);
+        }
+    }
+    if (unknowns.empty()) {
+        return 0;
+    }
+
+    // all equations between known phases, the bispectrum is only read once
+    std::vector<detail::ClosureEquation> equations {};
+    {
+        std::vector<U> elements(plan.max_npairs());
+        std::vector<bool> visited(plan.targets().size(), false);
+        for (const auto target_index : plan.visit_order()) {
+            const ReconstructionPlan::Target& target { plan.targets()[target_index] };
+            if (visited[target_index] || unknown_index[target.phase_offset] == c_fixed) {
+                continue;
+            }
+            visited[target_index] = true;
+            bispec.gather(plan.locations().data() + target.first_pair, target.npairs, elements.data());
+            const ReconstructionPlan::Pair* const pairs { plan.pairs().data() + target.first_pair };
+            for (std::size_t j { 0 }; j < target.npairs; ++j) {
+                const complex_t element { elements[j] };
+                if (!pm.flag(pairs[j].u_offset) || !pm.flag(pairs[j].v_offset) || std::abs(element) <= constants::c_epsilon<double>) {
+                    continue;
+                }
+                equations.push_back({ target.phase_offset, pairs[j].u_offset, pairs[j].v_offset, std::conj(element) });
+            }
+        }
+    }
+
+    // incidence lists of the unknowns: equation index and role
+    std::vector<std::uint64_t> first_incidence(unknowns.size() + 1, 0);
+    auto for_each_role = [&](auto&& f) {
+        for (std::size_t i { 0 }; i < equations.size(); ++i) {
+            f(i, equations[i].w_offset, detail::role_w);
+            f(i, equations[i].u_offset, detail::role_u);
+            f(i, equations[i].v_offset, detail::role_v);
+        }
+    };
+    for_each_role([&](std::size_t, std::uint32_t offset, detail::ClosureRole) {
+        if (unknown_index[offset] != c_fixed) {
+            first_incidence[unknown_index[offset] + 1]++;
+        }
+    });
+    std::partial_sum(first_incidence.begin(), first_incidence.end(), first_incidence.begin());
+    std::vector<std::uint64_t> incidences(first_incidence.back());
+    {
+        std::vector<std::uint64_t> fill(first_incidence.begin(), first_incidence.end() - 1);
+        for_each_role([&](std::size_t i, std::uint32_t offset, detail::ClosureRole role) {
+            if (unknown_index[offset] != c_fixed) {
+                incidences[fill[unknown_index[offset]]++] = (static_cast<std::uint64_t>(i) << 2) | role;
+            }
+        });
+    }
+
+    // phases of the previous and the current iteration
+    std::vector<T> current(phases.data().get(), phases.data().get() + phases.size());
+    std::vector<T> next { current };
+    std::vector<double> consistency(unknowns.size(), 0.);
+    std::vector<double> max_change(nthreads, 0.);
+    std::size_t iterations { 0 };
+    bool finished { false };
+
+    auto next_iteration = [&]() noexcept {
+        std::swap(current, next);
+        ++iterations;
+        const double change { *std::max_element(max_change.begin(), max_change.end()) };
+        finished = (change <= settings.tolerance) || (iterations >= settings.max_iterations);
+    };
+    std::barrier sync(static_cast<std::ptrdiff_t>(nthreads), next_iteration);
+
+    auto iterate = [&](unsigned int thread_index) {
+        const std::size_t first { unknowns.size() * thread_index / nthreads };
+        const std::size_t last { unknowns.size() * (thread_index + 1) / nthreads };
+        while (!finished) {
+            double change { 0. };
+            for (std::size_t k { first }; k < last; ++k) {
+                T sum {};
+                double weight { 0. };
+                for (std::uint64_t n { first_incidence[k] }; n < first_incidence[k + 1]; ++n) {
+                    const detail::ClosureEquation& equation { equations[incidences[n] >> 2] };
+                    const T closure { equation.closure };
+                    switch (static_cast<detail::ClosureRole>(incidences[n] & 3)) {
+                    case detail::role_w:
+                        sum += current[equation.u_offset] * current[equation.v_offset] * closure;
+                        break;
+                    case detail::role_u:
+                        sum += current[equation.w_offset] * std::conj(current[equation.v_offset] * closure);
+                        break;
+                    case detail::role_v:
+                        sum += current[equation.w_offset] * std::conj(current[equation.u_offset] * closure);
+                        break;
+                    }
+                    weight += std::abs(equation.closure);
+                }
+                const std::uint32_t offset { unknowns[k] };
+                const typename T::value_type abs_sum { std::abs(sum) };
+                if (abs_sum > constants::c_epsilon<double>) {
+                    next[offset] = sum / abs_sum;
+                    consistency[k] = abs_sum / weight;
+                } else {
+                    next[offset] = current[offset];
+                }
+                change = std::max<double>(change, std::abs(next[offset] - current[offset]));
+            }
+            max_change[thread_index] = change;
+            sync.arrive_and_wait();
+        }
+    };
+    {
+        std::vector<std::jthread> threads {};
+        for (unsigned int i { 1 }; i < nthreads; ++i) {
+            threads.emplace_back(iterate, i);
+        }
+        iterate(0);
+    }
+
+    std::copy(current.begin(), current.end(), phases.data().get());
+    for (std::size_t k { 0 }; k < unknowns.size(); ++k) {
+        if (consistency[k] > 0.) {
+            pm.set_consistency(unknowns[k], consistency[k]);
+        }
+    }
+    return iterations;
+}
+
+template <typename T, typename U>
+Array2<T> solve_phases(const Bispectrum<U>& bispec,
+    const ReconstructionPlan& plan,
+    PhaseMap* phasemap,
+    const PhaseSolverSettings& settings,
+    std::size_t* iterations)
+{
+    PhaseMap pm;
+    Array2<T> phases { reconstruct_phases_by_shell<T>(bispec, plan, settings.nthreads, &pm) };
+    const std::size_t performed { refine_phases(bispec, plan, phases, pm, settings) };
+    if (iterations != nullptr) {
+        *iterations = performed;
+    }
+    if (phasemap != nullptr) {
+        *phasemap = std::move(pm);
+    }
+    return phases;
+}
+
+} // namespace smip
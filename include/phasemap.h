@@ -1,12 +1,16 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "array2.h"
+#include "dimvector.h"
 #include "global.h"
+#include "range.h"
 
 namespace smip {
 
-template <typename T>
-class Array2;
-
 struct SMIP_PUBLIC PhaseMapElement {
     PhaseMapElement() = default;
     PhaseMapElement(bool a_flag);
@@ -17,6 +21,65 @@ struct SMIP_PUBLIC PhaseMapElement {
     double consistency { 0. };
 };
 
-typedef Array2<PhaseMapElement> PhaseMap;
+/**
+ * @brief Map of the reconstructed Fourier phases: which phases are known and how consistent they are
+ * @details The map is stored as structure of arrays: a packed bitmap with one flag per frequency, which is all the
+ * inner loops of the phase reconstruction test, and a separate plane of the consistencies in single precision.
+ * Frequencies are addressed by signed indices in the same (fftw) order as in Array2 or directly by their address
+ * offset, which equals the offset of the frequency in a phase array of the same size.
+ * Single elements read as PhaseMapElement, to_array() provides the map as Array2<PhaseMapElement>, e.g. for
+ * the image output with Array2Mat and get_phase_consistency().
+ */
+class SMIP_PUBLIC PhaseMap {
+public:
+    using s_indices = DimVector<int, 2>;
+
+    PhaseMap() = default;
+    /*! Creates a map of \e xsize x \e ysize frequencies with no phase known */
+    PhaseMap(std::size_t xsize, std::size_t ysize);
+
+    [[nodiscard]] std::size_t xsize() const noexcept { return m_xsize; }
+    [[nodiscard]] std::size_t ysize() const noexcept { return m_ysize; }
+    [[nodiscard]] std::size_t ncols() const noexcept { return m_xsize; }
+    [[nodiscard]] std::size_t nrows() const noexcept { return m_ysize; }
+    [[nodiscard]] std::size_t size() const noexcept { return m_consistency.size(); }
+    [[nodiscard]] s_indices min_sindices() const;
+    [[nodiscard]] s_indices max_sindices() const;
+    [[nodiscard]] Range<DimVector<int, 2>> range() const;
+
+    /*! address offset of the frequency with signed \e indices */
+    [[nodiscard]] std::size_t offset(s_indices indices) const noexcept;
+
+    /*! true, if the phase at address \e offset is known */
+    [[nodiscard]] bool flag(std::size_t offset) const noexcept { return (m_flags[offset >> 6] >> (offset & 63)) & 1u; }
+    [[nodiscard]] bool flag(const s_indices& indices) const noexcept { return flag(offset(indices)); }
+    /*! consistency of the phase at address \e offset */
+    [[nodiscard]] double consistency(std::size_t offset) const noexcept { return m_consistency[offset]; }
+    [[nodiscard]] double consistency(const s_indices& indices) const noexcept { return consistency(offset(indices)); }
+    [[nodiscard]] PhaseMapElement operator[](std::size_t offset) const noexcept { return { flag(offset), consistency(offset) }; }
+    [[nodiscard]] PhaseMapElement at(const s_indices& indices) const noexcept { return (*this)[offset(indices)]; }
+
+    /*! sets flag and consistency at address \e offset */
+    void set(std::size_t offset, const PhaseMapElement& element) noexcept;
+    void set(const s_indices& indices, const PhaseMapElement& element) noexcept { set(offset(indices), element); }
+    /*! changes the consistency at address \e offset, the flag remains unchanged */
+    void set_consistency(std::size_t offset, double consistency) noexcept { m_consistency[offset] = static_cast<float>(consistency); }
+
+    /*! the consistency plane, in the order of the address offsets */
+    [[nodiscard]] const std::vector<float>& consistencies() const noexcept { return m_consistency; }
+    /*! the map as array of PhaseMapElement */
+    [[nodiscard]] Array2<PhaseMapElement> to_array() const;
+
+    /*! true, if both maps have the same size, flags and consistencies */
+    [[nodiscard]] bool operator==(const PhaseMap& other) const;
+    /*! true, if both maps have the same size and flags */
+    [[nodiscard]] bool same_flags(const PhaseMap& other) const noexcept;
+
+private:
+    std::size_t m_xsize { 0 };
+    std::size_t m_ysize { 0 };
+    std::vector<std::uint64_t> m_flags {};
+    std::vector<float> m_consistency {};
+};
 
 } // namespace smip
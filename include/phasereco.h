@@ -1,9 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include "array2.h"
 #include "constants.h"
 #include "global.h"
 #include "phasemap.h"
+#include "reconstruction_plan.h"
+#include "unit_phase_bispectrum.h"
 
 namespace smip {
 
@@ -12,13 +24,69 @@ class Bispectrum;
 template <typename T>
 class Array2;
 
+/*! criterion for the early termination of the planned reconstruction once the phase consistency has collapsed */
+struct AdaptiveRadius {
+    /*! a radial shell counts as collapsed if the mean consistency of its reconstructed frequencies is below this value */
+    double min_consistency { 0.1 };
+    /*! the reconstruction stops after this number of consecutive collapsed shells */
+    unsigned int nshells { 3 };
+    /*! result: radius of the last shell before the collapse, or the radius of the plan if the consistency did not collapse */
+    double radius { 0. };
+};
+
 template <typename T, typename U>
 Array2<T> reconstruct_phases(const Bispectrum<U>& bispec,
     std::size_t xsize, std::size_t ysize,
     double reco_radius,
     PhaseMap* phasemap = nullptr);
 
-void SMIP_PUBLIC NextRecoIndex(double& r, double& phi, int& i, int& j);
+/*! reconstruct the phases from \e bispec following the precomputed \e plan, which must match the bispectrum extents
+ * if \e max_pairs is set, each target is averaged from at most \e max_pairs of its available pairs, those with the
+ * highest weight <i>|B(u, v)| consistency(u) consistency(v)</i>
+ * if \e adaptive is set, the reconstruction stops early once the mean consistency has collapsed on
+ * adaptive->nshells consecutive shells, the radius reached is returned in adaptive->radius
+ */
+template <typename T, typename U>
+Array2<T> reconstruct_phases(const Bispectrum<U>& bispec,
+    const ReconstructionPlan& plan,
+    PhaseMap* phasemap = nullptr,
+    std::size_t max_pairs = 0,
+    AdaptiveRadius* adaptive = nullptr);
+
+/*! reconstruct the phases from \e bispec shell by shell following the precomputed \e plan in \e nthreads threads
+ * (0: one per hardware thread)
+ * All targets of a radial shell are reconstructed from the phases known at the beginning of the shell only,
+ * the results are applied after all threads have finished the shell. The result is thus independent of the
+ * number of threads, but differs slightly from reconstruct_phases(), where each target sees the phases of all
+ * targets visited before.
+ */
+template <typename T, typename U>
+Array2<T> reconstruct_phases_by_shell(const Bispectrum<U>& bispec,
+    const ReconstructionPlan& plan,
+    unsigned int nthreads,
+    PhaseMap* phasemap = nullptr,
+    std::size_t max_pairs = 0,
+    AdaptiveRadius* adaptive = nullptr);
+
+/*! reconstruct the phases from the precomputed unit phasors \e bispec following \e plan
+ * faster than the reconstruction from the bispectrum, the results agree within the precision of the phase store
+ * the pairs selected by \e max_pairs are weighted with <i>consistency(u) consistency(v)</i> only
+ */
+template <typename T, typename S>
+Array2<T> reconstruct_phases(const UnitPhaseBispectrum<S>& bispec,
+    const ReconstructionPlan& plan,
+    PhaseMap* phasemap = nullptr,
+    std::size_t max_pairs = 0,
+    AdaptiveRadius* adaptive = nullptr);
+
+/*! shell by shell reconstruction from the precomputed unit phasors \e bispec, see above */
+template <typename T, typename S>
+Array2<T> reconstruct_phases_by_shell(const UnitPhaseBispectrum<S>& bispec,
+    const ReconstructionPlan& plan,
+    unsigned int nthreads,
+    PhaseMap* phasemap = nullptr,
+    std::size_t max_pairs = 0,
+    AdaptiveRadius* adaptive = nullptr);
 
 template <typename T, typename U>
 void calc_phase(const Bispectrum<U>& bispec,
@@ -36,8 +104,14 @@ Array2<T> reconstruct_phases(const Bispectrum<U>& bispec,
     double reco_radius,
     PhaseMap* phasemap)
 {
-    PhaseMap pm(xsize, ysize);
-    Array2<T> phases(xsize, ysize);
+    return reconstruct_phases<T, U>(bispec, ReconstructionPlan(bispec, xsize, ysize, reco_radius), phasemap);
+}
+
+namespace detail {
+/*! set the start values of the reconstruction */
+template <typename T>
+void init_reco_phases(Array2<T>& phases, PhaseMap& pm)
+{
     // Startwerte fuer Reko
     constexpr T init_phase { T { 1., 0. } };
 
@@ -47,24 +121,258 @@ Array2<T> reconstruct_phases(const Bispectrum<U>& bispec,
     phases.at({ -1, 0 }) = std::conj(init_phase);
     phases.at({ 0, -1 }) = std::conj(init_phase);
 
-    pm.at({ 0, 0 }) = { true, 1.0 };
-    pm.at({ 1, 0 }) = { true, 1.0 };
-    pm.at({ 0, 1 }) = { true, 1.0 };
-    pm.at({ -1, 0 }) = { true, 1.0 };
-    pm.at({ 0, -1 }) = { true, 1.0 };
-
-    double r { 0. };
-    double phi { 0. };
-    DimVector<int, 2> pm_indices {};
-
-    while (r <= reco_radius) {
-        NextRecoIndex(r, phi, pm_indices[0], pm_indices[1]);
-        if (pm.range().contains(pm_indices)) {
-            if (!pm.at(pm_indices).flag) {
-                calc_phase(bispec, phases, pm, pm_indices);
-                //std::cout<<"calc_phase: i="<<i<<" j="<<j<<"\n";
+    pm.set({ 0, 0 }, { true, 1.0 });
+    pm.set({ 1, 0 }, { true, 1.0 });
+    pm.set({ 0, 1 }, { true, 1.0 });
+    pm.set({ -1, 0 }, { true, 1.0 });
+    pm.set({ 0, -1 }, { true, 1.0 });
+}
+
+/*! mean consistency of the frequencies reconstructed in each radial shell of a plan, for the criterion \e adaptive
+ * shells without newly reconstructed frequencies are not rated
+ */
+class ShellConsistency {
+public:
+    ShellConsistency(const ReconstructionPlan& plan, AdaptiveRadius* adaptive)
+        : m_plan(plan)
+        , m_adaptive(adaptive)
+        , m_radius(plan.shell_radius(0))
+    {
+        if (m_adaptive != nullptr) {
+            m_adaptive->radius = m_plan.reco_radius();
+        }
+    }
+    void add(const PhaseMapElement& element) noexcept
+    {
+        m_sum += element.consistency;
+        ++m_count;
+    }
+    /*! completes the rating of \e shell
+     * @return true, if the consistency has collapsed and the reconstruction is to stop
+     */
+    bool finish_shell(std::size_t shell) noexcept
+    {
+        if (m_adaptive == nullptr || m_count == 0) {
+            return false;
+        }
+        const double mean { m_sum / static_cast<double>(m_count) };
+        m_sum = 0.;
+        m_count = 0;
+        if (mean >= m_adaptive->min_consistency) {
+            m_radius = m_plan.shell_radius(shell);
+            m_collapsed = 0;
+            return false;
+        }
+        if (++m_collapsed < std::max(1u, m_adaptive->nshells)) {
+            return false;
+        }
+        m_adaptive->radius = m_radius;
+        return true;
+    }
+
+private:
+    const ReconstructionPlan& m_plan;
+    AdaptiveRadius* m_adaptive { nullptr };
+    double m_radius { 0. };
+    double m_sum { 0. };
+    std::size_t m_count { 0 };
+    unsigned int m_collapsed { 0 };
+};
+
+/*! work buffers of planned_phase() for one thread */
+template <typename E>
+struct TargetBuffers {
+    explicit TargetBuffers(const ReconstructionPlan& plan)
+        : elements(plan.max_npairs())
+    {
+    }
+    /*! the gathered bispectrum elements of the target */
+    std::vector<E> elements {};
+    /*! weights and indices of the pairs selected for a capped average */
+    std::vector<std::pair<double, std::uint32_t>> selection {};
+};
+
+/*! selects the at most \e max_pairs pairs of highest \e weight (0: pair does not contribute) among the \e npairs
+ * pairs of a target into \e selection, by partial sorting, and restores the order of the plan
+ */
+template <typename Weight>
+void select_pairs(std::size_t npairs, std::size_t max_pairs, Weight weight, std::vector<std::pair<double, std::uint32_t>>& selection)
+{
+    selection.clear();
+    for (std::uint32_t i { 0 }; i < npairs; ++i) {
+        const double w { weight(i) };
+        if (w > 0.) {
+            selection.emplace_back(w, i);
+        }
+    }
+    if (selection.size() > max_pairs) {
+        std::nth_element(selection.begin(), selection.begin() + static_cast<std::ptrdiff_t>(max_pairs), selection.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; });
+        selection.resize(max_pairs);
+    }
+    std::sort(selection.begin(), selection.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+}
+
+/*! mean phase of \e target from all planned pairs with phases already known in \e phase_data / \e pm
+ * same arithmetic as calc_phase(), with all index calculations taken from the plan
+ * with \e max_pairs set and exceeded, only the pairs of highest weight <i>|B| consistency(u) consistency(v)</i> are used
+ * if \e gathered is set, the bispectrum elements of the target are expected in buffers.elements already
+ * @return the phase map entry of the target, the phase is written to \e phase only if the flag is set
+ */
+template <typename T, typename U>
+PhaseMapElement planned_phase(const Bispectrum<U>& bispec,
+    const ReconstructionPlan& plan,
+    const ReconstructionPlan::Target& target,
+    const T* phase_data,
+    const PhaseMap& pm,
+    TargetBuffers<U>& buffers,
+    std::size_t max_pairs,
+    T& phase,
+    bool gathered = false)
+{
+    U* const elements { buffers.elements.data() };
+    if (!gathered) {
+        bispec.gather(plan.locations().data() + target.first_pair, target.npairs, elements);
+    }
+    T mean_phase {};
+    std::size_t nphases { 0 };
+    const ReconstructionPlan::Pair* const pairs { plan.pairs().data() + target.first_pair };
+    auto add_pair = [&](std::size_t i) {
+        const ReconstructionPlan::Pair& pair { pairs[i] };
+        if (!pm.flag(pair.u_offset) || !pm.flag(pair.v_offset)) {
+            return;
+        }
+        T temp { elements[i] };
+        T ph { phase_data[pair.u_offset] };
+        ph *= phase_data[pair.v_offset];
+        if (std::abs(temp) > constants::c_epsilon<double>) {
+            temp /= abs(temp);
+            temp = std::conj(temp);
+            ph *= temp;
+            mean_phase += ph / std::abs(ph);
+            nphases++;
+        }
+    };
+    if (max_pairs == 0 || target.npairs <= max_pairs) {
+        for (std::size_t i { 0 }; i < target.npairs; ++i) {
+            add_pair(i);
+        }
+    } else {
+        auto weight = [&](std::uint32_t i) {
+            const ReconstructionPlan::Pair& pair { pairs[i] };
+            const double norm { std::norm(static_cast<T>(elements[i])) };
+            if (!pm.flag(pair.u_offset) || !pm.flag(pair.v_offset)
+                || norm <= constants::c_epsilon<double> * constants::c_epsilon<double>) {
+                return 0.;
+            }
+            const double consistency { pm.consistency(pair.u_offset) * pm.consistency(pair.v_offset) };
+            return norm * consistency * consistency;
+        };
+        select_pairs(target.npairs, max_pairs, weight, buffers.selection);
+        for (const auto& selected : buffers.selection) {
+            add_pair(selected.second);
+        }
+    }
+    if (nphases == 0) {
+        return {};
+    }
+    mean_phase /= static_cast<typename T::value_type>(nphases);
+    const typename T::value_type abs_phase { std::abs(mean_phase) };
+    phase = (abs_phase > constants::c_epsilon<double>) ? mean_phase / abs_phase : T { 0 };
+    return { true, abs_phase };
+}
+
+/*! mean phase of \e target from the precomputed unit phasors of \e bispec, see above
+ * the phasors are products of unit phasors and are averaged without renormalization, so that the inner loop
+ * needs no square roots or divisions. A capped selection is weighted with the consistencies only
+ */
+template <typename T, typename S>
+PhaseMapElement planned_phase(const UnitPhaseBispectrum<S>& bispec,
+    const ReconstructionPlan& plan,
+    const ReconstructionPlan::Target& target,
+    const T* phase_data,
+    const PhaseMap& pm,
+    TargetBuffers<complex_t>& buffers,
+    std::size_t max_pairs,
+    T& phase)
+{
+    complex_t* const elements { buffers.elements.data() };
+    bispec.gather(plan.locations().data() + target.first_pair, target.npairs, elements);
+    T mean_phase {};
+    std::size_t nphases { 0 };
+    const ReconstructionPlan::Pair* const pairs { plan.pairs().data() + target.first_pair };
+    auto add_pair = [&](std::size_t i) {
+        const ReconstructionPlan::Pair& pair { pairs[i] };
+        if (!pm.flag(pair.u_offset) || !pm.flag(pair.v_offset) || elements[i] == complex_t {}) {
+            return;
+        }
+        T ph { phase_data[pair.u_offset] };
+        ph *= phase_data[pair.v_offset];
+        ph *= static_cast<T>(elements[i]);
+        mean_phase += ph;
+        nphases++;
+    };
+    if (max_pairs == 0 || target.npairs <= max_pairs) {
+        for (std::size_t i { 0 }; i < target.npairs; ++i) {
+            add_pair(i);
+        }
+    } else {
+        auto weight = [&](std::uint32_t i) {
+            const ReconstructionPlan::Pair& pair { pairs[i] };
+            if (!pm.flag(pair.u_offset) || !pm.flag(pair.v_offset) || elements[i] == complex_t {}) {
+                return 0.;
+            }
+            return pm.consistency(pair.u_offset) * pm.consistency(pair.v_offset);
+        };
+        select_pairs(target.npairs, max_pairs, weight, buffers.selection);
+        for (const auto& selected : buffers.selection) {
+            add_pair(selected.second);
+        }
+    }
+    if (nphases == 0) {
+        return {};
+    }
+    mean_phase /= static_cast<typename T::value_type>(nphases);
+    const typename T::value_type abs_phase { std::abs(mean_phase) };
+    phase = (abs_phase > constants::c_epsilon<double>) ? mean_phase / abs_phase : T { 0 };
+    return { true, abs_phase };
+}
+
+/*! sequential execution of \e plan on \e source (Bispectrum or UnitPhaseBispectrum) */
+template <typename T, typename Source>
+Array2<T> execute_plan(const Source& source,
+    const ReconstructionPlan& plan,
+    PhaseMap* phasemap,
+    std::size_t max_pairs,
+    AdaptiveRadius* adaptive)
+{
+    if (!(plan.bispectrum_dims() == source.dimsizes())) {
+        throw std::invalid_argument("reconstruct_phases: reconstruction plan does not match bispectrum extents");
+    }
+    PhaseMap pm(plan.xsize(), plan.ysize());
+    Array2<T> phases(plan.xsize(), plan.ysize());
+    init_reco_phases(phases, pm);
+
+    T* const phase_data { phases.data().get() };
+    TargetBuffers<typename Source::value_type> buffers(plan);
+    ShellConsistency shell_consistency(plan, adaptive);
+    for (std::size_t shell { 0 }; shell < plan.nshells(); ++shell) {
+        for (std::uint64_t visit { plan.shell_offsets()[shell] }; visit < plan.shell_offsets()[shell + 1]; ++visit) {
+            const ReconstructionPlan::Target& target { plan.targets()[plan.visit_order()[visit]] };
+            if (pm.flag(target.phase_offset)) {
+                continue;
+            }
+            T phase {};
+            const PhaseMapElement element { planned_phase(source, plan, target, phase_data, pm, buffers, max_pairs, phase) };
+            if (element.flag) {
+                pm.set(target.phase_offset, element);
+                phase_data[target.phase_offset] = phase;
+                shell_consistency.add(element);
             }
         }
+        if (shell_consistency.finish_shell(shell)) {
+            break;
+        }
     }
     if (phasemap != nullptr) {
         *phasemap = pm;
@@ -72,6 +380,140 @@ Array2<T> reconstruct_phases(const Bispectrum<U>& bispec,
     return phases;
 }
 
+/*! shell by shell execution of \e plan on \e source in \e nthreads threads */
+template <typename T, typename Source>
+Array2<T> execute_plan_by_shell(const Source& source,
+    const ReconstructionPlan& plan,
+    unsigned int nthreads,
+    PhaseMap* phasemap,
+    std::size_t max_pairs,
+    AdaptiveRadius* adaptive)
+{
+    if (!(plan.bispectrum_dims() == source.dimsizes())) {
+        throw std::invalid_argument("reconstruct_phases_by_shell: reconstruction plan does not match bispectrum extents");
+    }
+    if (nthreads == 0) {
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    PhaseMap pm(plan.xsize(), plan.ysize());
+    Array2<T> phases(plan.xsize(), plan.ysize());
+    init_reco_phases(phases, pm);
+
+    T* const phase_data { phases.data().get() };
+    struct ShellResult {
+        PhaseMapElement element {};
+        T phase {};
+    };
+    // pending targets of the current shell in the order of their first visit and their results
+    std::vector<std::uint32_t> shell_targets {};
+    std::vector<ShellResult> results {};
+    shell_targets.reserve(plan.targets().size());
+    results.reserve(plan.targets().size());
+    // last shell each target was queued for, to evaluate repeated visits only once
+    std::vector<std::size_t> queued_in_shell(plan.targets().size(), plan.nshells());
+    std::size_t shell { 0 };
+    std::atomic<std::size_t> next_target { 0 };
+    bool finished { false };
+    ShellConsistency shell_consistency(plan, adaptive);
+
+    // serial part between two shells, runs on one thread while all others wait at the barrier
+    auto next_shell = [&]() noexcept {
+        for (std::size_t i { 0 }; i < shell_targets.size(); ++i) {
+            if (results[i].element.flag) {
+                const std::uint32_t offset { plan.targets()[shell_targets[i]].phase_offset };
+                pm.set(offset, results[i].element);
+                phase_data[offset] = results[i].phase;
+                shell_consistency.add(results[i].element);
+            }
+        }
+        // the shell just completed precedes the current value of shell
+        const bool collapsed { !shell_targets.empty() && shell_consistency.finish_shell(shell - 1) };
+        shell_targets.clear();
+        for (; !collapsed && shell < plan.nshells() && shell_targets.empty(); ++shell) {
+            for (std::uint64_t visit { plan.shell_offsets()[shell] }; visit < plan.shell_offsets()[shell + 1]; ++visit) {
+                const std::uint32_t target_index { plan.visit_order()[visit] };
+                if (!pm.flag(plan.targets()[target_index].phase_offset) && queued_in_shell[target_index] != shell) {
+                    queued_in_shell[target_index] = shell;
+                    shell_targets.push_back(target_index);
+                }
+            }
+        }
+        results.assign(shell_targets.size(), ShellResult {});
+        next_target.store(0, std::memory_order_relaxed);
+        finished = shell_targets.empty();
+    };
+
+    next_shell();
+    std::barrier sync(static_cast<std::ptrdiff_t>(nthreads), next_shell);
+    // the phases and phase map are only read while a shell is processed, each result slot is written by one thread
+    auto process_shells = [&]() {
+        TargetBuffers<typename Source::value_type> buffers(plan);
+        while (!finished) {
+            for (std::size_t i { next_target.fetch_add(1, std::memory_order_relaxed) }; i < shell_targets.size();
+                 i = next_target.fetch_add(1, std::memory_order_relaxed)) {
+                const ReconstructionPlan::Target& target { plan.targets()[shell_targets[i]] };
+                results[i].element = planned_phase(source, plan, target, phase_data, pm, buffers, max_pairs, results[i].phase);
+            }
+            sync.arrive_and_wait();
+        }
+    };
+    {
+        std::vector<std::jthread> threads {};
+        for (unsigned int i { 1 }; i < nthreads; ++i) {
+            threads.emplace_back(process_shells);
+        }
+        process_shells();
+    }
+    if (phasemap != nullptr) {
+        *phasemap = pm;
+    }
+    return phases;
+}
+
+} // namespace detail
+
+template <typename T, typename U>
+Array2<T> reconstruct_phases(const Bispectrum<U>& bispec,
+    const ReconstructionPlan& plan,
+    PhaseMap* phasemap,
+    std::size_t max_pairs,
+    AdaptiveRadius* adaptive)
+{
+    return detail::execute_plan<T>(bispec, plan, phasemap, max_pairs, adaptive);
+}
+
+template <typename T, typename S>
+Array2<T> reconstruct_phases(const UnitPhaseBispectrum<S>& bispec,
+    const ReconstructionPlan& plan,
+    PhaseMap* phasemap,
+    std::size_t max_pairs,
+    AdaptiveRadius* adaptive)
+{
+    return detail::execute_plan<T>(bispec, plan, phasemap, max_pairs, adaptive);
+}
+
+template <typename T, typename U>
+Array2<T> reconstruct_phases_by_shell(const Bispectrum<U>& bispec,
+    const ReconstructionPlan& plan,
+    unsigned int nthreads,
+    PhaseMap* phasemap,
+    std::size_t max_pairs,
+    AdaptiveRadius* adaptive)
+{
+    return detail::execute_plan_by_shell<T>(bispec, plan, nthreads, phasemap, max_pairs, adaptive);
+}
+
+template <typename T, typename S>
+Array2<T> reconstruct_phases_by_shell(const UnitPhaseBispectrum<S>& bispec,
+    const ReconstructionPlan& plan,
+    unsigned int nthreads,
+    PhaseMap* phasemap,
+    std::size_t max_pairs,
+    AdaptiveRadius* adaptive)
+{
+    return detail::execute_plan_by_shell<T>(bispec, plan, nthreads, phasemap, max_pairs, adaptive);
+}
+
 template <typename T, typename U>
 void calc_phase(const Bispectrum<U>& bispec,
     Array2<T>& phases,
@@ -87,33 +529,55 @@ void calc_phase(const Bispectrum<U>& bispec,
 
     std::vector<T> phaselist {};
 
-    for (auto u : pm.range()) {
-        DimVector<int, 2> v { w - u };
-        if (bispec_v_range.contains(v)
-            && (pm.at(u).flag)
-            && (pm.at(v).flag)) {
-            T temp { bispec.get_element(DimVector<int>::merge(u, v)) };
-            // std::cout<<"bispec["<<ux<<","<<uy<<","<<vx<<","<<vy<<"]="<<temp<<"\n";
-            T ph { phases.at(u) };
-            // std::cout<<"phase["<<ux<<","<<uy<<"]="<<ph<<"\n";
-            ph *= phases.at(v);
-            if (std::abs(temp) > constants::c_epsilon<double>) {
-                temp /= abs(temp);
-                temp = std::conj(temp);
-                ph *= temp;
-                phaselist.push_back(ph / std::abs(ph));
-                // std::cout<<"phaselist entry="<<phaselist.back()<<std::endl;
+    // only pairs with v = w - u inside the v-range of the bispectrum contribute, so u is restricted to the
+    // box w - v_max <= u <= w - v_min (clipped to the phase map), which is traversed in the order of pm.range()
+    const Range<DimVector<int, 2>> pm_range { pm.range() };
+    DimVector<int, 2> u_min { w - bispec_v_range.high };
+    DimVector<int, 2> u_max { w - bispec_v_range.low };
+    for (std::size_t dim { 0 }; dim < 2; ++dim) {
+        u_min[dim] = std::max(u_min[dim], pm_range.low[dim]);
+        u_max[dim] = std::min(u_max[dim], pm_range.high[dim]);
+    }
+    // locate the elements of all contributing pairs first and fetch them with one gather
+    std::vector<DimVector<int, 2>> pair_u {};
+    std::vector<BispectrumLocation> locations {};
+    DimVector<int, 2> u {};
+    for (u[1] = u_min[1]; u[1] <= u_max[1]; ++u[1]) {
+        for (u[0] = u_min[0]; u[0] <= u_max[0]; ++u[0]) {
+            const DimVector<int, 2> v { w - u };
+            if (!pm.flag(u) || !pm.flag(v)) {
+                continue;
+            }
+            const auto location { bispec.find_element(DimVector<int>::merge(u, v)) };
+            if (!location) {
+                // not covered by the bispectrum, the pair can never contribute
+                continue;
             }
+            pair_u.push_back(u);
+            locations.push_back(*location);
+        }
+    }
+    std::vector<U> elements(locations.size());
+    bispec.gather(locations.data(), locations.size(), elements.data());
+
+    for (std::size_t i { 0 }; i < elements.size(); ++i) {
+        T temp { elements[i] };
+        T ph { phases.at(pair_u[i]) };
+        ph *= phases.at(w - pair_u[i]);
+        if (std::abs(temp) > constants::c_epsilon<double>) {
+            temp /= abs(temp);
+            temp = std::conj(temp);
+            ph *= temp;
+            phaselist.push_back(ph / std::abs(ph));
         }
     }
 
     T mean_phase { std::accumulate(phaselist.begin(), phaselist.end(), T {}, std::plus<T>()) };
     if (!phaselist.empty()) {
-        pm.at(w).flag = true;
-        mean_phase /= static_cast<double>(phaselist.size());
+        mean_phase /= static_cast<typename T::value_type>(phaselist.size());
         //         std::cout<<"wx="<<wx<<" wy="<<wy<<" multipl="<<phaselist.size()<<" mean phase="<<mean_phase<<" consis="<<std::abs(mean_phase)<<std::endl;
-        const double abs_phase { std::abs(mean_phase) };
-        pm.at(w).consistency = abs_phase;
+        const typename T::value_type abs_phase { std::abs(mean_phase) };
+        pm.set(w, { true, abs_phase });
         if (abs_phase > constants::c_epsilon<double>) {
             phases.at(w) = mean_phase / abs_phase;
         } else {
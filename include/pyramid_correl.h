@@ -0,0 +1,217 @@
+#pragma once
+
+#include "array2.h"
+#include "crosscorrel.h"
+#include "dimvector.h"
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+namespace smip {
+
+/**
+ * @brief Coarse-to-fine registration of large frames wrt. a reference frame
+ * @tparam T array element value type, constrained to floating point types
+ * @details The PyramidCorrelation determines the displacement of a frame wrt. the reference frame supplied on
+ * construction in two stages. First, frame and reference binned by 2^\e levels are cross correlated by a
+ * CrossCorrelation of the binned size, which yields the displacement up to the binning factor. Second, the
+ * displacement is refined at full resolution by the direct correlation of a crop of \e crop_size pixels
+ * around the brightest region of the reference frame with the frame, evaluated for the displacements inside a
+ * search window around the coarse estimate. The half width of the window adapts to the deviations of the refined
+ * from the coarse displacement of the recent frames, starting at half the binning factor, and is doubled while the
+ * maximum is found at the border of the window. Compared to the CrossCorrelation of the full frames, which
+ * costs two full-size ffts per frame, the registration costs two ffts of the binned size and the small direct
+ * correlation. The interface follows CrossCorrelation: the displacement is returned by
+ * {@link #operator()(const Array2<T>&) operator()} and afterwards available through {@link #get_displacement()}.
+ * The crop of the reference frame must contain structure, e.g. the object, in order to register the frames.
+ */
+template <typename T>
+requires std::floating_point<T>
+class PyramidCorrelation {
+public:
+    PyramidCorrelation() = delete;
+    /*! Creates the registration wrt. \e ref, binning the frames by 2^\e levels for the coarse stage
+     * @throw std::invalid_argument if \e levels is 0 or the binned frame is smaller than 4 x 4 pixels
+     */
+    explicit PyramidCorrelation(const Array2<T>& ref, std::size_t levels = 2, std::size_t crop_size = 64);
+    PyramidCorrelation(const PyramidCorrelation&) = delete;
+    PyramidCorrelation& operator=(const PyramidCorrelation&) = delete;
+
+    auto operator()(const Array2<T>& frame) -> DimVector<int, 2>;
+    auto get_displacement() const -> DimVector<int, 2>;
+
+    [[nodiscard]] std::size_t binning() const noexcept { return m_binning; }
+    /*! half width of the search window of the next refinement */
+    [[nodiscard]] int window() const;
+
+private:
+    /*! displacement maximizing the direct correlation of the crop inside \e half_width around \e center */
+    auto refine(const Array2<T>& frame, const DimVector<int, 2>& center, int half_width, bool& at_border) const -> DimVector<int, 2>;
+
+    static constexpr std::size_t c_history { 16 };
+
+    std::size_t m_binning { 4 };
+    Array2<T> m_binned {};
+    CrossCorrelation<T> m_coarse;
+    /*! mean subtracted crop of the reference frame at m_crop_origin */
+    Array2<double> m_crop {};
+    DimVector<int, 2> m_crop_origin { 0, 0 };
+    std::size_t m_xsize { 0 };
+    std::size_t m_ysize { 0 };
+    /*! deviations (max norm) of the refined from the coarse displacement of the recent frames */
+    std::deque<int> m_deviations {};
+    DimVector<int, 2> m_shift { 0, 0 };
+    bool m_ready { false };
+};
+
+//********************
+// implementation part
+//********************
+
+namespace detail {
+/*! sum over blocks of \e binning x \e binning pixels of \e src into \e dest, remaining pixels are dropped */
+template <typename T>
+void bin_frame(const Array2<T>& src, std::size_t binning, Array2<T>& dest)
+{
+    const T* const data { src.data().get() };
+    T* const binned { dest.data().get() };
+    std::fill(dest.begin(), dest.end(), T {});
+    for (std::size_t y { 0 }; y < dest.nrows() * binning; ++y) {
+        T* const row { binned + (y / binning) * dest.ncols() };
+        const T* const src_row { data + y * src.ncols() };
+        for (std::size_t x { 0 }; x < dest.ncols() * binning; ++x) {
+            row[x / binning] += src_row[x];
+        }
+    }
+}
+
+template <typename T>
+Array2<T> binned_frame(const Array2<T>& src, std::size_t binning)
+{
+    if (binning == 0 || src.ncols() / binning < 4 || src.nrows() / binning < 4) {
+        throw std::invalid_argument("PyramidCorrelation: binned frame too small");
+    }
+    Array2<T> binned(src.ncols() / binning, src.nrows() / binning);
+    bin_frame(src, binning, binned);
+    return binned;
+}
+} // namespace detail
+
+template <typename T>
+requires std::floating_point<T>
+PyramidCorrelation<T>::PyramidCorrelation(const Array2<T>& ref, std::size_t levels, std::size_t crop_size)
+    : m_binning((levels > 0 && levels < 16) ? std::size_t { 1 } << levels : 0)
+    , m_binned(detail::binned_frame(ref, m_binning))
+    , m_coarse(m_binned)
+    , m_xsize(ref.ncols())
+    , m_ysize(ref.nrows())
+{
+    // the crop is centered at the brightest block of the binned reference
+    const auto max_it { std::max_element(m_binned.begin(), m_binned.end()) };
+    const auto index { static_cast<std::size_t>(std::distance(m_binned.begin(), max_it)) };
+    const std::size_t crop_xsize { std::min(crop_size, m_xsize) };
+    const std::size_t crop_ysize { std::min(crop_size, m_ysize) };
+    const auto origin = [&](std::size_t block, std::size_t size, std::size_t crop) {
+        const std::size_t center { block * m_binning + m_binning / 2 };
+        return static_cast<int>(std::min(center - std::min(center, crop / 2), size - crop));
+    };
+    m_crop_origin = { origin(index % m_binned.ncols(), m_xsize, crop_xsize), origin(index / m_binned.ncols(), m_ysize, crop_ysize) };
+    m_crop = Array2<double>(crop_xsize, crop_ysize);
+    double mean { 0. };
+    for (std::size_t y { 0 }; y < crop_ysize; ++y) {
+        for (std::size_t x { 0 }; x < crop_xsize; ++x) {
+            m_crop(x, y) = ref(x + m_crop_origin[0], y + m_crop_origin[1]);
+            mean += m_crop(x, y);
+        }
+    }
+    mean /= static_cast<double>(m_crop.size());
+    // with the mean subtracted the score does not favour displacements covering brighter parts of the frame
+    std::transform(m_crop.begin(), m_crop.end(), m_crop.begin(), [mean](double val) { return val - mean; });
+}
+
+template <typename T>
+requires std::floating_point<T>
+int PyramidCorrelation<T>::window() const
+{
+    const int deviation { m_deviations.empty() ? 0 : *std::max_element(m_deviations.begin(), m_deviations.end()) };
+    return std::max(static_cast<int>(m_binning / 2), deviation + 1);
+}
+
+template <typename T>
+requires std::floating_point<T>
+auto PyramidCorrelation<T>::refine(const Array2<T>& frame, const DimVector<int, 2>& center, int half_width, bool& at_border) const -> DimVector<int, 2>
+{
+    const T* const data { frame.data().get() };
+    const int xsize { static_cast<int>(m_xsize) };
+    const int ysize { static_cast<int>(m_ysize) };
+    const int crop_xsize { static_cast<int>(m_crop.ncols()) };
+    const int crop_ysize { static_cast<int>(m_crop.nrows()) };
+    double best_score { -std::numeric_limits<double>::infinity() };
+    DimVector<int, 2> best { center };
+    for (int dy { center[1] - half_width }; dy <= center[1] + half_width; ++dy) {
+        for (int dx { center[0] - half_width }; dx <= center[0] + half_width; ++dx) {
+            // crop pixels displaced outside the frame do not contribute
+            const int x0 { std::max(0, -(m_crop_origin[0] + dx)) };
+            const int x1 { std::min(crop_xsize, xsize - (m_crop_origin[0] + dx)) };
+            const int y0 { std::max(0, -(m_crop_origin[1] + dy)) };
+            const int y1 { std::min(crop_ysize, ysize - (m_crop_origin[1] + dy)) };
+            double score { 0. };
+            for (int y { y0 }; y < y1; ++y) {
+                const double* const crop_row { m_crop.data().get() + y * crop_xsize };
+                const T* const frame_row { data + (y + m_crop_origin[1] + dy) * xsize + m_crop_origin[0] + dx };
+                for (int x { x0 }; x < x1; ++x) {
+                    score += crop_row[x] * frame_row[x];
+                }
+            }
+            if (score > best_score) {
+                best_score = score;
+                best = { dx, dy };
+            }
+        }
+    }
+    at_border = std::abs(best[0] - center[0]) == half_width || std::abs(best[1] - center[1]) == half_width;
+    return best;
+}
+
+template <typename T>
+requires std::floating_point<T>
+auto PyramidCorrelation<T>::operator()(const Array2<T>& frame) -> DimVector<int, 2>
+{
+    if ((frame.ncols() != m_xsize) || (frame.nrows() != m_ysize)) {
+        throw std::invalid_argument("Matrix dimensions must match for correlation");
+    }
+    detail::bin_frame(frame, m_binning, m_binned);
+    const DimVector<int, 2> binned_shift { m_coarse(m_binned) };
+    const DimVector<int, 2> coarse { binned_shift[0] * static_cast<int>(m_binning), binned_shift[1] * static_cast<int>(m_binning) };
+    const int max_width { static_cast<int>(std::max(m_xsize, m_ysize) / 2) };
+    int half_width { window() };
+    bool at_border { true };
+    DimVector<int, 2> shift { coarse };
+    while (at_border && half_width <= max_width) {
+        shift = refine(frame, coarse, half_width, at_border);
+        half_width *= 2;
+    }
+    m_deviations.push_back(std::max(std::abs(shift[0] - coarse[0]), std::abs(shift[1] - coarse[1])));
+    if (m_deviations.size() > c_history) {
+        m_deviations.pop_front();
+    }
+    m_shift = shift;
+    m_ready = true;
+    return m_shift;
+}
+
+template <typename T>
+requires std::floating_point<T>
+auto PyramidCorrelation<T>::get_displacement() const -> DimVector<int, 2>
+{
+    if (!m_ready)
+        throw std::bad_function_call();
+    return m_shift;
+}
+
+} // namespace smip
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bispectrum.h"
+#include "dimvector.h"
+#include "global.h"
+#include "range.h"
+#include "types.h"
+
+namespace smip {
+
+void SMIP_PUBLIC NextRecoIndex(double& r, double& phi, int& i, int& j);
+
+/**
+ * @brief Precomputed index arithmetic of the phase reconstruction from a bispectrum
+ * @details The ReconstructionPlan holds everything the phase reconstruction needs to know about the geometry of
+ * the problem, independent of the actual bispectrum values: the sequence in which the target frequencies
+ * <i>w</i> are visited (as generated by NextRecoIndex), the list of contributing pairs <i>(u, v = w - u)</i>
+ * of each target and, for each pair, the storage location of the bispectrum element <i>B(u, v)</i> together with
+ * the conjugation required by the bispectrum symmetries, ready for {@link Bispectrum#gather}. Frequencies are stored as address offsets into
+ * the phase array and phase map. The visits are grouped into radial shells of unit width (see {@link #shell_offsets}).
+ * A plan depends only on the phase map size, the reconstruction radius and the extents of the bispectrum.
+ * It can be reused for any number of reconstructions with matching parameters (see {@link #matches}) and
+ * cached on disk with {@link #write_to_file(const std::string&) write_to_file} and
+ * {@link #read_from_file(const std::string&) read_from_file}.
+ */
+class SMIP_PUBLIC ReconstructionPlan {
+public:
+    using bispectrum_extents = DimVector<std::size_t, 4>;
+
+    /*! contributing pair (u, v) of a target frequency */
+    struct Pair {
+        std::uint32_t u_offset {};
+        std::uint32_t v_offset {};
+    };
+    /*! target frequency w with its range of pairs within pairs() and locations() */
+    struct Target {
+        std::uint32_t phase_offset {};
+        std::uint32_t npairs {};
+        std::uint64_t first_pair {};
+    };
+
+    ReconstructionPlan() = default;
+    /*! Creates the plan for the reconstruction of phases of size \e xsize x \e ysize up to radius \e reco_radius
+     * from bispectra with the extents of \e bispectrum
+     */
+    template <concept_complex T>
+    ReconstructionPlan(const Bispectrum<T>& bispectrum, std::size_t xsize, std::size_t ysize, double reco_radius);
+
+    /*! true, if the plan was created for the given parameters */
+    [[nodiscard]] bool matches(const bispectrum_extents& bispectrum_dims, std::size_t xsize, std::size_t ysize, double reco_radius) const noexcept;
+    /*! Write plan to binary file <i>filename</i> */
+    void write_to_file(const std::string& filename) const;
+    /*! Read plan from binary file <i>filename</i> */
+    void read_from_file(const std::string& filename);
+
+    [[nodiscard]] std::size_t xsize() const noexcept { return m_xsize; }
+    [[nodiscard]] std::size_t ysize() const noexcept { return m_ysize; }
+    [[nodiscard]] double reco_radius() const noexcept { return m_reco_radius; }
+    [[nodiscard]] bispectrum_extents bispectrum_dims() const noexcept { return m_bispectrum_dims; }
+    /*! indices into targets() in the order of visit, a target is visited again if it could not be reconstructed */
+    [[nodiscard]] const std::vector<std::uint32_t>& visit_order() const noexcept { return m_visit_order; }
+    [[nodiscard]] const std::vector<Target>& targets() const noexcept { return m_targets; }
+    [[nodiscard]] const std::vector<Pair>& pairs() const noexcept { return m_pairs; }
+    /*! bispectrum element location B(u, v) of each pair */
+    [[nodiscard]] const std::vector<BispectrumLocation>& locations() const noexcept { return m_locations; }
+    /*! largest number of pairs of a target */
+    [[nodiscard]] std::size_t max_npairs() const noexcept;
+    /*! indices into visit_order() where the visits of each radial shell begin, followed by the total number of visits */
+    [[nodiscard]] const std::vector<std::uint64_t>& shell_offsets() const noexcept { return m_shell_offsets; }
+    [[nodiscard]] std::size_t nshells() const noexcept { return m_shell_offsets.size() - 1; }
+    /*! radius of the frequencies visited in \e shell, the first shell is visited at radius 1 */
+    [[nodiscard]] double shell_radius(std::size_t shell) const noexcept { return static_cast<double>(shell + 1); }
+    /*! address offset of frequency \e indices in the phase array (fftw order) */
+    [[nodiscard]] std::uint32_t phase_offset(const DimVector<int, 2>& indices) const noexcept;
+
+private:
+    std::size_t m_xsize { 0 };
+    std::size_t m_ysize { 0 };
+    double m_reco_radius { 0. };
+    bispectrum_extents m_bispectrum_dims { 0, 0, 0, 0 };
+    std::vector<std::uint32_t> m_visit_order {};
+    std::vector<Target> m_targets {};
+    std::vector<Pair> m_pairs {};
+    std::vector<BispectrumLocation> m_locations {};
+    std::vector<std::uint64_t> m_shell_offsets { 0 };
+};
+
+//********************
+// implementation part
+//********************
+
+template <concept_complex T>
+ReconstructionPlan::ReconstructionPlan(const Bispectrum<T>& bispectrum, std::size_t xsize, std::size_t ysize, double reco_radius)
+    : m_xsize(xsize)
+    , m_ysize(ysize)
+    , m_reco_radius(reco_radius)
+    , m_bispectrum_dims(bispectrum.dimsizes())
+{
+    const DimVector<int, 2> pm_low { -static_cast<int>(xsize) / 2, -static_cast<int>(ysize) / 2 };
+    const DimVector<int, 2> pm_high { pm_low[0] + static_cast<int>(xsize) - 1, pm_low[1] + static_cast<int>(ysize) - 1 };
+    const Range<DimVector<int, 2>> pm_range { pm_low, pm_high };
+    const Range<DimVector<int, 2>> bispec_u_range { bispectrum.min_indices()[std::slice(0, 2, 1)], bispectrum.max_indices()[std::slice(0, 2, 1)] };
+    const Range<DimVector<int, 2>> bispec_v_range { bispectrum.min_indices()[std::slice(2, 2, 1)], bispectrum.max_indices()[std::slice(2, 2, 1)] };
+
+    // target index of each frequency of the phase map, -1 if not yet planned
+    std::vector<std::int64_t> target_index(xsize * ysize, -1);
+    m_shell_offsets.clear();
+    double r { 0. };
+    double phi { 0. };
+    DimVector<int, 2> w { 0, 0 };
+    while (r <= reco_radius) {
+        const double shell_radius { r };
+        NextRecoIndex(r, phi, w[0], w[1]);
+        if (m_shell_offsets.empty() || r != shell_radius) {
+            m_shell_offsets.push_back(m_visit_order.size());
+        }
+        // same conditions under which calc_phase() returns without action
+        if (!pm_range.contains(w) || std::abs(w).sum() <= 1 || !bispec_u_range.contains(w)) {
+            continue;
+        }
+        const std::uint32_t w_offset { phase_offset(w) };
+        if (target_index[w_offset] < 0) {
+            target_index[w_offset] = static_cast<std::int64_t>(m_targets.size());
+            Target target { w_offset, 0, m_pairs.size() };
+            // pairs with v = w - u inside the v-range of the bispectrum, in the order of the phase map range
+            DimVector<int, 2> u_min { w - bispec_v_range.high };
+            DimVector<int, 2> u_max { w - bispec_v_range.low };
+            for (std::size_t dim { 0 }; dim < 2; ++dim) {
+                u_min[dim] = std::max(u_min[dim], pm_low[dim]);
+                u_max[dim] = std::min(u_max[dim], pm_high[dim]);
+            }
+            DimVector<int, 2> u {};
+            DimVector<int, 2> v {};
+            typename Bispectrum<T>::s_indices uv {};
+            for (u[1] = u_min[1]; u[1] <= u_max[1]; ++u[1]) {
+                for (u[0] = u_min[0]; u[0] <= u_max[0]; ++u[0]) {
+                    v[0] = w[0] - u[0];
+                    v[1] = w[1] - u[1];
+                    uv[0] = u[0];
+                    uv[1] = u[1];
+                    uv[2] = v[0];
+                    uv[3] = v[1];
+                    const auto location { bispectrum.find_element(uv) };
+                    if (!location) {
+                        // not covered by the bispectrum, the pair can never contribute
+                        continue;
+                    }
+                    m_pairs.push_back({ phase_offset(u), phase_offset(v) });
+                    m_locations.push_back(*location);
+                    target.npairs++;
+                }
+            }
+            m_targets.push_back(target);
+        }
+        m_visit_order.push_back(static_cast<std::uint32_t>(target_index[w_offset]));
+    }
+    m_shell_offsets.push_back(m_visit_order.size());
+}
+
+} // namespace smip
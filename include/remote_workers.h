@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "array2.h"
+#include "frame_accumulator.h"
+#include "global.h"
+#include "types.h"
+#include "worker_protocol.h"
+
+namespace smip::net {
+
+struct WorkerAddress {
+    std::string host {};
+    std::uint16_t port { c_default_port };
+};
+
+/*! parse a comma separated list of worker addresses <i>host[:port]</i> */
+[[nodiscard]] std::vector<WorkerAddress> SMIP_PUBLIC parse_worker_list(const std::string& list);
+
+/**
+ * @brief accumulate a frame range of a video on remote smip-worker processes
+ * @details The frames [<i>first_frame</i>, <i>first_frame</i>+<i>count</i>) of the video \e filename are split into
+ * chunks of \e chunk_size frames (0 selects about four chunks per worker). Each worker has at most one outstanding
+ * chunk, a new chunk is only handed out after the result of the previous one was received, such that fast workers
+ * take over more chunks than slow ones. Each worker decodes its chunks locally, thus \e filename must be reachable
+ * under the same path on all worker nodes. The returned sums are merged into \e accumulator.
+ * If a worker fails, its connection drops, it returns fewer frames than requested or no result arrives within
+ * \e chunk_timeout after the chunk was sent, it is removed from the pool and its outstanding chunk is resent
+ * to the remaining workers.
+ * @return the number of frames merged into \e accumulator, which is smaller than \e count only if all workers failed
+ */
+std::size_t SMIP_PUBLIC accumulate_frames_remote(const std::vector<WorkerAddress>& workers,
+    const std::string& filename,
+    color_channel_t color_channel,
+    const Array2<double>& ref_frame,
+    std::size_t first_frame,
+    std::size_t count,
+    std::size_t chunk_size,
+    FrameAccumulator& accumulator,
+    std::chrono::milliseconds chunk_timeout = std::chrono::minutes { 10 });
+
+} // namespace smip::net
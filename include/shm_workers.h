@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "array2.h"
+#include "frame_accumulator.h"
+#include "global.h"
+#include "types.h"
+
+namespace smip {
+
+/**
+ * @brief accumulate a frame range of a video in forked worker processes
+ * @details The frames [<i>first_frame</i>, <i>first_frame</i>+<i>count</i>) of the video \e filename are split into
+ * \e nprocesses disjoint, contiguous chunks. Each chunk is processed by a forked child process with its own
+ * FrameExtractor (and thus its own decoder instance) and single-threaded ffts, registering the frames wrt. \e ref_frame and accumulating
+ * bispectrum, power spectrum and sum image into a private partition of an anonymous POSIX shared memory segment.
+ * After all children terminated, the parent reduces the partitions in place into \e accumulator.
+ * A crashing or failing worker only loses its own chunk: its partition is discarded and an error is logged.
+ * The chunk of a worker which can not be forked is accumulated in the calling process instead.
+ * @return the number of frames merged into \e accumulator
+ * @throws std::runtime_error if the shared memory segment can not be created, if the video can not be opened for
+ * the chunk of a worker which could not be forked, or on platforms without fork()
+ */
+std::size_t SMIP_PUBLIC accumulate_frames_forked(const std::string& filename,
+    color_channel_t color_channel,
+    const Array2<double>& ref_frame,
+    std::size_t first_frame,
+    std::size_t count,
+    std::size_t nprocesses,
+    FrameAccumulator& accumulator);
+
+} // namespace smip
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <deque>
+#include <stdexcept>
+
+#include "array2.h"
+#include "bispectrum.h"
+#include "frame_spectrum.h"
+#include "types.h"
+
+namespace smip {
+
+/**
+ * @brief Running bispectrum and power spectrum over a sliding window of frame spectra
+ * @tparam T value type of the bispectrum
+ * @tparam F value type of the stored frame spectra
+ * @details The SlidingBispectrum keeps a ring of the last <i>window</i> frame spectra (fft of the frames),
+ * stored as FrameSpectrum restricted to the frequency region of the bispectrum.
+ * Each new spectrum passed to {@link #add_frame(const Array2<U>&) add_frame} is accumulated to the
+ * running bispectrum and power spectrum, while the oldest spectrum is subtracted as soon as the window is
+ * full. A window is complete every <i>step</i> frames, after which the normalized bispectrum and power spectrum
+ * of the current window can be retrieved with {@link #bispectrum()} and {@link #powerspectrum()}, the latter as real
+ * half-plane in the layout of fftw's r2c transform.
+ * Choosing a single precision type for F (e.g. bispec_complex_t) halves the memory of the ring. Both the
+ * accumulation and the subtraction are carried out from the stored copy, such that adding and removing a
+ * frame are exact mirrors of each other. The residual rounding drift of the running sums is removed by
+ * re-accumulating the window from the ring every {@link #c_resync_windows} windows.
+ */
+template <concept_complex T, concept_complex F = T>
+class SlidingBispectrum {
+public:
+    using extents = typename Bispectrum<T>::extents;
+
+    /*! number of completed windows after which the running sums are rebuilt from the ring */
+    static constexpr std::size_t c_resync_windows { 64 };
+
+    SlidingBispectrum() = delete;
+    /*! Creates SlidingBispectrum with bispectrum sizes [<i>i,j,k,l</i>], window size and step in frames */
+    SlidingBispectrum(const extents& dimsizes, std::size_t window, std::size_t step);
+
+    /*! add frame spectrum \e fft to the window and remove the oldest one if the window is full */
+    template <concept_complex U>
+    void add_frame(const Array2<U>& fft);
+    /*! add compact frame spectrum \e spectrum to the window and remove the oldest one if the window is full */
+    void add_frame(const FrameSpectrum<F>& spectrum);
+    /*! true, if the last call to add_frame completed a window */
+    [[nodiscard]] bool window_complete() const noexcept;
+    /*! normalized bispectrum of the current window */
+    [[nodiscard]] Bispectrum<T> bispectrum() const;
+    /*! normalized power spectrum of the current window (real half-plane of <i>xsize/2+1</i> columns) */
+    [[nodiscard]] Array2<double> powerspectrum() const;
+    /*! recompute running bispectrum and power spectrum from the stored frame spectra */
+    void rebuild();
+
+    [[nodiscard]] std::size_t window() const noexcept { return m_window; }
+    [[nodiscard]] std::size_t step() const noexcept { return m_step; }
+    [[nodiscard]] std::size_t nframes() const noexcept { return m_ring.size(); }
+    [[nodiscard]] std::size_t frames_total() const noexcept { return m_frames_total; }
+    /*! index of the oldest frame within the current window */
+    [[nodiscard]] std::size_t first_frame() const noexcept { return m_frames_total - m_ring.size(); }
+
+private:
+    /*! frequency region of the frame spectra required by the bispectrum */
+    [[nodiscard]] typename FrameSpectrum<F>::extents max_frequency() const;
+    void check_frame_size(std::size_t xsize, std::size_t ysize);
+    /*! remove the oldest spectrum from the running sums if the window is full and return it for reuse */
+    FrameSpectrum<F> remove_oldest();
+    void push(FrameSpectrum<F>&& spectrum);
+
+    Bispectrum<T> m_bispectrum {};
+    Array2<double> m_powerspec {};
+    typename FrameSpectrum<F>::extents m_frame_sizes { 0, 0 };
+    std::deque<FrameSpectrum<F>> m_ring {};
+    std::size_t m_window {};
+    std::size_t m_step {};
+    std::size_t m_frames_total { 0 };
+    std::size_t m_windows_total { 0 };
+};
+
+//********************
+// implementation part
+//********************
+
+template <concept_complex T, concept_complex F>
+SlidingBispectrum<T, F>::SlidingBispectrum(const extents& dimsizes, std::size_t window, std::size_t step)
+    : m_bispectrum(dimsizes)
+    , m_window(window)
+    , m_step(step)
+{
+    if (m_window == 0 || m_step == 0) {
+        throw std::invalid_argument("SlidingBispectrum: window size and step must be > 0");
+    }
+}
+
+template <concept_complex T, concept_complex F>
+template <concept_complex U>
+void SlidingBispectrum<T, F>::add_frame(const Array2<U>& fft)
+{
+    check_frame_size(fft.ncols(), fft.nrows());
+    FrameSpectrum<F> spectrum { remove_oldest() };
+    if (spectrum.size() == 0) {
+        spectrum = FrameSpectrum<F>({ fft.ncols(), fft.nrows() }, max_frequency());
+    }
+    spectrum.assign(fft);
+    push(std::move(spectrum));
+}
+
+template <concept_complex T, concept_complex F>
+void SlidingBispectrum<T, F>::add_frame(const FrameSpectrum<F>& spectrum)
+{
+    check_frame_size(spectrum.frame_sizes()[0], spectrum.frame_sizes()[1]);
+    FrameSpectrum<F> recycled { remove_oldest() };
+    recycled = spectrum;
+    push(std::move(recycled));
+}
+
+template <concept_complex T, concept_complex F>
+typename FrameSpectrum<F>::extents SlidingBispectrum<T, F>::max_frequency() const
+{
+    return { m_bispectrum.dimsizes()[0] / 2, m_bispectrum.dimsizes()[1] / 2 };
+}
+
+template <concept_complex T, concept_complex F>
+void SlidingBispectrum<T, F>::check_frame_size(std::size_t xsize, std::size_t ysize)
+{
+    if (m_powerspec.size() == 0) {
+        m_frame_sizes = { xsize, ysize };
+        m_powerspec = Array2<double>(xsize / 2 + 1, ysize, 0.);
+    }
+    if (xsize != m_frame_sizes[0] || ysize != m_frame_sizes[1]) {
+        throw std::invalid_argument("SlidingBispectrum::add_frame : frame size mismatch");
+    }
+}
+
+template <concept_complex T, concept_complex F>
+FrameSpectrum<F> SlidingBispectrum<T, F>::remove_oldest()
+{
+    if (m_ring.size() < m_window) {
+        return {};
+    }
+    // remove oldest frame from the running sums and recycle its storage
+    FrameSpectrum<F> spectrum { std::move(m_ring.front()) };
+    m_ring.pop_front();
+    m_bispectrum.subtract_from_fft(spectrum);
+    spectrum.add_powerspectrum_to(m_powerspec, -1.);
+    return spectrum;
+}
+
+template <concept_complex T, concept_complex F>
+void SlidingBispectrum<T, F>::push(FrameSpectrum<F>&& spectrum)
+{
+    m_bispectrum.accumulate_from_fft(spectrum);
+    spectrum.add_powerspectrum_to(m_powerspec);
+    m_ring.push_back(std::move(spectrum));
+    m_frames_total++;
+
+    if (window_complete()) {
+        m_windows_total++;
+        if (m_windows_total % c_resync_windows == 0) {
+            rebuild();
+        }
+    }
+}
+
+template <concept_complex T, concept_complex F>
+bool SlidingBispectrum<T, F>::window_complete() const noexcept
+{
+    return (m_ring.size() == m_window) && ((m_frames_total - m_window) % m_step == 0);
+}
+
+template <concept_complex T, concept_complex F>
+Bispectrum<T> SlidingBispectrum<T, F>::bispectrum() const
+{
+    Bispectrum<T> bs { m_bispectrum };
+    bs /= T(static_cast<typename T::value_type>(m_ring.size()), 0.);
+    return bs;
+}
+
+template <concept_complex T, concept_complex F>
+Array2<double> SlidingBispectrum<T, F>::powerspectrum() const
+{
+    Array2<double> ps { m_powerspec };
+    ps /= static_cast<double>(m_ring.size() * m_frame_sizes[0] * m_frame_sizes[1]);
+    return ps;
+}
+
+template <concept_complex T, concept_complex F>
+void SlidingBispectrum<T, F>::rebuild()
+{
+    std::fill(m_bispectrum.begin(), m_bispectrum.end(), T {});
+    m_powerspec = 0.;
+    for (const auto& spectrum : m_ring) {
+        m_bispectrum.accumulate_from_fft(spectrum);
+        spectrum.add_powerspectrum_to(m_powerspec);
+    }
+}
+
+} // namespace smip
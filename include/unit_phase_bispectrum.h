@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "bispectrum.h"
+#include "constants.h"
+#include "types.h"
+
+namespace smip {
+
+/*! storage types of UnitPhaseBispectrum: unit phasor, phase angle or quantized phase */
+template <typename S>
+concept concept_unit_phase_storage = std::is_same_v<S, bispec_complex_t> || std::is_same_v<S, float> || std::is_same_v<S, std::uint16_t>;
+
+/**
+ * @brief Reconstruction-ready phase view of a normalized bispectrum
+ * @details For each stored element <i>B</i> of a Bispectrum the UnitPhaseBispectrum holds the conjugated unit phasor
+ * <i>conj(B / |B|)</i> as used by the phase reconstruction, or an invalid marker if <i>|B|</i> is below the
+ * reconstruction threshold. The storage layout is the one of the Bispectrum, so the element locations of a
+ * ReconstructionPlan apply unchanged. The phase is stored in one of the formats
+ * * bispec_complex_t: unit phasor (8 bytes, invalid: 0)
+ * * float: phase angle (4 bytes, invalid: an angle beyond pi, not NaN, which -ffast-math does not detect)
+ * * std::uint16_t: phase quantized to 15 bits with the validity in the most significant bit (2 bytes)
+ *
+ * All formats are decoded to unit phasors of type complex_t on access, invalid elements are returned as 0.
+ */
+template <concept_unit_phase_storage S>
+class UnitPhaseBispectrum {
+public:
+    using storage_type = S;
+    using value_type = complex_t;
+    using extents = typename Bispectrum<bispec_complex_t>::extents;
+    using ElementLocation = BispectrumLocation;
+
+    UnitPhaseBispectrum() = default;
+    /*! Creates the phase view of the (normalized) \e bispectrum in \e nthreads threads (0: one per hardware thread) */
+    template <concept_complex T>
+    explicit UnitPhaseBispectrum(const Bispectrum<T>& bispectrum, unsigned int nthreads = 0);
+
+    [[nodiscard]] extents dimsizes() const noexcept { return m_dimsizes; }
+    [[nodiscard]] std::size_t size() const noexcept { return m_phases.size(); }
+    /*! memory size of the phase store in bytes */
+    [[nodiscard]] std::size_t memory_size() const noexcept { return m_phases.size() * sizeof(S); }
+    /*! returns the unit phasor at \e location, 0 if invalid */
+    [[nodiscard]] value_type element_at(const ElementLocation& location) const noexcept;
+    /*! writes the unit phasors at the \e count precomputed \e locations to \e results (0 if invalid)
+     * no bounds checks are performed, see Bispectrum::gather()
+     */
+    void gather(const ElementLocation* locations, std::size_t count, value_type* results) const noexcept;
+
+    [[nodiscard]] static S encode(const value_type& phasor) noexcept;
+    [[nodiscard]] static value_type decode(S phase) noexcept;
+
+private:
+    static constexpr std::uint16_t c_valid_bit { 0x8000 };
+    /*! angle of invalid elements in the float store, outside of the range [-pi, pi] of valid angles */
+    static constexpr float c_invalid_angle { 8.f };
+    static constexpr std::uint16_t c_phase_steps { 0x8000 };
+    /*! unit phasors of the valid quantized phases, indexed by the phase step (256 kB), the quantization error of
+     * 1e-4 rad exceeds the rounding of float by far
+     */
+    [[nodiscard]] static const std::vector<std::complex<float>>& quantized_phasors();
+    [[nodiscard]] static value_type decode_quantized(std::uint16_t phase, const std::complex<float>* phasors) noexcept;
+
+    extents m_dimsizes { 0, 0, 0, 0 };
+    std::vector<S> m_phases {};
+};
+
+//********************
+// implementation part
+//********************
+
+template <concept_unit_phase_storage S>
+template <concept_complex T>
+UnitPhaseBispectrum<S>::UnitPhaseBispectrum(const Bispectrum<T>& bispectrum, unsigned int nthreads)
+    : m_dimsizes(bispectrum.dimsizes())
+    , m_phases(bispectrum.base_size())
+{
+    if (nthreads == 0) {
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const T* const data { bispectrum.data().get() };
+    // same threshold and arithmetic as the reconstruction from the bispectrum
+    auto convert = [&](std::size_t first, std::size_t last) {
+        for (std::size_t i { first }; i < last; ++i) {
+            value_type temp { data[i] };
+            const double abs_temp { std::abs(temp) };
+            if (abs_temp > constants::c_epsilon<double>) {
+                temp /= abs_temp;
+                m_phases[i] = encode(std::conj(temp));
+            } else {
+                m_phases[i] = encode(value_type {});
+            }
+        }
+    };
+    const std::size_t chunk { (m_phases.size() + nthreads - 1) / nthreads };
+    std::vector<std::jthread> threads {};
+    for (std::size_t first { chunk }; first < m_phases.size(); first += chunk) {
+        threads.emplace_back(convert, first, std::min(first + chunk, m_phases.size()));
+    }
+    convert(0, std::min(chunk, m_phases.size()));
+}
+
+template <concept_unit_phase_storage S>
+S UnitPhaseBispectrum<S>::encode(const value_type& phasor) noexcept
+{
+    const bool valid { phasor != value_type {} };
+    if constexpr (std::is_same_v<S, bispec_complex_t>) {
+        return static_cast<S>(phasor);
+    } else if constexpr (std::is_same_v<S, float>) {
+        return valid ? static_cast<float>(std::arg(phasor)) : c_invalid_angle;
+    } else {
+        if (!valid) {
+            return 0;
+        }
+        const double step { std::round(std::arg(phasor) / constants::c_2pi<double> * c_phase_steps) };
+        return static_cast<std::uint16_t>(c_valid_bit | (static_cast<long>(step) & (c_phase_steps - 1)));
+    }
+}
+
+template <concept_unit_phase_storage S>
+typename UnitPhaseBispectrum<S>::value_type UnitPhaseBispectrum<S>::decode(S phase) noexcept
+{
+    if constexpr (std::is_same_v<S, bispec_complex_t>) {
+        return static_cast<value_type>(phase);
+    } else if constexpr (std::is_same_v<S, float>) {
+        return (phase > constants::pi<float>) ? value_type {} : value_type { std::cos(phase), std::sin(phase) };
+    } else {
+        return decode_quantized(phase, quantized_phasors().data());
+    }
+}
+
+template <concept_unit_phase_storage S>
+typename UnitPhaseBispectrum<S>::value_type UnitPhaseBispectrum<S>::decode_quantized(std::uint16_t phase, const std::complex<float>* phasors) noexcept
+{
+    return (phase & c_valid_bit) ? static_cast<value_type>(phasors[phase & (c_phase_steps - 1)]) : value_type {};
+}
+
+template <concept_unit_phase_storage S>
+const std::vector<std::complex<float>>& UnitPhaseBispectrum<S>::quantized_phasors()
+{
+    static const std::vector<std::complex<float>> phasors { [] {
+        std::vector<std::complex<float>> table(c_phase_steps);
+        for (std::size_t step { 0 }; step < c_phase_steps; ++step) {
+            table[step] = static_cast<std::complex<float>>(std::polar(1., constants::c_2pi<double> * step / c_phase_steps));
+        }
+        return table;
+    }() };
+    return phasors;
+}
+
+template <concept_unit_phase_storage S>
+typename UnitPhaseBispectrum<S>::value_type UnitPhaseBispectrum<S>::element_at(const ElementLocation& location) const noexcept
+{
+    const value_type phasor { decode(m_phases[location.offset]) };
+    return location.conjugate ? std::conj(phasor) : phasor;
+}
+
+template <concept_unit_phase_storage S>
+void UnitPhaseBispectrum<S>::gather(const ElementLocation* locations, std::size_t count, value_type* results) const noexcept
+{
+    const S* const phases { m_phases.data() };
+    if constexpr (std::is_same_v<S, std::uint16_t>) {
+        const std::complex<float>* const phasors { quantized_phasors().data() };
+        for (std::size_t i { 0 }; i < count; ++i) {
+            results[i] = decode_quantized(phases[locations[i].offset], phasors);
+        }
+    } else {
+        for (std::size_t i { 0 }; i < count; ++i) {
+            results[i] = decode(phases[locations[i].offset]);
+        }
+    }
+    // the stored phasors belong to the canonical elements, conjugate as branchless sign flip
+    for (std::size_t i { 0 }; i < count; ++i) {
+        const double sign { 1. - 2. * static_cast<double>(locations[i].conjugate) };
+        results[i] = value_type { results[i].real(), results[i].imag() * sign };
+    }
+}
+
+} // namespace smip
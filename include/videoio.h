@@ -46,6 +46,12 @@ public:
     const std::string& filename() const { return m_filename; }
     inline std::size_t current_frame() const { return m_frameindex; }
     cv::Mat& extract_next_frame();
+    /*! decode the next frame into \e frame, reusing its storage if size and type match
+     * \returns false at the end of the video
+     */
+    bool extract_next_frame(cv::Mat& frame);
+    /*! position the extractor such that the next extracted frame is the one with index \e frame */
+    void seek(std::size_t frame);
 
 private:
     std::string m_filename {};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "array2.h"
+#include "bispectrum.h"
+#include "global.h"
+#include "types.h"
+#include "videoio.h"
+
+namespace smip::net {
+
+/*! default TCP port of smip-worker */
+constexpr std::uint16_t c_default_port { 7421 };
+
+struct ConnectionError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+/*! accumulation of a contiguous frame range, sent from the coordinator to a worker */
+struct AccumulationJob {
+    std::uint64_t id { 0 };
+    std::string filename {};
+    color_channel_t color_channel { color_channel_t::white };
+    std::uint64_t first_frame { 0 };
+    std::uint64_t count { 0 };
+    std::uint64_t bispectrum_depth { 0 };
+    bool with_bispectrum { true };
+    Array2<double> ref_frame {};
+    /*! upsampling factor of the subpixel registration, 0 for integer registration */
+    std::uint64_t upsampling { 0 };
+    /*! binning levels of the coarse-to-fine registration, 0 for the full-size cross correlation */
+    std::uint64_t pyramid_levels { 0 };
+    /*! transform and register the frames in single precision */
+    bool single_precision { false };
+};
+
+/*! non-normalized sums of an AccumulationJob, sent back from the worker (power spectrum as real half-plane) */
+struct AccumulationResult {
+    std::uint64_t job_id { 0 };
+    std::uint64_t nframes { 0 };
+    Bispectrum<bispec_complex_t> bispectrum {};
+    Array2<double> powerspec {};
+    Array2<double> sum {};
+};
+
+enum class MessageType : std::uint32_t {
+    Job = 1,
+    Result = 2,
+    Error = 3
+};
+
+/*! a framed protocol message: header (magic, type, payload size) followed by the payload */
+struct Message {
+    MessageType type { MessageType::Error };
+    std::vector<std::byte> payload {};
+};
+
+[[nodiscard]] std::vector<std::byte> SMIP_PUBLIC serialize(const AccumulationJob& job);
+[[nodiscard]] std::vector<std::byte> SMIP_PUBLIC serialize(const AccumulationResult& result);
+[[nodiscard]] AccumulationJob SMIP_PUBLIC deserialize_job(const std::vector<std::byte>& payload);
+[[nodiscard]] AccumulationResult SMIP_PUBLIC deserialize_result(const std::vector<std::byte>& payload);
+
+/**
+ * @brief TcpSocket class, a connected (blocking) TCP stream socket exchanging framed Messages
+ * @details The socket is closed on destruction. Transmission errors and protocol violations are
+ * reported by throwing a ConnectionError.
+ */
+class SMIP_PUBLIC TcpSocket {
+public:
+    TcpSocket() = default;
+    explicit TcpSocket(int fd);
+    TcpSocket(const TcpSocket&) = delete;
+    TcpSocket& operator=(const TcpSocket&) = delete;
+    TcpSocket(TcpSocket&& other) noexcept;
+    TcpSocket& operator=(TcpSocket&& other) noexcept;
+    ~TcpSocket();
+
+    /*! connect to \e host at \e port */
+    [[nodiscard]] static TcpSocket connect(const std::string& host, std::uint16_t port);
+
+    void send_message(MessageType type, const std::vector<std::byte>& payload);
+    /*! receive the next message, returns std::nullopt if the peer closed the connection between two messages */
+    [[nodiscard]] std::optional<Message> receive_message();
+    void close();
+    [[nodiscard]] bool is_open() const noexcept { return m_fd >= 0; }
+    [[nodiscard]] int fd() const noexcept { return m_fd; }
+
+private:
+    int m_fd { -1 };
+};
+
+/*! TcpListener class, a listening TCP socket on all interfaces */
+class SMIP_PUBLIC TcpListener {
+public:
+    /*! listen on \e port, a port of 0 selects an ephemeral port */
+    explicit TcpListener(std::uint16_t port);
+    TcpListener(const TcpListener&) = delete;
+    TcpListener& operator=(const TcpListener&) = delete;
+    ~TcpListener();
+
+    /*! block until a coordinator connects */
+    [[nodiscard]] TcpSocket accept();
+    [[nodiscard]] std::uint16_t port() const noexcept { return m_port; }
+
+private:
+    int m_fd { -1 };
+    std::uint16_t m_port { 0 };
+};
+
+using job_handler_t = std::function<AccumulationResult(const AccumulationJob&)>;
+
+/*! serve the jobs received through \e connection with \e handler until the coordinator disconnects
+ * exceptions thrown by the handler are reported back to the coordinator as Error message
+ */
+void SMIP_PUBLIC serve_worker_session(TcpSocket& connection, const job_handler_t& handler);
+
+} // namespace smip::net
@@ -4,17 +4,24 @@
 #include <sstream>
 #include <stdlib.h>
 
+#include <array>
 #include <complex>
+#include <condition_variable>
+#include <filesystem>
 #include <fstream>
 #include <functional>
+#include <iomanip>
 #include <iterator>
+#include <mutex>
 #include <numeric>
+#include <optional>
 #include <stdexcept>
+#include <stop_token>
+#include <thread>
 #include <unistd.h> // for getopt()
+#include <utility>
 #include <vector>
 
-#include <fftw3.h>
-
 #include "opencv2/core.hpp"
 #include "opencv2/core/base.hpp"
 #include "opencv2/highgui.hpp"
@@ -25,13 +32,22 @@
 
 #include "array2.h"
 #include "bispectrum.h"
-#include "crosscorrel.h"
+#include "fft_plans.h"
+#include "frame_accumulator.h"
+#include "incremental_reco.h"
 #include "log.h"
+#include "multires_reco.h"
+#include "phase_solver.h"
 #include "phasemap.h"
 #include "phasereco.h"
 #include "point.h"
+#include "reconstruction_plan.h"
 #include "rect.h"
+#include "remote_workers.h"
+#include "shm_workers.h"
+#include "sliding_bispectrum.h"
 #include "types.h"
+#include "unit_phase_bispectrum.h"
 #include "videoio.h"
 #include "window_function.h"
 
@@ -40,13 +56,63 @@ using namespace smip;
 void Usage(const char* progname)
 {
     using namespace std;
-    cout << "   Usage :  " << std::string(progname) << " [nrpbcvh?] <source root>" << endl;
+    cout << "   Usage :  " << std::string(progname) << " [nrpbwmjWPtuiaAlFfRexTUgBqcvh?] <source root>" << endl;
     cout << "    available options:" << endl;
     cout << "     -n   --nrframes    <pics>    :   process at most number of <pics> frames" << endl;
     cout << "                                      default : all frames" << endl;
     cout << "     -r   --refframe    <index>   :   index of reference frame (default : first found)" << endl;
     cout << "     -p   --recoradius  <pixels>  :   radius of phase reconstruction (default : 2 * bispectrum extent)" << endl;
     cout << "     -b   --bdepth       <pixels>  :   bispectrum extent (3rd and 4th dimension) (default : 20)" << endl;
+    cout << "     -w   --window      <frames>  :   sliding window mode: reconstruct over the last <frames> frames" << endl;
+    cout << "                                      default : off (reconstruct over all frames)" << endl;
+    cout << "     -m   --windowstep  <frames>  :   reconstruct every <frames> frames in sliding window mode" << endl;
+    cout << "                                      default : window size" << endl;
+    cout << "     -j   --processes   <n>       :   accumulate frames in <n> worker processes (default : 1)" << endl;
+    cout << "                                      not available in sliding window mode" << endl;
+    cout << "     -W   --workers <host[:port],...> : accumulate frames on remote smip-worker processes" << endl;
+    cout << "                                      the video must be reachable under the same path on all workers" << endl;
+    cout << "     -P   --plan        <file>    :   cache file of the reconstruction plan: reused if it matches" << endl;
+    cout << "                                      frame size, bispectrum depth and reco radius, (re)created otherwise" << endl;
+    cout << "     -t   --threads     <n>       :   reconstruct the phases shell by shell in <n> threads (0 : one per core)" << endl;
+    cout << "                                      default : off (sequential reconstruction)" << endl;
+    cout << "     -u   --unitphase   <p|a|q>   :   reconstruct from precomputed unit phases of the bispectrum, stored as" << endl;
+    cout << "                                      phasor (p), float angle (a) or 16-bit quantized phase (q)" << endl;
+    cout << "                                      default : off (reconstruct from the bispectrum)" << endl;
+    cout << "     -i   --iterations  <n>       :   refine the recursively reconstructed phases by at most <n> iterations of" << endl;
+    cout << "                                      a global least-squares pass, in the threads given with -t (default : one per core)" << endl;
+    cout << "                                      default : 0 (off)" << endl;
+    cout << "     -a   --maxpairs    <n>       :   average each frequency from at most <n> (u,v) pairs, those with the highest" << endl;
+    cout << "                                      bispectrum modulus and phase consistency" << endl;
+    cout << "                                      default : 0 (all pairs)" << endl;
+    cout << "     -A   --adaptive    <c>       :   stop the reconstruction once the mean phase consistency of 3 consecutive" << endl;
+    cout << "                                      shells is below <c>, the window function follows the radius reached" << endl;
+    cout << "                                      default : off (reconstruct up to the reco radius), not with -l" << endl;
+    cout << "     -l   --levels      <n>       :   coarse-to-fine reconstruction on <n> frequency lattices (spacing 2^(n-1) to 1)" << endl;
+    cout << "                                      without reconstruction plan, -u and -a are ignored, -t unless with -i" << endl;
+    cout << "                                      default : 0 (off)" << endl;
+    cout << "     -F   --float                 :   reconstruct and window the phases in single precision" << endl;
+    cout << "          --floatfft              :   transform and register the frames in single precision" << endl;
+    cout << "                                      default : double precision" << endl;
+    cout << "     -R   --preview     <frames>  :   reconstruct a preview image every <frames> frames in a background thread" << endl;
+    cout << "                                      default : 0 (off), not with -w, -j or -W" << endl;
+    cout << "     -e   --fftrigor    <e|m|p>   :   planner rigor of the fft plans: estimate (e), measure (m) or patient (p)" << endl;
+    cout << "                                      default : e (estimate)" << endl;
+    cout << "     -x   --wisdom      <file>    :   cache file of the fftw wisdom: loaded on startup if it exists, written on exit" << endl;
+    cout << "                                      default : off" << endl;
+    cout << "     -T   --fftthreads  <n>       :   execute large ffts in up to <n> threads (0 : one per core), the number of" << endl;
+    cout << "                                      threads per transform size is measured on startup, the worker processes" << endl;
+    cout << "                                      of -j run single-threaded ffts" << endl;
+    cout << "                                      default : 1 (single-threaded ffts)" << endl;
+    cout << "     -U   --upsampling  <factor>  :   register the frames with a precision of 1/<factor> pixel and add them to the" << endl;
+    cout << "                                      sum image shifted by a Fourier phase ramp" << endl;
+    cout << "                                      default : 0 (integer registration)" << endl;
+    cout << "     -g   --pyramid     <levels>  :   register the frames coarse-to-fine: correlate the frames binned by 2^<levels>," << endl;
+    cout << "                                      then refine on a 64 pixel crop at full resolution" << endl;
+    cout << "                                      default : 0 (full-size cross correlation), not with -U" << endl;
+    cout << "     -B   --batch       <frames>  :   number of frames transformed together by one batched fft" << endl;
+    cout << "                                      default : 1 (one fft per frame)" << endl;
+    cout << "     -q   --prefetch    <frames>  :   decode up to <frames> frames ahead in a background thread" << endl;
+    cout << "                                      default : 0 (decode synchronously)" << endl;
     cout << "     -c   --channel     <r|g|b|i> :   color channel (default: i)" << endl;
     cout << "          --calcsum               :   calculate picture sum and shifted sum (default)" << endl;
     cout << "          --no-calcsum            :   do not calculate picture sum and shifted sum" << endl;
@@ -65,6 +131,381 @@ void Usage(const char* progname)
     cout << endl;
 }
 
+/*! loads the fftw wisdom from \e filename (if set and existing) on construction and writes it back on destruction,
+ * so that the plans of the next run, created with the same rigor, need no planning time
+ */
+class WisdomCache {
+public:
+    explicit WisdomCache(std::string filename)
+        : m_filename(std::move(filename))
+    {
+        if (!m_filename.empty() && std::filesystem::exists(m_filename)) {
+            if (FftPlanRegistry::instance().import_wisdom(m_filename)) {
+                log::info() << "using fftw wisdom from file '" << m_filename << "'";
+            } else {
+                log::notice() << "fftw wisdom in file '" << m_filename << "' is not valid, recreating it";
+            }
+        }
+    }
+    WisdomCache(const WisdomCache&) = delete;
+    WisdomCache& operator=(const WisdomCache&) = delete;
+    ~WisdomCache()
+    {
+        if (!m_filename.empty() && !FftPlanRegistry::instance().export_wisdom(m_filename)) {
+            log::warning() << "failed to write fftw wisdom to file '" << m_filename << "'";
+        }
+    }
+
+private:
+    std::string m_filename {};
+};
+
+/*! storage of the bispectrum phases used by the phase reconstruction */
+enum class PhaseStore {
+    bispectrum,
+    phasor,
+    angle,
+    quantized
+};
+
+/*! options of the phase reconstruction: shell by shell in \e threads threads if set, from \e phase_store,
+ * from at most \e max_pairs pairs per frequency if set, up to the radius where the phase consistency falls below
+ * \e min_consistency if set, or coarse-to-fine on \e multires_levels lattices if set, refined by up to
+ * \e solver_iterations iterations of the global phase solver, in single precision if \e single_precision is set
+ */
+struct ReconstructionSettings {
+    std::optional<unsigned int> threads {};
+    PhaseStore phase_store { PhaseStore::bispectrum };
+    std::size_t solver_iterations { 0 };
+    unsigned int multires_levels { 0 };
+    std::size_t max_pairs { 0 };
+    std::optional<double> min_consistency {};
+    bool single_precision { false };
+
+    /*! the coarse-to-fine reconstruction needs no reconstruction plan, the phase refinement does */
+    [[nodiscard]] bool uses_plan() const noexcept { return multires_levels == 0 || solver_iterations > 0; }
+};
+
+/*! reconstruct the phases from \e source (Bispectrum or UnitPhaseBispectrum) following \e plan
+ * the radius reached is returned through \e radius
+ */
+template <typename P, typename Source>
+Array2<P> reconstruct_phases_from(const Source& source,
+    const ReconstructionPlan& plan,
+    const ReconstructionSettings& settings,
+    PhaseMap& pm,
+    double& radius)
+{
+    std::optional<AdaptiveRadius> adaptive {};
+    if (settings.min_consistency) {
+        adaptive = AdaptiveRadius {};
+        adaptive->min_consistency = *settings.min_consistency;
+    }
+    AdaptiveRadius* const adaptive_ptr { adaptive ? &*adaptive : nullptr };
+    Array2<P> phases {};
+    if (settings.threads) {
+        phases = reconstruct_phases_by_shell<P>(source, plan, *settings.threads, &pm, settings.max_pairs, adaptive_ptr);
+    } else {
+        phases = reconstruct_phases<P>(source, plan, &pm, settings.max_pairs, adaptive_ptr);
+    }
+    radius = adaptive ? adaptive->radius : plan.reco_radius();
+    return phases;
+}
+
+/*! reconstruct the phases up to \e reco_radius from the normalized \e bispectrum, coarse-to-fine or converted to
+ * the phase store selected in \e settings and following \e plan (only required if settings.uses_plan())
+ * the radius reached, which is smaller than \e reco_radius in the adaptive mode, is returned through \e radius
+ */
+template <typename P>
+Array2<P> reconstruct_fourier_phases(const Bispectrum<bispec_complex_t>& bispectrum,
+    std::size_t reco_radius,
+    const ReconstructionPlan* plan,
+    const ReconstructionSettings& settings,
+    PhaseMap& pm,
+    double& radius)
+{
+    radius = static_cast<double>(reco_radius);
+    if (settings.multires_levels > 0) {
+        MultiresSettings multires_settings {};
+        multires_settings.levels = settings.multires_levels;
+        return reconstruct_phases_multires<P>(bispectrum, bispectrum.dimsizes()[0], bispectrum.dimsizes()[1], reco_radius, multires_settings, &pm);
+    }
+    auto from_unit_phases = [&]<typename S>(const UnitPhaseBispectrum<S>& unit_phases) {
+        log::info() << "unit phase store: " << unit_phases.memory_size() / 1024 << " kB";
+        return reconstruct_phases_from<P>(unit_phases, *plan, settings, pm, radius);
+    };
+    switch (settings.phase_store) {
+    case PhaseStore::phasor:
+        return from_unit_phases(UnitPhaseBispectrum<bispec_complex_t>(bispectrum));
+    case PhaseStore::angle:
+        return from_unit_phases(UnitPhaseBispectrum<float>(bispectrum));
+    case PhaseStore::quantized:
+        return from_unit_phases(UnitPhaseBispectrum<std::uint16_t>(bispectrum));
+    default:
+        return reconstruct_phases_from<P>(bispectrum, *plan, settings, pm, radius);
+    }
+}
+
+/*! combine the sqrt of the half-plane power spectrum \e powerspec with \e phases to the half-plane object
+ * \e spectrum of the same size as \e powerspec
+ */
+template <typename P>
+void combine_spectrum(const Array2<double>& powerspec, const Array2<P>& phases, Array2<complex_t>& spectrum)
+{
+    // the object spectrum is hermitian, only the half-plane x >= 0 is needed by the c2r transform
+    for (std::size_t y { 0 }; y < spectrum.nrows(); ++y) {
+        for (std::size_t x { 0 }; x < spectrum.ncols(); ++x) {
+            spectrum(x, y) = std::sqrt(powerspec(x, y)) * complex_t { phases(x, y) };
+        }
+    }
+}
+
+/*! reconstruct the (unnormalized) object image from the normalized bispectrum and half-plane power spectrum
+ * with phases of type \e P, the reconstructed phases and the phase map are returned through \e phases and \e pm
+ */
+template <typename P>
+Array2<double> reconstruct_image_with(const Bispectrum<bispec_complex_t>& bispectrum,
+    const Array2<double>& powerspec,
+    std::size_t reco_radius,
+    const ReconstructionPlan* plan,
+    const ReconstructionSettings& settings,
+    Array2<P>& phases,
+    PhaseMap& pm)
+{
+    // the u-extents of the bispectrum equal the frame size
+    const std::size_t xsize { bispectrum.dimsizes()[0] };
+    const std::size_t ysize { bispectrum.dimsizes()[1] };
+    log::info() << "reconstructing fourier phases from bispectrum";
+    double radius { 0. };
+    phases = reconstruct_fourier_phases<P>(bispectrum, reco_radius, plan, settings, pm, radius);
+    if (settings.min_consistency) {
+        log::notice() << "adaptive reconstruction radius: " << radius;
+    }
+    if (settings.solver_iterations > 0) {
+        PhaseSolverSettings solver_settings {};
+        solver_settings.max_iterations = settings.solver_iterations;
+        solver_settings.nthreads = settings.threads.value_or(0);
+        const std::size_t iterations { refine_phases(bispectrum, *plan, phases, pm, solver_settings) };
+        log::info() << "refined fourier phases in " << iterations << " solver iterations";
+    }
+    if (log::system::level() >= log::Level::Debug) {
+        log::info() << "phases:";
+        phases.print();
+    }
+    log::info() << "applying window function to phase map";
+    Hann<P> window_f(xsize, ysize, radius * 2);
+    phases *= window_f;
+    log::info() << "combining sqrt of power spectrum with phases";
+    Array2<complex_t> spectrum(powerspec.ncols(), powerspec.nrows(), fft_buffer<complex_t>(powerspec.size()));
+    combine_spectrum(powerspec, phases, spectrum);
+    Array2<double> result_image(xsize, ysize, fft_buffer<double>(xsize * ysize));
+    const auto reverse_plan { FftPlanRegistry::instance().executor<double>({ xsize, ysize, FftKind::c2r }) };
+
+    log::notice() << "fft back transform of combined spectrum";
+    reverse_plan.execute(spectrum.data().get(), result_image.data().get());
+    return result_image;
+}
+
+/*! reconstruct_image_with() in the precision selected in \e settings, the phases are returned in double precision */
+Array2<double> reconstruct_image(const Bispectrum<bispec_complex_t>& bispectrum,
+    const Array2<double>& powerspec,
+    std::size_t reco_radius,
+    const ReconstructionPlan* plan,
+    const ReconstructionSettings& settings,
+    Array2<complex_t>& phases,
+    PhaseMap& pm)
+{
+    if (!settings.single_precision) {
+        return reconstruct_image_with(bispectrum, powerspec, reco_radius, plan, settings, phases, pm);
+    }
+    Array2<std::complex<float>> single_phases {};
+    Array2<double> result_image { reconstruct_image_with(bispectrum, powerspec, reco_radius, plan, settings, single_phases, pm) };
+    phases.import(single_phases, std::function<complex_t(const std::complex<float>&)>([](const std::complex<float>& z) { return complex_t { z }; }));
+    return result_image;
+}
+
+/*! expand the real half-plane power spectrum \e halfplane to the full frame size \e xsize for display */
+Array2<double> full_powerspectrum(const Array2<double>& halfplane, std::size_t xsize)
+{
+    const std::size_t ysize { halfplane.nrows() };
+    Array2<double> powerspec(xsize, ysize);
+    for (std::size_t y { 0 }; y < ysize; ++y) {
+        for (std::size_t x { 0 }; x < xsize; ++x) {
+            powerspec(x, y) = (x < halfplane.ncols()) ? halfplane(x, y) : halfplane(xsize - x, (ysize - y) % ysize);
+        }
+    }
+    return powerspec;
+}
+
+/*! reconstruction plan for the phases of \e bispectrum up to \e reco_radius
+ * the plan is read from \e plan_file if it exists and matches, otherwise it is created and written to \e plan_file
+ */
+ReconstructionPlan get_reconstruction_plan(const Bispectrum<bispec_complex_t>& bispectrum,
+    std::size_t reco_radius,
+    const std::string& plan_file)
+{
+    // the u-extents of the bispectrum equal the frame size
+    const std::size_t xsize { bispectrum.dimsizes()[0] };
+    const std::size_t ysize { bispectrum.dimsizes()[1] };
+    ReconstructionPlan plan {};
+    if (!plan_file.empty() && std::filesystem::exists(plan_file)) {
+        try {
+            plan.read_from_file(plan_file);
+            if (plan.matches(bispectrum.dimsizes(), xsize, ysize, reco_radius)) {
+                log::info() << "using reconstruction plan from file '" << plan_file << "'";
+                return plan;
+            }
+            log::notice() << "reconstruction plan in file '" << plan_file << "' does not match, recreating it";
+        } catch (const std::runtime_error& e) {
+            log::warning() << e.what();
+        }
+    }
+    log::info() << "creating reconstruction plan";
+    plan = ReconstructionPlan(bispectrum, xsize, ysize, reco_radius);
+    if (!plan_file.empty()) {
+        log::info() << "writing reconstruction plan to file '" << plan_file << "'";
+        plan.write_to_file(plan_file);
+    }
+    return plan;
+}
+
+/*! normalize the reconstructed \e image to its maximum modulus and write it to <prefix>[_falsecolor].png */
+void save_reconstruction(Array2<double>& image, const std::string& prefix)
+{
+    auto max_it = std::max_element(image.begin(), image.end(),
+        [](double a, double b) { return std::abs(a) < std::abs(b); });
+    image /= std::abs(*max_it);
+    save_frame(Array2Mat<double, double, CV_16UC3>(image, std::fabs<double>), prefix + "_falsecolor.png");
+    save_frame(Array2Mat<double, double, CV_16U>(image, std::fabs<double>), prefix + ".png");
+}
+
+/*! reconstruct the image of one sliding window and write it to reco_image_w<index>[_falsecolor].png */
+void save_window_reconstruction(const SlidingBispectrum<bispec_complex_t, bispec_complex_t>& sliding,
+    std::size_t reco_radius,
+    const ReconstructionPlan* plan,
+    const ReconstructionSettings& settings,
+    std::size_t window_index)
+{
+    log::notice() << "reconstructing window " << window_index << ": frames "
+                  << sliding.first_frame() << "-" << sliding.frames_total() - 1;
+    Array2<complex_t> phases;
+    PhaseMap pm;
+    Array2<double> result_image { reconstruct_image(sliding.bispectrum(), sliding.powerspectrum(), reco_radius, plan, settings, phases, pm) };
+
+    std::ostringstream prefix;
+    prefix << "reco_image_w" << std::setw(4) << std::setfill('0') << window_index;
+    save_reconstruction(result_image, prefix.str());
+}
+
+/**
+ * @brief Reconstruction of preview images in a background thread during the accumulation
+ * @details Snapshots of the normalized bispectrum and power spectrum are handed over by {@link #submit} into the
+ * back buffer of a double buffer, while the worker thread reconstructs from the front buffer. The buffers are
+ * swapped under the lock only when the worker picks up a new snapshot, so the accumulation never waits for a
+ * running preview. A snapshot not yet picked up is overwritten by the next one. The phases are updated by an
+ * IncrementalReconstruction seeded with the phases of the previous preview, the images are written to
+ * preview_image_<index>[_falsecolor].png.
+ */
+class PreviewWorker {
+public:
+    PreviewWorker(const ReconstructionPlan& plan, std::size_t reco_radius, std::size_t max_pairs);
+    PreviewWorker(const PreviewWorker&) = delete;
+    PreviewWorker& operator=(const PreviewWorker&) = delete;
+    /*! stops the worker after the preview in progress, a pending snapshot is dropped */
+    ~PreviewWorker();
+
+    /*! copy the sums of \e accumulator normalized to the number of its frames into the back buffer */
+    void submit(const FrameAccumulator& accumulator);
+
+private:
+    struct Snapshot {
+        Bispectrum<bispec_complex_t> bispectrum {};
+        Array2<double> powerspec {};
+        std::size_t nframes { 0 };
+    };
+    void run(std::stop_token stop);
+    void reconstruct(const Snapshot& snapshot);
+
+    IncrementalReconstruction<complex_t> m_reco;
+    Hann<complex_t> m_window;
+    Array2<complex_t> m_spectrum {};
+    Array2<double> m_image {};
+    FftExecutor<double> m_reverse_plan {};
+    std::size_t m_ntargets { 0 };
+    std::size_t m_index { 0 };
+    std::array<Snapshot, 2> m_snapshots {};
+    std::size_t m_back { 0 };
+    bool m_pending { false };
+    std::mutex m_mutex {};
+    std::condition_variable_any m_snapshot_ready {};
+    std::jthread m_thread {};
+};
+
+PreviewWorker::PreviewWorker(const ReconstructionPlan& plan, std::size_t reco_radius, std::size_t max_pairs)
+    : m_reco(plan, 0.01, max_pairs)
+    , m_window(plan.xsize(), plan.ysize(), static_cast<double>(reco_radius) * 2)
+    , m_spectrum(plan.xsize() / 2 + 1, plan.ysize(), fft_buffer<complex_t>((plan.xsize() / 2 + 1) * plan.ysize()))
+    , m_image(plan.xsize(), plan.ysize(), fft_buffer<double>(plan.xsize() * plan.ysize()))
+    , m_reverse_plan(FftPlanRegistry::instance().executor<double>({ plan.xsize(), plan.ysize(), FftKind::c2r }))
+    , m_ntargets(plan.targets().size())
+{
+    m_thread = std::jthread([this](std::stop_token stop) { run(stop); });
+}
+
+PreviewWorker::~PreviewWorker()
+{
+    m_thread.request_stop();
+    m_thread.join();
+}
+
+void PreviewWorker::submit(const FrameAccumulator& accumulator)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending) {
+        log::debug() << "preview of " << m_snapshots[m_back].nframes << " frames skipped";
+    }
+    Snapshot& snapshot { m_snapshots[m_back] };
+    snapshot.nframes = accumulator.nframes();
+    snapshot.bispectrum = accumulator.bispectrum();
+    snapshot.bispectrum /= bispec_complex_t(snapshot.nframes, 0.);
+    snapshot.powerspec = accumulator.powerspectrum();
+    snapshot.powerspec /= snapshot.nframes * m_image.size();
+    m_pending = true;
+    m_snapshot_ready.notify_one();
+}
+
+void PreviewWorker::run(std::stop_token stop)
+{
+    for (;;) {
+        std::size_t front { 0 };
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (!m_snapshot_ready.wait(lock, stop, [this] { return m_pending; })) {
+                return;
+            }
+            front = m_back;
+            m_back = 1 - m_back;
+            m_pending = false;
+        }
+        reconstruct(m_snapshots[front]);
+    }
+}
+
+void PreviewWorker::reconstruct(const Snapshot& snapshot)
+{
+    const std::size_t nrecomputed { m_reco.update(snapshot.bispectrum) };
+    log::notice() << "preview " << m_index << ": " << snapshot.nframes << " frames, recomputed "
+                  << nrecomputed << " of " << m_ntargets << " phases";
+    Array2<complex_t> phases { m_reco.phases() };
+    phases *= m_window;
+    combine_spectrum(snapshot.powerspec, phases, m_spectrum);
+    m_reverse_plan.execute(m_spectrum.data().get(), m_image.data().get());
+
+    std::ostringstream prefix;
+    prefix << "preview_image_" << std::setw(4) << std::setfill('0') << m_index++;
+    save_reconstruction(m_image, prefix.str());
+}
+
 int main(int argc, char* argv[])
 {
     const char* progname = argv[0];
@@ -84,11 +525,25 @@ int main(int argc, char* argv[])
     std::size_t ref_frame { 0 };
     std::size_t bispectrum_depth { 20 };
     std::size_t reco_radius = bispectrum_depth * 2;
+    std::size_t window_size { 0 };
+    std::size_t window_step { 0 };
+    std::size_t nprocesses { 1 };
+    std::string worker_list {};
+    std::string plan_file {};
+    std::size_t preview_step { 0 };
+    std::string wisdom_file {};
+    std::size_t fft_threads { 1 };
+    std::size_t upsampling { 0 };
+    std::size_t pyramid_levels { 0 };
+    std::size_t batch_size { 1 };
+    std::size_t prefetch_depth { 0 };
+    ReconstructionSettings reco_settings {};
     color_channel_t color_channel { color_channel_t::white };
     Rect<std::size_t> crop_rect {};
     int swSpeckleMasking { 1 };
     int swCalcSum { 1 };
     int swShowVersion { 0 };
+    int swFloatFft { 0 };
     std::size_t verbose { 0 };
 
     // evaluate command line options
@@ -107,6 +562,27 @@ int main(int argc, char* argv[])
             { "channel", required_argument, 0, 'c' },
             { "croppos", required_argument, 0, 'k' },
             { "cropsize", required_argument, 0, 's' },
+            { "window", required_argument, 0, 'w' },
+            { "windowstep", required_argument, 0, 'm' },
+            { "processes", required_argument, 0, 'j' },
+            { "workers", required_argument, 0, 'W' },
+            { "plan", required_argument, 0, 'P' },
+            { "threads", required_argument, 0, 't' },
+            { "unitphase", required_argument, 0, 'u' },
+            { "iterations", required_argument, 0, 'i' },
+            { "maxpairs", required_argument, 0, 'a' },
+            { "adaptive", required_argument, 0, 'A' },
+            { "levels", required_argument, 0, 'l' },
+            { "float", no_argument, 0, 'F' },
+            { "floatfft", no_argument, &swFloatFft, 1 },
+            { "preview", required_argument, 0, 'R' },
+            { "fftrigor", required_argument, 0, 'e' },
+            { "wisdom", required_argument, 0, 'x' },
+            { "fftthreads", required_argument, 0, 'T' },
+            { "upsampling", required_argument, 0, 'U' },
+            { "pyramid", required_argument, 0, 'g' },
+            { "batch", required_argument, 0, 'B' },
+            { "prefetch", required_argument, 0, 'q' },
             { "help", no_argument, 0, 'h' },
             { "version", no_argument, &swShowVersion, 1 },
             { "no-calcsum", no_argument, &swCalcSum, 0 },
@@ -118,7 +594,7 @@ int main(int argc, char* argv[])
         // getopt_long stores the option index here.
         int option_index { 0 };
 
-        ch = getopt_long(argc, argv, "vn:r:p:b:c:h?k:s:",
+        ch = getopt_long(argc, argv, "vn:r:p:b:c:h?k:s:w:m:j:W:P:t:u:i:a:A:l:FR:e:x:T:U:g:B:q:",
             long_options, &option_index);
 
         std::istringstream istr;
@@ -143,6 +619,110 @@ int main(int argc, char* argv[])
             log::debug() << "bispectrum size (dims 3 & 4): " << optarg;
             bispectrum_depth = strtoul(optarg, NULL, 10);
             break;
+        case 'w':
+            log::debug() << "sliding window size: " << optarg;
+            window_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'm':
+            log::debug() << "sliding window step: " << optarg;
+            window_step = strtoul(optarg, NULL, 10);
+            break;
+        case 'j':
+            log::debug() << "number of worker processes: " << optarg;
+            nprocesses = std::max<std::size_t>(1, strtoul(optarg, NULL, 10));
+            break;
+        case 'W':
+            log::debug() << "remote workers: " << optarg;
+            worker_list = optarg;
+            break;
+        case 'P':
+            log::debug() << "reconstruction plan file: " << optarg;
+            plan_file = optarg;
+            break;
+        case 't':
+            log::debug() << "phase reconstruction threads: " << optarg;
+            reco_settings.threads = static_cast<unsigned int>(strtoul(optarg, NULL, 10));
+            break;
+        case 'u':
+            log::debug() << "unit phase store: " << optarg;
+            switch (optarg[0]) {
+            case 'p':
+                reco_settings.phase_store = PhaseStore::phasor;
+                break;
+            case 'a':
+                reco_settings.phase_store = PhaseStore::angle;
+                break;
+            case 'q':
+                reco_settings.phase_store = PhaseStore::quantized;
+                break;
+            default:
+                throw std::range_error("invalid unit phase store argument");
+            }
+            break;
+        case 'i':
+            log::debug() << "phase solver iterations: " << optarg;
+            reco_settings.solver_iterations = strtoul(optarg, NULL, 10);
+            break;
+        case 'a':
+            log::debug() << "max pairs per frequency: " << optarg;
+            reco_settings.max_pairs = strtoul(optarg, NULL, 10);
+            break;
+        case 'A':
+            log::debug() << "adaptive radius min. consistency: " << optarg;
+            reco_settings.min_consistency = strtod(optarg, NULL);
+            break;
+        case 'l':
+            log::debug() << "multi-resolution levels: " << optarg;
+            reco_settings.multires_levels = static_cast<unsigned int>(strtoul(optarg, NULL, 10));
+            break;
+        case 'F':
+            log::debug() << "single precision reconstruction";
+            reco_settings.single_precision = true;
+            break;
+        case 'R':
+            log::debug() << "preview every " << optarg << " frames";
+            preview_step = strtoul(optarg, NULL, 10);
+            break;
+        case 'e':
+            log::debug() << "fft planner rigor: " << optarg;
+            switch (optarg[0]) {
+            case 'e':
+                FftPlanRegistry::instance().set_rigor(FftRigor::estimate);
+                break;
+            case 'm':
+                FftPlanRegistry::instance().set_rigor(FftRigor::measure);
+                break;
+            case 'p':
+                FftPlanRegistry::instance().set_rigor(FftRigor::patient);
+                break;
+            default:
+                throw std::range_error("invalid fft planner rigor argument");
+            }
+            break;
+        case 'x':
+            log::debug() << "fftw wisdom file: " << optarg;
+            wisdom_file = optarg;
+            break;
+        case 'T':
+            log::debug() << "fft threads: " << optarg;
+            fft_threads = strtoul(optarg, NULL, 10);
+            break;
+        case 'U':
+            log::debug() << "registration upsampling factor: " << optarg;
+            upsampling = strtoul(optarg, NULL, 10);
+            break;
+        case 'g':
+            log::debug() << "pyramid registration levels: " << optarg;
+            pyramid_levels = strtoul(optarg, NULL, 10);
+            break;
+        case 'B':
+            log::debug() << "fft batch size: " << optarg;
+            batch_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'q':
+            log::debug() << "frame prefetch depth: " << optarg;
+            prefetch_depth = strtoul(optarg, NULL, 10);
+            break;
         case 'k':
             istr.str(std::string(optarg));
             int _a, _b;
@@ -228,10 +808,39 @@ int main(int argc, char* argv[])
         exit(0);
     }
     std::string filename(*argv);
+    if (reco_settings.multires_levels > 0) {
+        // the coarse-to-fine reconstruction averages all lattice pairs of the bispectrum in the calling thread
+        if (reco_settings.threads && reco_settings.solver_iterations == 0) {
+            log::warning() << "multi-resolution reconstruction runs single-threaded, ignoring reconstruction threads";
+            reco_settings.threads.reset();
+        }
+        if (reco_settings.phase_store != PhaseStore::bispectrum) {
+            log::warning() << "multi-resolution reconstruction requires the bispectrum, ignoring unit phase store";
+            reco_settings.phase_store = PhaseStore::bispectrum;
+        }
+        if (reco_settings.max_pairs > 0) {
+            log::warning() << "multi-resolution reconstruction uses all lattice pairs, ignoring max pairs per frequency";
+            reco_settings.max_pairs = 0;
+        }
+        if (reco_settings.min_consistency) {
+            log::warning() << "multi-resolution reconstruction covers the full reco radius, ignoring adaptive radius";
+            reco_settings.min_consistency.reset();
+        }
+    }
+    const WisdomCache wisdom_cache(wisdom_file);
+    if (fft_threads != 1) {
+        FftPlanRegistry& registry { FftPlanRegistry::instance() };
+        if (FftPlanRegistry::threads_supported()) {
+            registry.set_max_threads(fft_threads);
+            registry.calibrate_threads();
+            for (const auto& crossover : registry.thread_crossovers()) {
+                log::info() << "ffts from " << crossover.min_elements << " pixels in " << crossover.threads << " threads";
+            }
+        } else {
+            log::warning() << "built without threaded fftw, ffts run single-threaded";
+        }
+    }
 
-    Array2<complex_t> powerspec;
-    Array2<complex_t> indata;
-    Bispectrum<bispec_complex_t> bispectrum;
     Array2<complex_t> phases;
 
     FrameExtractor fe(filename);
@@ -244,112 +853,125 @@ int main(int argc, char* argv[])
     log::notice() << "using " << nframes << "/" << fe.nframes() << " frames";
     log::info() << "creating sum, power spectra and accumulating bispectrum of all frames";
     log::info() << "reading first (reference) frame";
-    indata = Mat2Array<complex_t>(fe.extract_next_frame(), color_channel);
+    const Array2<double> ref_image { Mat2Array<double>(fe.extract_next_frame(), color_channel) };
     log::debug() << "frame data:";
     if (log::system::level() >= log::Level::Debug)
-        indata.print();
+        ref_image.print();
 
-    log::debug() << "creating bispectrum with size [" << indata.ncols() << " " << indata.nrows() << " " << bispectrum_depth << " " << bispectrum_depth << "]";
-    bispectrum = Bispectrum<bispec_complex_t>({ indata.ncols(), indata.nrows(), bispectrum_depth, bispectrum_depth });
-    if (log::system::level() >= log::Level::Debug)
-        bispectrum.print();
-    fftw_plan forward_plan = fftw_plan_dft_2d(indata.nrows(), indata.ncols(),
-        reinterpret_cast<fftw_complex*>(indata.data().get()),
-        reinterpret_cast<fftw_complex*>(indata.data().get()),
-        FFTW_FORWARD, FFTW_ESTIMATE);
-
-    log::info() << "adding frame to sum image";
-    // first, create empty sumarray with frame size
-    Array2<double> sumarray(indata.ncols(), indata.nrows());
-    // element-wise conversion from complex indata frame to real sumarray
-    // sumarray = indata;
-    std::transform(indata.begin(), indata.end(), sumarray.begin(), [](const complex_t& c) { return c.real(); });
-    // set up cross correlation object with first frame as reference frame
-    CrossCorrelation<double> cross_correl(sumarray);
-
-    log::info() << "executing fft";
-    fftw_execute(forward_plan);
-    log::info() << "accumulating fft to mean bispectrum";
-    bispectrum.accumulate_from_fft(indata);
-    std::transform(indata.begin(), indata.end(), indata.begin(),
-        [](const complex_t& val) {
-            return complex_t { std::norm(val), 0. };
+    const Bispectrum<bispec_complex_t>::extents bispectrum_extents { ref_image.ncols(), ref_image.nrows(), bispectrum_depth, bispectrum_depth };
+    // in sliding window mode the running bispectrum of the window replaces the mean bispectrum of all frames
+    std::optional<SlidingBispectrum<bispec_complex_t, bispec_complex_t>> sliding {};
+    if (window_size > 0) {
+        if (window_step == 0) {
+            window_step = window_size;
+        }
+        log::info() << "sliding window mode: window size " << window_size << " frames, step " << window_step << " frames";
+        sliding.emplace(bispectrum_extents, window_size, window_step);
+        if (nprocesses > 1 || !worker_list.empty()) {
+            log::warning() << "sliding window mode requires sequential frame order, ignoring worker processes";
+            nprocesses = 1;
+            worker_list.clear();
+        }
+    } else {
+        log::debug() << "creating bispectrum with size [" << ref_image.ncols() << " " << ref_image.nrows() << " " << bispectrum_depth << " " << bispectrum_depth << "]";
+    }
+    // set up accumulator with first frame as reference frame for the cross correlation
+    FrameAccumulator accumulator(ref_image, bispectrum_depth, !sliding);
+    accumulator.set_upsampling(upsampling);
+    accumulator.set_pyramid_levels(pyramid_levels);
+    accumulator.set_batch_size(batch_size);
+    accumulator.set_prefetch_depth(prefetch_depth);
+    accumulator.set_single_precision(swFloatFft != 0);
+    if (log::system::level() >= log::Level::Debug && !sliding)
+        accumulator.bispectrum().print();
+    std::size_t window_index { 0 };
+    // the plan is shared by the reconstructions of all windows
+    std::optional<ReconstructionPlan> plan {};
+    if (sliding) {
+        accumulator.set_spectrum_callback([&](const FrameSpectrum<bispec_complex_t>& spectrum) {
+            log::info() << "adding fft to sliding window bispectrum";
+            sliding->add_frame(spectrum);
+            if (sliding->window_complete()) {
+                if (!plan && reco_settings.uses_plan()) {
+                    plan = get_reconstruction_plan(sliding->bispectrum(), reco_radius, plan_file);
+                }
+                save_window_reconstruction(*sliding, reco_radius, plan ? &*plan : nullptr, reco_settings, window_index++);
+            }
         });
-    log::info() << "adding power spectrum to mean power spectrum";
-    powerspec = indata;
-
-    while (fe.current_frame() < nframes) {
-        log::info() << "reading frame " << fe.current_frame() + 1 << "/" << nframes;
-        // the following two lines circumvent the move operation
-        // which would alter indata's storage address
-        indata = complex_t {};
-        indata += Mat2Array<complex_t>(fe.extract_next_frame(), color_channel);
-        //std::cout << "indata address: " << std::hex << indata.data() << std::dec << "\n";
-        // calculate shift of frame wrt ref frame through cross correlation
-        auto xyshift = cross_correl(Array2<double>::convert<std::complex<double>>(indata, complex_abs<double>));
-        log::info() << "relative shift wrt ref frame: [x,y] = " << xyshift;
-        log::info() << "adding back-shifted frame to sum image";
-        // add back-shifted frame to sum image
-        xyshift = -xyshift;
-        sumarray += Array2<double>::convert<std::complex<double>>(indata, complex_abs<double>).shifted(xyshift);
-        log::info() << "executing fft";
-        fftw_execute(forward_plan);
-        log::info() << "accumulating fft to mean bispectrum";
-        bispectrum.accumulate_from_fft(indata);
-        log::info() << "creating power spectrum from fft";
-        std::transform(indata.begin(), indata.end(), indata.begin(),
-            [](const complex_t& val) {
-                return complex_t { std::norm(val), 0. };
-            });
-        log::info() << "adding power spectrum to mean power spectrum";
-        powerspec += indata;
+    }
+
+    // previews of the growing sums are reconstructed in the background while the frames are accumulated
+    std::optional<PreviewWorker> preview {};
+    if (preview_step > 0) {
+        if (sliding || nprocesses > 1 || !worker_list.empty()) {
+            log::warning() << "preview mode requires the sequential accumulation of all frames, ignoring previews";
+        } else {
+            plan = get_reconstruction_plan(accumulator.bispectrum(), reco_radius, plan_file);
+            preview.emplace(*plan, reco_radius, reco_settings.max_pairs);
+        }
+    }
+
+    accumulator.add_frame(ref_image);
+    if (nframes > 1) {
+        if (!worker_list.empty()) {
+            const auto workers { net::parse_worker_list(worker_list) };
+            net::accumulate_frames_remote(workers, std::filesystem::absolute(filename).string(), color_channel, ref_image, 1, nframes - 1, 0, accumulator);
+        } else if (nprocesses > 1) {
+            accumulate_frames_forked(filename, color_channel, ref_image, 1, nframes - 1, nprocesses, accumulator);
+        } else if (preview) {
+            for (std::size_t first_frame { 1 }; first_frame < nframes; first_frame += preview_step) {
+                const std::size_t count { std::min(preview_step, nframes - first_frame) };
+                if (accumulate_frames(fe, color_channel, first_frame, count, accumulator) < count) {
+                    break;
+                }
+                if (first_frame + count < nframes) {
+                    preview->submit(accumulator);
+                }
+            }
+        } else {
+            accumulate_frames(fe, color_channel, 1, nframes - 1, accumulator);
+        }
+    }
+    preview.reset();
+    Array2<double>& sumarray { accumulator.sum_image() };
+    Array2<double>& powerspec { accumulator.powerspectrum() };
+    Bispectrum<bispec_complex_t>& bispectrum { accumulator.bispectrum() };
+    const std::size_t nframes_used { accumulator.nframes() };
+    if (nframes_used != nframes) {
+        log::warning() << "accumulated " << nframes_used << " of " << nframes << " frames";
     }
     log::info() << "normalizing sum image";
-    sumarray /= nframes;
+    sumarray /= nframes_used;
+    if (sliding) {
+        log::notice() << "reconstructed " << window_index << " sliding windows";
+        sumarray /= 255.;
+        save_frame(Array2Mat<double, double, CV_16UC3>(sumarray, std::fabs<double>, false), "sum_image_falsecolor.png");
+        save_frame(Array2Mat<double, double, CV_16U>(sumarray, std::fabs<double>, false), "sum_image.png");
+        return 0;
+    }
     log::info() << "normalizing bispectrum";
-    powerspec /= nframes * powerspec.size();
+    powerspec /= nframes_used * sumarray.size();
     log::info() << "normalizing power spectrum";
-    bispectrum /= bispec_complex_t(nframes, 0.);
+    bispectrum /= bispec_complex_t(nframes_used, 0.);
     log::notice() << "writing bispectrum to file 'bispectrum.dat'";
     bispectrum.write_to_file("bispectrum.dat");
-    fftw_destroy_plan(forward_plan);
 
-    log::info() << "reconstructing fourier phases from bispectrum";
-    PhaseMap pm;
-    phases = reconstruct_phases<complex_t, bispec_complex_t>(bispectrum, indata.ncols(), indata.nrows(), reco_radius, &pm);
     if (log::system::level() >= log::Level::Debug) {
         log::debug() << "sumarray:";
         sumarray.print();
         log::debug() << "power spectrum:";
         powerspec.print();
-        log::info() << "phases:";
-        phases.print();
     }
-    log::info() << "applying window function to phase map";
-    Hann<complex_t> window_f(powerspec.ncols(), powerspec.nrows(), reco_radius * 2);
-    phases *= window_f;
-    Array2<complex_t> result_image(powerspec.ncols(), powerspec.nrows());
-    log::info() << "calculating sqrt of power spectrum";
-    std::transform(powerspec.begin(), powerspec.end(), result_image.begin(),
-        [](const complex_t& val) {
-            return complex_t { std::sqrt(val.real()), 0. };
-        });
-    log::info() << "combining power spectrum with phases";
-    result_image *= phases;
-
-    fftw_plan reverse_plan = fftw_plan_dft_2d(result_image.nrows(), result_image.ncols(),
-        reinterpret_cast<fftw_complex*>(result_image.data().get()),
-        reinterpret_cast<fftw_complex*>(result_image.data().get()),
-        FFTW_BACKWARD, FFTW_ESTIMATE);
-
-    log::notice() << "fft back transform of combined spectrum";
-    fftw_execute(reverse_plan);
+    PhaseMap pm;
+    if (!plan && reco_settings.uses_plan()) {
+        plan = get_reconstruction_plan(bispectrum, reco_radius, plan_file);
+    }
+    Array2<double> result_image { reconstruct_image(bispectrum, powerspec, reco_radius, plan ? &*plan : nullptr, reco_settings, phases, pm) };
 
     if (log::system::level() >= log::Level::Debug) {
         log::debug() << "reconstructed image:";
         result_image.print();
     }
-    fftw_destroy_plan(reverse_plan);
 
     auto abscomp = [](const std::complex<double>& a, const std::complex<double>& b) {
         return (std::abs(a) < std::abs(b));
@@ -358,22 +980,24 @@ int main(int argc, char* argv[])
     if (log::system::level() >= log::Level::Debug) {
         log::debug() << "sum image: min=" << *(minmax_d.first) << " max=" << *(minmax_d.second);
     }
-    auto minmax = std::minmax_element(powerspec.begin(), powerspec.end(), abscomp);
+    Array2<double> full_powerspec { full_powerspectrum(powerspec, sumarray.ncols()) };
+    minmax_d = std::minmax_element(full_powerspec.begin(), full_powerspec.end());
     if (log::system::level() >= log::Level::Debug) {
-        log::debug() << "power spectrum: min=" << std::abs(*(minmax.first)) << " max=" << std::abs(*(minmax.second));
+        log::debug() << "power spectrum: min=" << *(minmax_d.first) << " max=" << *(minmax_d.second);
     }
-    auto normfact { std::abs(*(minmax.second)) / 1000. };
-    powerspec /= normfact;
-    minmax = std::minmax_element(phases.begin(), phases.end(), abscomp);
+    auto normfact { *(minmax_d.second) / 1000. };
+    full_powerspec /= normfact;
+    auto minmax = std::minmax_element(phases.begin(), phases.end(), abscomp);
     if (log::system::level() >= log::Level::Debug) {
         log::debug() << "phases: min=" << std::abs(*(minmax.first)) << " max=" << std::abs(*(minmax.second));
     }
-    minmax = std::minmax_element(result_image.begin(), result_image.end(), abscomp);
+    minmax_d = std::minmax_element(result_image.begin(), result_image.end(),
+        [](double a, double b) { return std::abs(a) < std::abs(b); });
     if (log::system::level() >= log::Level::Debug) {
-        log::debug() << "reconstructed image: min=" << std::abs(*(minmax.first)) << " max=" << std::abs(*(minmax.second));
+        log::debug() << "reconstructed image: min=" << std::abs(*(minmax_d.first)) << " max=" << std::abs(*(minmax_d.second));
     }
-    normfact = { std::abs(*(minmax.second)) };
-    result_image /= complex_t { normfact, 0. };
+    normfact = { std::abs(*(minmax_d.second)) };
+    result_image /= normfact;
 
     sumarray /= 255.;
 
@@ -381,11 +1005,11 @@ int main(int argc, char* argv[])
     save_frame(Array2Mat<double, double, CV_16U>(sumarray, std::fabs<double>, false), "sum_image.png");
     save_frame(Array2Mat<complex_t, double, CV_16UC3>(phases, complex_phase<double>), "phases_falsecolor.png");
     save_frame(Array2Mat<complex_t, double, CV_16U>(phases, complex_phase<double>), "phases.png");
-    save_frame(Array2Mat<PhaseMapElement, double, CV_16UC3>(pm, get_phase_consistency), "phasecons.png");
-    save_frame(Array2Mat<complex_t, double, CV_16UC3>(powerspec, complex_abs<double>), "powerspec_falsecolor.png");
-    save_frame(Array2Mat<complex_t, double, CV_16U>(powerspec, complex_abs<double>), "powerspec.png");
-    save_frame(Array2Mat<complex_t, double, CV_16UC3>(result_image, complex_abs<double>), "reco_image_falsecolor.png");
-    save_frame(Array2Mat<complex_t, double, CV_16U>(result_image, complex_abs<double>), "reco_image.png");
+    save_frame(Array2Mat<PhaseMapElement, double, CV_16UC3>(pm.to_array(), get_phase_consistency), "phasecons.png");
+    save_frame(Array2Mat<double, double, CV_16UC3>(full_powerspec, std::fabs<double>), "powerspec_falsecolor.png");
+    save_frame(Array2Mat<double, double, CV_16U>(full_powerspec, std::fabs<double>), "powerspec.png");
+    save_frame(Array2Mat<double, double, CV_16UC3>(result_image, std::fabs<double>), "reco_image_falsecolor.png");
+    save_frame(Array2Mat<double, double, CV_16U>(result_image, std::fabs<double>), "reco_image.png");
     if (log::system::level() >= log::Level::Debug) {
         cv::namedWindow("Display Sum Image", cv::WINDOW_AUTOSIZE);
         cv::namedWindow("Display FFT Image", cv::WINDOW_AUTOSIZE);
@@ -393,10 +1017,10 @@ int main(int argc, char* argv[])
         cv::namedWindow("Display PhaseCons Image", cv::WINDOW_AUTOSIZE);
         cv::namedWindow("Display Reco Image", cv::WINDOW_AUTOSIZE);
         cv::imshow("Display Sum Image", Array2Mat<double, double, CV_16UC3>(sumarray, std::fabs<double>, false));
-        cv::imshow("Display FFT Image", Array2Mat<complex_t, double, CV_16UC3>(powerspec, complex_abs<double>));
+        cv::imshow("Display FFT Image", Array2Mat<double, double, CV_16UC3>(full_powerspec, std::fabs<double>));
         cv::imshow("Display Phases Image", Array2Mat<complex_t, double, CV_16UC3>(phases, complex_phase<double>));
-        cv::imshow("Display PhaseCons Image", Array2Mat<PhaseMapElement, double, CV_16UC3>(pm, get_phase_consistency));
-        cv::imshow("Display Reco Image", Array2Mat<complex_t, double, CV_16UC3>(result_image, complex_abs<double>));
+        cv::imshow("Display PhaseCons Image", Array2Mat<PhaseMapElement, double, CV_16UC3>(pm.to_array(), get_phase_consistency));
+        cv::imshow("Display Reco Image", Array2Mat<double, double, CV_16UC3>(result_image, std::fabs<double>));
         cv::waitKey(0);
     }
 }
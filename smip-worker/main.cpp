@@ -0,0 +1,158 @@
+#include <getopt.h>
+#include <iostream>
+#include <stdlib.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "frame_accumulator.h"
+#include "log.h"
+#include "videoio.h"
+#include "worker_protocol.h"
+
+using namespace smip;
+
+void Usage(const char* progname)
+{
+    using namespace std;
+    cout << "   Usage :  " << std::string(progname) << " [pbqvh?]" << endl;
+    cout << "    accumulates frame ranges of a video on behalf of smip-cli (option --workers)" << endl;
+    cout << "    available options:" << endl;
+    cout << "     -p   --port        <port>    :   TCP port to listen on (default : " << net::c_default_port << ")" << endl;
+    cout << "     -B   --batch       <frames>  :   number of frames transformed together by one batched fft (default : 1)" << endl;
+    cout << "     -q   --prefetch    <frames>  :   number of frames decoded ahead in a background thread (default : 0)" << endl;
+    cout << "     -v   --verbose               :   increase verbosity level" << endl;
+    cout << "          --version               :   display version and exit" << endl;
+    cout << "     -h -?  --help                :   help (this screen)" << endl;
+    cout << endl;
+}
+
+/*! job handler: decode and accumulate the requested frames, the video file is kept open between jobs */
+class JobHandler {
+public:
+    JobHandler(std::size_t batch_size, std::size_t prefetch_depth)
+        : m_batch_size(batch_size)
+        , m_prefetch_depth(prefetch_depth)
+    {
+    }
+
+    net::AccumulationResult operator()(const net::AccumulationJob& job)
+    {
+        if (!m_extractor || m_extractor->filename() != job.filename) {
+            m_extractor.reset();
+            m_extractor = std::make_unique<FrameExtractor>(job.filename);
+        }
+        if (!m_extractor->is_valid()) {
+            throw std::runtime_error("file open error: " + job.filename);
+        }
+        FrameAccumulator accumulator(job.ref_frame, job.bispectrum_depth, job.with_bispectrum);
+        accumulator.set_upsampling(job.upsampling);
+        accumulator.set_pyramid_levels(job.pyramid_levels);
+        accumulator.set_single_precision(job.single_precision);
+        accumulator.set_batch_size(m_batch_size);
+        accumulator.set_prefetch_depth(m_prefetch_depth);
+        accumulate_frames(*m_extractor, job.color_channel, job.first_frame, job.count, accumulator);
+        return { job.id,
+            accumulator.nframes(),
+            std::move(accumulator.bispectrum()),
+            std::move(accumulator.powerspectrum()),
+            std::move(accumulator.sum_image()) };
+    }
+
+private:
+    std::unique_ptr<FrameExtractor> m_extractor {};
+    std::size_t m_batch_size { 1 };
+    std::size_t m_prefetch_depth { 0 };
+};
+
+int main(int argc, char* argv[])
+{
+    const char* progname = argv[0];
+
+    log::system::setup(
+        log::Level::Notice,
+        [](int c) { exit(c); },
+        std::cerr);
+
+    std::uint16_t port { net::c_default_port };
+    int swShowVersion { 0 };
+    std::size_t verbose { 0 };
+    std::size_t batch_size { 1 };
+    std::size_t prefetch_depth { 0 };
+
+    for (char ch {}; ch != -1;) {
+        static struct option long_options[] = {
+            { "verbose", no_argument, 0, 'v' },
+            { "port", required_argument, 0, 'p' },
+            { "batch", required_argument, 0, 'B' },
+            { "prefetch", required_argument, 0, 'q' },
+            { "help", no_argument, 0, 'h' },
+            { "version", no_argument, &swShowVersion, 1 },
+            { 0, 0, 0, 0 }
+        };
+        int option_index { 0 };
+
+        ch = getopt_long(argc, argv, "vp:B:q:h?", long_options, &option_index);
+
+        switch (ch) {
+        case 'v':
+            verbose++;
+            break;
+        case 'p':
+            port = static_cast<std::uint16_t>(strtoul(optarg, NULL, 10));
+            break;
+        case 'B':
+            batch_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'q':
+            prefetch_depth = strtoul(optarg, NULL, 10);
+            break;
+        case 'h':
+        case '?':
+            Usage(progname);
+            exit(0);
+        default:
+            break;
+        }
+    }
+
+    if (swShowVersion) {
+        std::cout << "Speckle Masking Image Processing Worker v"
+                  << Version::major << "."
+                  << Version::minor << "."
+                  << Version::patch << std::endl;
+        exit(0);
+    }
+
+    switch (verbose) {
+    case 0:
+        break;
+    case 1:
+        log::system::level() = log::Level::Info;
+        break;
+    case 2:
+    default:
+        log::system::level() = log::Level::Debug;
+    }
+
+    try {
+        net::TcpListener listener(port);
+        log::notice() << "smip-worker listening on port " << listener.port();
+        JobHandler handler { batch_size, prefetch_depth };
+        for (;;) {
+            net::TcpSocket connection { listener.accept() };
+            log::notice() << "coordinator connected";
+            try {
+                net::serve_worker_session(connection, std::ref(handler));
+                log::notice() << "coordinator disconnected";
+            } catch (const std::exception& e) {
+                log::error() << "session aborted: " << e.what();
+            }
+        }
+    } catch (const std::exception& e) {
+        log::critical(-1) << e.what();
+    }
+}
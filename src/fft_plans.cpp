@@ -0,0 +1,381 @@
+#include "fft_plans.h"
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace smip {
+
+namespace {
+/*! crossovers in use until calibrate_threads() is called, the threads of fftw pay off from about 128 x 128 pixels */
+const std::vector<FftThreadCrossover> c_default_crossovers { { 0, 1 }, { 128 * 128, 2 }, { 256 * 256, 4 }, { 512 * 512, 0 } };
+
+std::size_t hardware_threads()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/*! number of threads of the plans created next by the fftw planner of both precisions */
+void set_planner_threads([[maybe_unused]] std::size_t nthreads)
+{
+#ifdef SMIP_FFTW_THREADS
+    fftw_plan_with_nthreads(static_cast<int>(nthreads));
+    fftwf_plan_with_nthreads(static_cast<int>(nthreads));
+#endif
+}
+
+/*! time of an r2c transform of \e size x \e size pixels with a plan of \e nthreads threads, the best mean of
+ * three runs of \e repetitions transforms
+ */
+double transform_time(std::size_t size, std::size_t nthreads, std::size_t repetitions)
+{
+    auto in { fft_buffer<double>(size * size) };
+    auto out { fft_buffer<fftw_complex>((size / 2 + 1) * size) };
+    set_planner_threads(nthreads);
+    fftw_plan plan { fftw_plan_dft_r2c_2d(static_cast<int>(size), static_cast<int>(size), in.get(), out.get(), FFTW_ESTIMATE) };
+    if (plan == nullptr) {
+        return std::numeric_limits<double>::infinity();
+    }
+    std::fill(in.get(), in.get() + size * size, 1.);
+    fftw_execute(plan);
+    double best { std::numeric_limits<double>::infinity() };
+    for (int run { 0 }; run < 3; ++run) {
+        const auto start { std::chrono::steady_clock::now() };
+        for (std::size_t i { 0 }; i < repetitions; ++i) {
+            fftw_execute(plan);
+        }
+        const std::chrono::duration<double> elapsed { std::chrono::steady_clock::now() - start };
+        best = std::min(best, elapsed.count() / static_cast<double>(repetitions));
+    }
+    fftw_destroy_plan(plan);
+    return best;
+}
+
+unsigned int planner_flags(FftRigor rigor, bool aligned)
+{
+    unsigned int flags { FFTW_ESTIMATE };
+    switch (rigor) {
+    case FftRigor::measure:
+        flags = FFTW_MEASURE;
+        break;
+    case FftRigor::patient:
+        flags = FFTW_PATIENT;
+        break;
+    default:
+        break;
+    }
+    return aligned ? flags : (flags | FFTW_UNALIGNED);
+}
+
+/*! creates the plan for \e key on scratch buffers of the planner */
+template <typename R>
+typename FftTraits<R>::plan_type create_plan(const FftPlanKey& key, unsigned int flags);
+
+/*! element counts of the input and output arrays of a single transform of \e key */
+std::pair<std::size_t, std::size_t> array_sizes(const FftPlanKey& key)
+{
+    const std::size_t nreal { key.xsize * key.ysize };
+    const std::size_t nhalf { (key.xsize / 2 + 1) * key.ysize };
+    switch (key.kind) {
+    case FftKind::r2c:
+        return { nreal, nhalf };
+    case FftKind::c2r:
+        return { nhalf, nreal };
+    default:
+        return { nreal, nreal };
+    }
+}
+
+template <>
+fftw_plan create_plan<double>(const FftPlanKey& key, unsigned int flags)
+{
+    const int nx { static_cast<int>(key.xsize) };
+    const int ny { static_cast<int>(key.ysize) };
+    // the scratch buffers are large enough for the padded in-place layout of the real transforms
+    const std::size_t ncomplex { (key.kind == FftKind::r2c || key.kind == FftKind::c2r) ? (key.xsize / 2 + 1) * key.ysize : key.xsize * key.ysize };
+    auto in { fft_buffer<fftw_complex>(key.howmany * fft_batch_distance(ncomplex)) };
+    auto out { key.in_place ? in : fft_buffer<fftw_complex>(key.howmany * fft_batch_distance(ncomplex)) };
+    if (key.howmany > 1) {
+        const int n[] { ny, nx };
+        const int howmany { static_cast<int>(key.howmany) };
+        const auto [nin, nout] { array_sizes(key) };
+        const int idist { static_cast<int>(fft_batch_distance(nin)) };
+        const int odist { static_cast<int>(fft_batch_distance(nout)) };
+        switch (key.kind) {
+        case FftKind::r2c:
+            return fftw_plan_many_dft_r2c(2, n, howmany, reinterpret_cast<double*>(in.get()), nullptr, 1, idist, out.get(), nullptr, 1, odist, flags);
+        case FftKind::c2r:
+            return fftw_plan_many_dft_c2r(2, n, howmany, in.get(), nullptr, 1, idist, reinterpret_cast<double*>(out.get()), nullptr, 1, odist, flags);
+        default:
+            return fftw_plan_many_dft(2, n, howmany, in.get(), nullptr, 1, idist, out.get(), nullptr, 1, odist,
+                (key.kind == FftKind::forward) ? FFTW_FORWARD : FFTW_BACKWARD, flags);
+        }
+    }
+    switch (key.kind) {
+    case FftKind::r2c:
+        return fftw_plan_dft_r2c_2d(ny, nx, reinterpret_cast<double*>(in.get()), out.get(), flags);
+    case FftKind::c2r:
+        return fftw_plan_dft_c2r_2d(ny, nx, in.get(), reinterpret_cast<double*>(out.get()), flags);
+    case FftKind::forward:
+        return fftw_plan_dft_2d(ny, nx, in.get(), out.get(), FFTW_FORWARD, flags);
+    default:
+        return fftw_plan_dft_2d(ny, nx, in.get(), out.get(), FFTW_BACKWARD, flags);
+    }
+}
+
+template <>
+fftwf_plan create_plan<float>(const FftPlanKey& key, unsigned int flags)
+{
+    const int nx { static_cast<int>(key.xsize) };
+    const int ny { static_cast<int>(key.ysize) };
+    const std::size_t ncomplex { (key.kind == FftKind::r2c || key.kind == FftKind::c2r) ? (key.xsize / 2 + 1) * key.ysize : key.xsize * key.ysize };
+    auto in { fft_buffer<fftwf_complex, float>(key.howmany * fft_batch_distance(ncomplex)) };
+    auto out { key.in_place ? in : fft_buffer<fftwf_complex, float>(key.howmany * fft_batch_distance(ncomplex)) };
+    if (key.howmany > 1) {
+        const int n[] { ny, nx };
+        const int howmany { static_cast<int>(key.howmany) };
+        const auto [nin, nout] { array_sizes(key) };
+        const int idist { static_cast<int>(fft_batch_distance(nin)) };
+        const int odist { static_cast<int>(fft_batch_distance(nout)) };
+        switch (key.kind) {
+        case FftKind::r2c:
+            return fftwf_plan_many_dft_r2c(2, n, howmany, reinterpret_cast<float*>(in.get()), nullptr, 1, idist, out.get(), nullptr, 1, odist, flags);
+        case FftKind::c2r:
+            return fftwf_plan_many_dft_c2r(2, n, howmany, in.get(), nullptr, 1, idist, reinterpret_cast<float*>(out.get()), nullptr, 1, odist, flags);
+        default:
+            return fftwf_plan_many_dft(2, n, howmany, in.get(), nullptr, 1, idist, out.get(), nullptr, 1, odist,
+                (key.kind == FftKind::forward) ? FFTW_FORWARD : FFTW_BACKWARD, flags);
+        }
+    }
+    switch (key.kind) {
+    case FftKind::r2c:
+        return fftwf_plan_dft_r2c_2d(ny, nx, reinterpret_cast<float*>(in.get()), out.get(), flags);
+    case FftKind::c2r:
+        return fftwf_plan_dft_c2r_2d(ny, nx, in.get(), reinterpret_cast<float*>(out.get()), flags);
+    case FftKind::forward:
+        return fftwf_plan_dft_2d(ny, nx, in.get(), out.get(), FFTW_FORWARD, flags);
+    default:
+        return fftwf_plan_dft_2d(ny, nx, in.get(), out.get(), FFTW_BACKWARD, flags);
+    }
+}
+
+/*! exported wisdom of fftw as string terminated by a newline, the string of fftw is released by \e free_function */
+template <typename E, typename F>
+std::string wisdom_string(E export_function, F free_function)
+{
+    char* const wisdom { export_function() };
+    if (wisdom == nullptr) {
+        return {};
+    }
+    std::string result { wisdom };
+    free_function(wisdom);
+    if (!result.empty() && result.back() != '\n') {
+        result.push_back('\n');
+    }
+    return result;
+}
+} // namespace
+
+FftPlanRegistry& FftPlanRegistry::instance()
+{
+    static FftPlanRegistry registry {};
+    return registry;
+}
+
+FftPlanRegistry::FftPlanRegistry()
+    : m_crossovers(c_default_crossovers)
+{
+#ifdef SMIP_FFTW_THREADS
+    fftw_init_threads();
+    fftwf_init_threads();
+#endif
+}
+
+FftPlanRegistry::~FftPlanRegistry()
+{
+    for (const auto& [key, plan] : m_plans) {
+        if (key.precision == FftPrecision::single_precision) {
+            fftwf_destroy_plan(static_cast<fftwf_plan>(plan));
+        } else {
+            fftw_destroy_plan(static_cast<fftw_plan>(plan));
+        }
+    }
+}
+
+void FftPlanRegistry::set_rigor(FftRigor rigor)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_rigor = rigor;
+}
+
+FftRigor FftPlanRegistry::rigor() const
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_rigor;
+}
+
+bool FftPlanRegistry::threads_supported() noexcept
+{
+#ifdef SMIP_FFTW_THREADS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FftPlanRegistry::set_max_threads(std::size_t nthreads)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_max_threads = (nthreads == 0) ? hardware_threads() : nthreads;
+    m_thread_generation.fetch_add(1, std::memory_order_release);
+}
+
+std::size_t FftPlanRegistry::max_threads() const
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_max_threads;
+}
+
+void FftPlanRegistry::set_thread_crossovers(std::vector<FftThreadCrossover> crossovers)
+{
+    std::sort(crossovers.begin(), crossovers.end(),
+        [](const FftThreadCrossover& a, const FftThreadCrossover& b) { return a.min_elements < b.min_elements; });
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_crossovers = std::move(crossovers);
+    m_thread_generation.fetch_add(1, std::memory_order_release);
+}
+
+std::vector<FftThreadCrossover> FftPlanRegistry::thread_crossovers() const
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_crossovers;
+}
+
+void FftPlanRegistry::calibrate_threads()
+{
+    if (!threads_supported()) {
+        return;
+    }
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<FftThreadCrossover> crossovers { { 0, 1 } };
+    for (std::size_t size { 32 }; size <= 1024; size *= 2) {
+        const std::size_t repetitions { std::clamp<std::size_t>((std::size_t { 1 } << 22) / (size * size), 2, 64) };
+        std::size_t best_threads { 1 };
+        double best_time { transform_time(size, 1, repetitions) };
+        for (std::size_t nthreads { 2 }; nthreads / 2 < m_max_threads; nthreads *= 2) {
+            const std::size_t threads { std::min(nthreads, m_max_threads) };
+            // more threads have to be clearly faster, since they are taken from the other work of the process
+            const double time { transform_time(size, threads, repetitions) };
+            if (time < 0.9 * best_time) {
+                best_time = time;
+                best_threads = threads;
+            }
+        }
+        if (best_threads != crossovers.back().threads) {
+            crossovers.push_back({ size * size, best_threads });
+        }
+    }
+    set_planner_threads(1);
+    m_crossovers = std::move(crossovers);
+    m_thread_generation.fetch_add(1, std::memory_order_release);
+}
+
+std::size_t FftPlanRegistry::threads_for(const FftPlanKey& key) const
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return lookup_threads(key);
+}
+
+std::size_t FftPlanRegistry::lookup_threads(const FftPlanKey& key) const
+{
+    if (!threads_supported()) {
+        return 1;
+    }
+    const std::size_t elements { key.xsize * key.ysize * key.howmany };
+    std::size_t threads { 1 };
+    for (const auto& crossover : m_crossovers) {
+        if (elements >= crossover.min_elements) {
+            threads = (crossover.threads == 0) ? m_max_threads : crossover.threads;
+        }
+    }
+    return std::clamp<std::size_t>(threads, 1, m_max_threads);
+}
+
+std::size_t FftPlanRegistry::size() const
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_plans.size();
+}
+
+void* FftPlanRegistry::plan(const FftPlanKey& key)
+{
+    auto it { m_plans.find(key) };
+    if (it != m_plans.end()) {
+        return it->second;
+    }
+    if (key.xsize == 0 || key.ysize == 0 || key.howmany == 0) {
+        throw std::runtime_error("FftPlanRegistry: empty transform");
+    }
+    if (key.howmany > 1 && key.in_place) {
+        throw std::runtime_error("FftPlanRegistry: batched transforms are out-of-place only");
+    }
+    const unsigned int flags { planner_flags(m_rigor, key.aligned) };
+    set_planner_threads(key.threads);
+    void* const plan { (key.precision == FftPrecision::single_precision)
+            ? static_cast<void*>(create_plan<float>(key, flags))
+            : static_cast<void*>(create_plan<double>(key, flags)) };
+    if (plan == nullptr) {
+        throw std::runtime_error("FftPlanRegistry: fftw failed to create plan");
+    }
+    m_plans.emplace(key, plan);
+    return plan;
+}
+
+bool FftPlanRegistry::import_wisdom(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if (!file) {
+        return false;
+    }
+    const std::string content { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    // the file holds the wisdom of both precisions, each one starts at the beginning of a line
+    std::vector<std::string> blocks {};
+    std::size_t start { content.find('(') };
+    while (start != std::string::npos) {
+        const std::size_t next { content.find("\n(", start) };
+        blocks.emplace_back(content.substr(start, (next == std::string::npos) ? next : next + 1 - start));
+        start = (next == std::string::npos) ? next : next + 1;
+    }
+    if (blocks.empty()) {
+        return false;
+    }
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    bool success { true };
+    for (const auto& block : blocks) {
+        // the wisdom of the other precision is rejected by the header check of fftw
+        if (fftw_import_wisdom_from_string(block.c_str()) == 0 && fftwf_import_wisdom_from_string(block.c_str()) == 0) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+bool FftPlanRegistry::export_wisdom(const std::string& filename) const
+{
+    std::string wisdom {};
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        wisdom = wisdom_string(fftw_export_wisdom_to_string, fftw_free)
+            + wisdom_string(fftwf_export_wisdom_to_string, fftwf_free);
+    }
+    std::ofstream file(filename, std::ios::trunc);
+    file << wisdom;
+    file.close();
+    return !file.fail();
+}
+
+} // namespace smip
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <complex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "constants.h"
+#include "frame_accumulator.h"
+#include "frame_prefetcher.h"
+#include "log.h"
+
+namespace smip {
+
+namespace {
+template <typename T, typename S>
+DimVector<double, 2> subpixel_displacement(CrossCorrelation<T>& correl, const S& spectrum)
+{
+    correl.correlate(spectrum);
+    return correl.get_subpixel_displacement();
+}
+
+/*! video frame index and pixel data of a decoded frame */
+using decoded_frame_t = std::pair<std::size_t, Array2<double>>;
+
+/*! add up to \e count frames from \e next_frame, which returns no frame at the end of the sequence */
+template <typename NextFrame>
+std::size_t accumulate_decoded(NextFrame&& next_frame, std::size_t count, FrameAccumulator& accumulator)
+{
+    std::size_t added { 0 };
+    if (accumulator.batch_size() > 1) {
+        const Array2<double>& ref { accumulator.sum_image() };
+        FrameStack stack(ref.ncols(), ref.nrows(), std::min(accumulator.batch_size(), std::max<std::size_t>(1, count)));
+        while (added < count) {
+            const auto frame { next_frame() };
+            if (!frame) {
+                break;
+            }
+            log::info() << "adding frame " << frame->first << " to batch";
+            stack.push_back(frame->second);
+            added++;
+            if (stack.full()) {
+                accumulator.add_frames(stack);
+                stack.clear();
+            }
+        }
+        accumulator.add_frames(stack);
+        return added;
+    }
+    while (added < count) {
+        const auto frame { next_frame() };
+        if (!frame) {
+            break;
+        }
+        log::info() << "adding frame " << frame->first << " to accumulator";
+        accumulator.add_frame(frame->second);
+        added++;
+    }
+    return added;
+}
+} // namespace
+
+FrameAccumulator::FrameAccumulator(const Array2<double>& ref_frame, std::size_t bispectrum_depth, bool with_bispectrum)
+    : m_cross_correl(ref_frame)
+    , m_ref_frame(ref_frame)
+    , m_frame(ref_frame.ncols(), ref_frame.nrows(), fft_buffer<double>(ref_frame.size()))
+    , m_spectrum(ref_frame.ncols() / 2 + 1, ref_frame.nrows(), fft_buffer<complex_t>((ref_frame.ncols() / 2 + 1) * ref_frame.nrows()))
+    , m_frame_spectrum({ ref_frame.ncols(), ref_frame.nrows() }, { ref_frame.ncols() / 2, ref_frame.nrows() / 2 })
+    , m_powerspec(ref_frame.ncols() / 2 + 1, ref_frame.nrows(), 0.)
+    , m_sum(ref_frame.ncols(), ref_frame.nrows(), 0.)
+    , m_with_bispectrum(with_bispectrum)
+{
+    if (m_with_bispectrum) {
+        m_bispectrum = Bispectrum<bispec_complex_t>({ ref_frame.ncols(), ref_frame.nrows(), bispectrum_depth, bispectrum_depth });
+    }
+    setup_plan();
+}
+
+FrameAccumulator::FrameAccumulator(const Array2<double>& ref_frame,
+    Bispectrum<bispec_complex_t>&& bispectrum,
+    Array2<double>&& powerspec,
+    Array2<double>&& sum)
+    : m_cross_correl(ref_frame)
+    , m_ref_frame(ref_frame)
+    , m_frame(ref_frame.ncols(), ref_frame.nrows(), fft_buffer<double>(ref_frame.size()))
+    , m_spectrum(ref_frame.ncols() / 2 + 1, ref_frame.nrows(), fft_buffer<complex_t>((ref_frame.ncols() / 2 + 1) * ref_frame.nrows()))
+    , m_frame_spectrum({ ref_frame.ncols(), ref_frame.nrows() }, { ref_frame.ncols() / 2, ref_frame.nrows() / 2 })
+    , m_bispectrum(std::move(bispectrum))
+    , m_powerspec(std::move(powerspec))
+    , m_sum(std::move(sum))
+    , m_with_bispectrum(m_bispectrum.size() > 0)
+{
+    if (m_powerspec.ncols() != m_spectrum.ncols() || m_powerspec.nrows() != m_spectrum.nrows()
+        || m_sum.ncols() != ref_frame.ncols() || m_sum.nrows() != ref_frame.nrows()) {
+        throw std::invalid_argument("FrameAccumulator: storage size does not match frame size");
+    }
+    setup_plan();
+}
+
+void FrameAccumulator::setup_plan()
+{
+    m_forward_plan = FftPlanRegistry::instance().executor<double>({ m_frame.ncols(), m_frame.nrows(), FftKind::r2c });
+}
+
+void FrameAccumulator::set_upsampling(std::size_t factor)
+{
+    m_cross_correl.set_upsampling(factor);
+    if (m_single_correl) {
+        m_single_correl->set_upsampling(factor);
+    }
+    if (factor > 1 && !m_backward_plan.valid()) {
+        m_shifted_spectrum = Array2<complex_t>(m_spectrum.ncols(), m_spectrum.nrows(), fft_buffer<complex_t>(m_spectrum.size()));
+        m_shifted_frame = Array2<double>(m_frame.ncols(), m_frame.nrows(), fft_buffer<double>(m_frame.size()));
+        m_x_ramp.resize(m_spectrum.ncols());
+        m_backward_plan = FftPlanRegistry::instance().executor<double>({ m_frame.ncols(), m_frame.nrows(), FftKind::c2r });
+    }
+}
+
+void FrameAccumulator::set_pyramid_levels(std::size_t levels)
+{
+    m_pyramid = (levels > 0) ? std::make_unique<PyramidCorrelation<double>>(m_ref_frame, levels) : nullptr;
+    m_pyramid_levels = levels;
+}
+
+void FrameAccumulator::set_batch_size(std::size_t frames)
+{
+    m_batch_size = std::max<std::size_t>(1, frames);
+}
+
+void FrameAccumulator::set_single_precision(bool single_precision)
+{
+    if (!single_precision) {
+        m_single_correl.reset();
+        return;
+    }
+    if (!m_single_correl) {
+        m_single_correl = std::make_unique<CrossCorrelation<float>>(Array2<float>(m_ref_frame));
+        m_single_correl->set_upsampling(upsampling());
+        m_single_frame = Array2<float>(m_frame.ncols(), m_frame.nrows(), fft_buffer<float, float>(m_frame.size()));
+        m_single_spectrum = Array2<std::complex<float>>(m_spectrum.ncols(), m_spectrum.nrows(), fft_buffer<std::complex<float>, float>(m_spectrum.size()));
+        m_single_plan = FftPlanRegistry::instance().executor<float>({ m_frame.ncols(), m_frame.nrows(), FftKind::r2c });
+    }
+}
+
+template <typename R>
+void FrameAccumulator::add_shifted(const Array2<std::complex<R>>& spectrum, const DimVector<double, 2>& shift)
+{
+    // the frame shifted by -shift has the spectrum multiplied by exp(2 pi i k*shift/N), at the nyquist
+    // frequencies of even sizes only the real part of the ramp keeps the shifted frame real
+    const std::size_t ncols { m_frame.ncols() };
+    const std::size_t nrows { m_frame.nrows() };
+    const std::size_t hcols { m_spectrum.ncols() };
+    const auto ramp = [](double frequency, double distance, std::size_t size, bool nyquist) {
+        const double phase { 2. * constants::pi<double> * frequency * distance / static_cast<double>(size) };
+        return nyquist ? complex_t { std::cos(phase), 0. } : std::polar(1., phase);
+    };
+    for (std::size_t kx { 0 }; kx < hcols; ++kx) {
+        m_x_ramp[kx] = ramp(static_cast<double>(kx), shift[0], ncols, 2 * kx == ncols);
+    }
+    // the back transform is not normalized
+    const double norm { 1. / static_cast<double>(m_frame.size()) };
+    const std::complex<R>* const data { spectrum.data().get() };
+    complex_t* const shifted { m_shifted_spectrum.data().get() };
+    for (std::size_t ky { 0 }; ky < nrows; ++ky) {
+        const double frequency { (2 * ky < nrows) ? static_cast<double>(ky) : static_cast<double>(ky) - static_cast<double>(nrows) };
+        const complex_t y_ramp { ramp(frequency, shift[1], nrows, 2 * ky == nrows) * norm };
+        for (std::size_t kx { 0 }; kx < hcols; ++kx) {
+            shifted[ky * hcols + kx] = static_cast<complex_t>(data[ky * hcols + kx]) * m_x_ramp[kx] * y_ramp;
+        }
+    }
+    m_backward_plan.execute(shifted, m_shifted_frame.data().get());
+    m_sum += m_shifted_frame;
+}
+
+void FrameAccumulator::add_frame(const Array2<double>& frame)
+{
+    if (frame.ncols() != m_frame.ncols() || frame.nrows() != m_frame.nrows()) {
+        throw std::invalid_argument("FrameAccumulator::add_frame(const Array2) : frame size mismatch");
+    }
+    log::info() << "executing fft";
+    if (m_single_correl) {
+        std::transform(frame.begin(), frame.end(), m_single_frame.begin(), [](double val) { return static_cast<float>(val); });
+        m_single_plan.execute(m_single_frame.data().get(), m_single_spectrum.data().get());
+        accumulate(frame, m_single_spectrum);
+        return;
+    }
+    std::copy(frame.begin(), frame.end(), m_frame.begin());
+    m_forward_plan.execute(m_frame.data().get(), m_spectrum.data().get());
+    accumulate(frame, m_spectrum);
+}
+
+void FrameAccumulator::add_frames(FrameStack& stack)
+{
+    if (stack.xsize() != m_frame.ncols() || stack.ysize() != m_frame.nrows()) {
+        throw std::invalid_argument("FrameAccumulator::add_frames(FrameStack) : frame size mismatch");
+    }
+    if (!stack.transformed()) {
+        log::info() << "executing batched fft of " << stack.size() << " frames";
+        stack.transform();
+    }
+    for (std::size_t i { 0 }; i < stack.size(); ++i) {
+        accumulate(stack.frame(i), stack.spectrum(i));
+    }
+}
+
+template <typename R>
+void FrameAccumulator::accumulate(const Array2<double>& frame, const Array2<std::complex<R>>& spectrum)
+{
+    m_frame_spectrum.assign_halfplane(spectrum);
+
+    // calculate shift of frame wrt ref frame through cross correlation
+    if (upsampling() > 1) {
+        const auto xyshift { m_single_correl ? subpixel_displacement(*m_single_correl, m_frame_spectrum)
+                                             : subpixel_displacement(m_cross_correl, m_frame_spectrum) };
+        log::info() << "relative shift wrt ref frame: [x,y] = " << xyshift;
+        log::info() << "adding back-shifted frame to sum image";
+        add_shifted(spectrum, xyshift);
+    } else {
+        DimVector<int, 2> xyshift {};
+        if (m_pyramid) {
+            xyshift = (*m_pyramid)(frame);
+        } else if (m_single_correl) {
+            xyshift = (*m_single_correl)(m_frame_spectrum);
+        } else {
+            xyshift = m_cross_correl(m_frame_spectrum);
+        }
+        log::info() << "relative shift wrt ref frame: [x,y] = " << xyshift;
+        log::info() << "adding back-shifted frame to sum image";
+        m_sum += frame.shifted(-xyshift);
+    }
+
+    if (m_spectrum_callback) {
+        m_spectrum_callback(m_frame_spectrum);
+    }
+    if (m_with_bispectrum) {
+        log::info() << "accumulating fft to mean bispectrum";
+        m_bispectrum.accumulate_from_fft(m_frame_spectrum);
+    }
+    log::info() << "adding power spectrum to mean power spectrum";
+    std::transform(spectrum.begin(), spectrum.end(), m_powerspec.begin(), m_powerspec.begin(),
+        [](const complex_t& val, double ps) { return ps + std::norm(val); });
+    m_nframes++;
+}
+
+void FrameAccumulator::merge(const Bispectrum<bispec_complex_t>& bispectrum,
+    const Array2<double>& powerspec,
+    const Array2<double>& sum,
+    std::size_t nframes)
+{
+    if (powerspec.ncols() != m_powerspec.ncols() || powerspec.nrows() != m_powerspec.nrows()
+        || sum.ncols() != m_sum.ncols() || sum.nrows() != m_sum.nrows()
+        || (m_with_bispectrum && !(bispectrum.dimsizes() == m_bispectrum.dimsizes()))) {
+        throw std::invalid_argument("FrameAccumulator::merge : size mismatch");
+    }
+    if (m_with_bispectrum) {
+        m_bispectrum += bispectrum;
+    }
+    m_powerspec += powerspec;
+    m_sum += sum;
+    m_nframes += nframes;
+}
+
+std::size_t accumulate_frames(FrameExtractor& fe,
+    color_channel_t color_channel,
+    std::size_t first_frame,
+    std::size_t count,
+    FrameAccumulator& accumulator)
+{
+    if (accumulator.prefetch_depth() > 0) {
+        FramePrefetcher prefetcher(fe, first_frame, count, accumulator.prefetch_depth());
+        return accumulate_decoded(
+            [&prefetcher, color_channel]() -> std::optional<decoded_frame_t> {
+                // the buffer returns to the decoder as soon as the frame is converted
+                const FramePrefetcher::Handle handle { prefetcher.next() };
+                if (!handle) {
+                    return std::nullopt;
+                }
+                return decoded_frame_t { handle.index(), Mat2Array<double>(handle.frame(), color_channel) };
+            },
+            count, accumulator);
+    }
+    fe.seek(first_frame);
+    return accumulate_decoded(
+        [&fe, color_channel]() -> std::optional<decoded_frame_t> {
+            cv::Mat& frame { fe.extract_next_frame() };
+            if (frame.empty()) {
+                return std::nullopt;
+            }
+            return decoded_frame_t { fe.current_frame() - 1, Mat2Array<double>(frame, color_channel) };
+        },
+        count, accumulator);
+}
+
+} // namespace smip
@@ -0,0 +1,131 @@
+#include <stdexcept>
+#include <utility>
+
+#include "frame_prefetcher.h"
+
+namespace smip {
+
+FramePrefetcher::Handle::Handle(Handle&& other) noexcept
+    : m_owner(std::exchange(other.m_owner, nullptr))
+    , m_slot(other.m_slot)
+{
+}
+
+FramePrefetcher::Handle& FramePrefetcher::Handle::operator=(Handle&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_owner = std::exchange(other.m_owner, nullptr);
+        m_slot = other.m_slot;
+    }
+    return *this;
+}
+
+cv::Mat& FramePrefetcher::Handle::frame() const
+{
+    if (m_owner == nullptr) {
+        throw std::logic_error("FramePrefetcher::Handle::frame() : empty handle");
+    }
+    return m_owner->m_slots[m_slot].frame;
+}
+
+std::size_t FramePrefetcher::Handle::index() const
+{
+    if (m_owner == nullptr) {
+        throw std::logic_error("FramePrefetcher::Handle::index() : empty handle");
+    }
+    return m_owner->m_slots[m_slot].index;
+}
+
+void FramePrefetcher::Handle::release() noexcept
+{
+    if (m_owner != nullptr) {
+        std::exchange(m_owner, nullptr)->recycle(m_slot);
+    }
+}
+
+FramePrefetcher::FramePrefetcher(FrameExtractor& fe, std::size_t first_frame, std::size_t count, std::size_t capacity)
+    : m_extractor(fe)
+    , m_slots(capacity)
+{
+    if (capacity == 0) {
+        throw std::invalid_argument("FramePrefetcher: capacity must not be zero");
+    }
+    // the decoder takes the buffers from the back
+    for (std::size_t slot { capacity }; slot > 0; --slot) {
+        m_free.push_back(slot - 1);
+    }
+    m_decoder = std::thread(&FramePrefetcher::decode, this, first_frame, count);
+}
+
+FramePrefetcher::~FramePrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_buffer_free.notify_all();
+    m_decoder.join();
+}
+
+void FramePrefetcher::decode(std::size_t first_frame, std::size_t count)
+{
+    try {
+        m_extractor.seek(first_frame);
+        for (std::size_t n { 0 }; n < count; ++n) {
+            std::size_t slot {};
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_buffer_free.wait(lock, [this]() { return m_stop || !m_free.empty(); });
+                if (m_stop) {
+                    break;
+                }
+                slot = m_free.back();
+                m_free.pop_back();
+            }
+            // the buffer is owned by the decoder until it is queued
+            Slot& buffer { m_slots[slot] };
+            buffer.index = m_extractor.current_frame();
+            const bool decoded { m_extractor.extract_next_frame(buffer.frame) };
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!decoded) {
+                m_free.push_back(slot);
+                break;
+            }
+            m_ready.push_back(slot);
+            m_frame_ready.notify_one();
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finished = true;
+    m_frame_ready.notify_all();
+}
+
+FramePrefetcher::Handle FramePrefetcher::next()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_frame_ready.wait(lock, [this]() { return m_finished || !m_ready.empty(); });
+    if (!m_ready.empty()) {
+        const std::size_t slot { m_ready.front() };
+        m_ready.pop_front();
+        return { this, slot };
+    }
+    if (m_error) {
+        std::rethrow_exception(std::exchange(m_error, nullptr));
+    }
+    return {};
+}
+
+void FramePrefetcher::recycle(std::size_t slot)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(slot);
+    }
+    m_buffer_free.notify_one();
+}
+
+} // namespace smip
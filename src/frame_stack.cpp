@@ -0,0 +1,64 @@
+#include "frame_stack.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace smip {
+
+FrameStack::FrameStack(std::size_t xsize, std::size_t ysize, std::size_t capacity)
+    : m_xsize(xsize)
+    , m_ysize(ysize)
+{
+    if (xsize == 0 || ysize == 0 || capacity == 0) {
+        throw std::invalid_argument("FrameStack: empty frames or zero capacity");
+    }
+    const std::size_t frame_distance { fft_batch_distance(xsize * ysize) };
+    const std::size_t spectrum_distance { fft_batch_distance((xsize / 2 + 1) * ysize) };
+    m_frame_buffer = fft_buffer<double>(capacity * frame_distance);
+    m_spectrum_buffer = fft_buffer<complex_t>(capacity * spectrum_distance);
+    m_frames.reserve(capacity);
+    m_spectra.reserve(capacity);
+    for (std::size_t i { 0 }; i < capacity; ++i) {
+        // the views share the ownership of the buffers
+        m_frames.emplace_back(xsize, ysize, std::shared_ptr<double[]>(m_frame_buffer, m_frame_buffer.get() + i * frame_distance));
+        m_spectra.emplace_back(xsize / 2 + 1, ysize, std::shared_ptr<complex_t[]>(m_spectrum_buffer, m_spectrum_buffer.get() + i * spectrum_distance));
+    }
+    FftPlanRegistry& registry { FftPlanRegistry::instance() };
+    m_frame_plan = registry.executor<double>({ xsize, ysize, FftKind::r2c });
+    if (capacity > 1) {
+        m_batch_plan = registry.executor<double>({ xsize, ysize, FftKind::r2c, FftPrecision::double_precision, true, false, capacity });
+    }
+}
+
+void FrameStack::push_back(const Array2<double>& frame)
+{
+    if (frame.ncols() != m_xsize || frame.nrows() != m_ysize) {
+        throw std::invalid_argument("FrameStack::push_back : frame size mismatch");
+    }
+    if (full()) {
+        throw std::length_error("FrameStack::push_back : stack is full");
+    }
+    std::copy(frame.begin(), frame.end(), m_frames[m_size].begin());
+    m_size++;
+    m_transformed = false;
+}
+
+void FrameStack::transform()
+{
+    if (full() && m_batch_plan.valid()) {
+        m_batch_plan.execute(m_frame_buffer.get(), m_spectrum_buffer.get());
+    } else {
+        for (std::size_t i { 0 }; i < m_size; ++i) {
+            m_frame_plan.execute(m_frames[i].data().get(), m_spectra[i].data().get());
+        }
+    }
+    m_transformed = true;
+}
+
+void FrameStack::clear() noexcept
+{
+    m_size = 0;
+    m_transformed = false;
+}
+
+} // namespace smip
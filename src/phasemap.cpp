@@ -1,5 +1,6 @@
 #include <cmath>
 #include <complex>
+#include <cstdint>
 #include <cstdlib>
 #include <errno.h>
 #include <fstream>
@@ -24,4 +25,69 @@ PhaseMapElement::PhaseMapElement(bool a_flag, double a_consistency)
 {
 }
 
+PhaseMap::PhaseMap(std::size_t xsize, std::size_t ysize)
+    : m_xsize(xsize)
+    , m_ysize(ysize)
+    , m_flags((xsize * ysize + 63) / 64, 0)
+    , m_consistency(xsize * ysize, 0.f)
+{
+}
+
+PhaseMap::s_indices PhaseMap::min_sindices() const
+{
+    return { -static_cast<int>(m_xsize >> 1), -static_cast<int>(m_ysize >> 1) };
+}
+
+PhaseMap::s_indices PhaseMap::max_sindices() const
+{
+    return {
+        -static_cast<int>(m_xsize) / 2 + static_cast<int>(m_xsize) - 1,
+        -static_cast<int>(m_ysize) / 2 + static_cast<int>(m_ysize) - 1
+    };
+}
+
+Range<DimVector<int, 2>> PhaseMap::range() const
+{
+    return Range<DimVector<int, 2>>(min_sindices(), max_sindices());
+}
+
+std::size_t PhaseMap::offset(s_indices indices) const noexcept
+{
+    if (indices[0] < 0)
+        indices[0] += static_cast<int>(m_xsize);
+    if (indices[1] < 0)
+        indices[1] += static_cast<int>(m_ysize);
+    return static_cast<std::size_t>(indices[0]) + static_cast<std::size_t>(indices[1]) * m_xsize;
+}
+
+void PhaseMap::set(std::size_t offset, const PhaseMapElement& element) noexcept
+{
+    const std::uint64_t mask { std::uint64_t { 1 } << (offset & 63) };
+    if (element.flag) {
+        m_flags[offset >> 6] |= mask;
+    } else {
+        m_flags[offset >> 6] &= ~mask;
+    }
+    m_consistency[offset] = static_cast<float>(element.consistency);
+}
+
+Array2<PhaseMapElement> PhaseMap::to_array() const
+{
+    Array2<PhaseMapElement> arr(m_xsize, m_ysize);
+    for (std::size_t i { 0 }; i < size(); ++i) {
+        arr.data()[i] = (*this)[i];
+    }
+    return arr;
+}
+
+bool PhaseMap::operator==(const PhaseMap& other) const
+{
+    return same_flags(other) && m_consistency == other.m_consistency;
+}
+
+bool PhaseMap::same_flags(const PhaseMap& other) const noexcept
+{
+    return m_xsize == other.m_xsize && m_ysize == other.m_ysize && m_flags == other.m_flags;
+}
+
 } // namespace smip
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <errno.h>
+#include <stdexcept>
+#include <string>
+
+#include "reconstruction_plan.h"
+
+namespace smip {
+
+namespace {
+constexpr std::uint32_t c_plan_magic { 0x504f4352 }; // "RCOP"
+constexpr std::uint32_t c_plan_version { 5 };
+
+/*! writes \e records as \e N fixed-width words each, as returned by \e pack, independent of the struct layout */
+template <typename Word, std::size_t N, typename T, typename Pack>
+bool write_records(FILE* stream, const std::vector<T>& records, Pack pack)
+{
+    std::vector<Word> words {};
+    words.reserve(N * records.size());
+    for (const auto& record : records) {
+        const std::array<Word, N> fields { pack(record) };
+        words.insert(words.end(), fields.begin(), fields.end());
+    }
+    return fwrite(words.data(), sizeof(Word), words.size(), stream) == words.size();
+}
+
+/*! reads \e records written by write_records(), each built by \e unpack from its \e N words */
+template <typename Word, std::size_t N, typename T, typename Unpack>
+bool read_records(FILE* stream, std::vector<T>& records, Unpack unpack)
+{
+    std::vector<Word> words(N * records.size());
+    if (fread(words.data(), sizeof(Word), words.size(), stream) != words.size()) {
+        return false;
+    }
+    for (std::size_t i { 0 }; i < records.size(); ++i) {
+        records[i] = unpack(&words[N * i]);
+    }
+    return true;
+}
+} // namespace
+
+std::uint32_t ReconstructionPlan::phase_offset(const DimVector<int, 2>& indices) const noexcept
+{
+    const std::size_t x { static_cast<std::size_t>(indices[0] < 0 ? indices[0] + static_cast<int>(m_xsize) : indices[0]) };
+    const std::size_t y { static_cast<std::size_t>(indices[1] < 0 ? indices[1] + static_cast<int>(m_ysize) : indices[1]) };
+    return static_cast<std::uint32_t>(x + y * m_xsize);
+}
+
+std::size_t ReconstructionPlan::max_npairs() const noexcept
+{
+    std::size_t npairs { 0 };
+    for (const auto& target : m_targets) {
+        npairs = std::max<std::size_t>(npairs, target.npairs);
+    }
+    return npairs;
+}
+
+bool ReconstructionPlan::matches(const bispectrum_extents& bispectrum_dims, std::size_t xsize, std::size_t ysize, double reco_radius) const noexcept
+{
+    return xsize == m_xsize && ysize == m_ysize && reco_radius == m_reco_radius
+        && bispectrum_dims == m_bispectrum_dims;
+}
+
+void ReconstructionPlan::write_to_file(const std::string& filename) const
+{
+    FILE* stream;
+
+    errno = 0;
+    stream = fopen(filename.c_str(), "wb");
+    if (stream == NULL) {
+        throw std::runtime_error("unable to open file " + filename + " for writing");
+    }
+    const std::uint64_t header[] {
+        c_plan_magic, c_plan_version,
+        m_xsize, m_ysize,
+        m_bispectrum_dims[0], m_bispectrum_dims[1], m_bispectrum_dims[2], m_bispectrum_dims[3],
+        m_visit_order.size(), m_targets.size(), m_pairs.size(), m_shell_offsets.size()
+    };
+    bool success { true };
+    success = success && fwrite(header, sizeof(header), 1, stream) == 1;
+    success = success && fwrite(&m_reco_radius, sizeof(m_reco_radius), 1, stream) == 1;
+    success = success && fwrite(m_visit_order.data(), sizeof(std::uint32_t), m_visit_order.size(), stream) == m_visit_order.size();
+    success = success && write_records<std::uint64_t, 3>(stream, m_targets, [](const Target& target) {
+        return std::array<std::uint64_t, 3> { target.phase_offset, target.npairs, target.first_pair };
+    });
+    success = success && write_records<std::uint32_t, 2>(stream, m_pairs, [](const Pair& pair) {
+        return std::array<std::uint32_t, 2> { pair.u_offset, pair.v_offset };
+    });
+    // the location is stored as offset << 1 | conjugate
+    success = success && write_records<std::uint64_t, 1>(stream, m_locations, [](const BispectrumLocation& location) {
+        return std::array<std::uint64_t, 1> { std::uint64_t { location.offset } << 1 | location.conjugate };
+    });
+    success = success && fwrite(m_shell_offsets.data(), sizeof(std::uint64_t), m_shell_offsets.size(), stream) == m_shell_offsets.size();
+    fclose(stream);
+    if (!success) {
+        throw std::runtime_error("error writing reconstruction plan to file " + filename);
+    }
+}
+
+void ReconstructionPlan::read_from_file(const std::string& filename)
+{
+    FILE* stream;
+
+    errno = 0;
+    stream = fopen(filename.c_str(), "rb");
+    if (stream == NULL) {
+        throw std::runtime_error("unable to open file " + filename);
+    }
+    std::uint64_t header[12] {};
+    double reco_radius {};
+    bool success { fread(header, sizeof(header), 1, stream) == 1 && fread(&reco_radius, sizeof(reco_radius), 1, stream) == 1 };
+    if (!success || header[0] != c_plan_magic || header[1] != c_plan_version) {
+        fclose(stream);
+        throw std::runtime_error("file " + filename + " is not a reconstruction plan of this version");
+    }
+    std::vector<std::uint32_t> visit_order(header[8]);
+    std::vector<Target> targets(header[9]);
+    std::vector<Pair> pairs(header[10]);
+    std::vector<BispectrumLocation> locations(header[10]);
+    std::vector<std::uint64_t> shell_offsets(header[11]);
+    success = success && fread(visit_order.data(), sizeof(std::uint32_t), visit_order.size(), stream) == visit_order.size();
+    success = success && read_records<std::uint64_t, 3>(stream, targets, [](const std::uint64_t* fields) {
+        return Target { static_cast<std::uint32_t>(fields[0]), static_cast<std::uint32_t>(fields[1]), fields[2] };
+    });
+    success = success && read_records<std::uint32_t, 2>(stream, pairs, [](const std::uint32_t* fields) {
+        return Pair { fields[0], fields[1] };
+    });
+    success = success && read_records<std::uint64_t, 1>(stream, locations, [](const std::uint64_t* fields) {
+        return BispectrumLocation { fields[0] >> 1, fields[0] & 1 };
+    });
+    success = success && fread(shell_offsets.data(), sizeof(std::uint64_t), shell_offsets.size(), stream) == shell_offsets.size();
+    fclose(stream);
+    if (!success) {
+        throw std::runtime_error("error reading reconstruction plan from file " + filename);
+    }
+    // reject inconsistent plans instead of accessing out of bounds later on
+    const std::uint64_t phase_size { header[2] * header[3] };
+    const std::uint64_t bispectrum_size { Bispectrum<bispec_complex_t>::base_size({ header[4], header[5], header[6], header[7] }) };
+    for (const auto& target : targets) {
+        if (target.phase_offset >= phase_size || target.first_pair + target.npairs > pairs.size()) {
+            throw std::runtime_error("inconsistent reconstruction plan in file " + filename);
+        }
+    }
+    for (const auto& pair : pairs) {
+        if (pair.u_offset >= phase_size || pair.v_offset >= phase_size) {
+            throw std::runtime_error("inconsistent reconstruction plan in file " + filename);
+        }
+    }
+    if (std::any_of(locations.begin(), locations.end(), [&](const BispectrumLocation& location) { return location.offset >= bispectrum_size; })) {
+        throw std::runtime_error("inconsistent reconstruction plan in file " + filename);
+    }
+    if (std::any_of(visit_order.begin(), visit_order.end(), [&](std::uint32_t index) { return index >= targets.size(); })) {
+        throw std::runtime_error("inconsistent reconstruction plan in file " + filename);
+    }
+    if (shell_offsets.empty() || shell_offsets.front() != 0 || shell_offsets.back() != visit_order.size()
+        || !std::is_sorted(shell_offsets.begin(), shell_offsets.end())) {
+        throw std::runtime_error("inconsistent reconstruction plan in file " + filename);
+    }
+    m_xsize = header[2];
+    m_ysize = header[3];
+    m_bispectrum_dims = { header[4], header[5], header[6], header[7] };
+    m_reco_radius = reco_radius;
+    m_visit_order = std::move(visit_order);
+    m_targets = std::move(targets);
+    m_pairs = std::move(pairs);
+    m_locations = std::move(locations);
+    m_shell_offsets = std::move(shell_offsets);
+}
+
+} // namespace smip
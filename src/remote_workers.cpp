@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <poll.h>
+#endif
+
+#include "log.h"
+#include "remote_workers.h"
+
+namespace smip::net {
+
+std::vector<WorkerAddress> parse_worker_list(const std::string& list)
+{
+    std::vector<WorkerAddress> workers {};
+    std::istringstream istr(list);
+    for (std::string item; std::getline(istr, item, ',');) {
+        if (item.empty()) {
+            continue;
+        }
+        WorkerAddress address {};
+        const auto colon { item.rfind(':') };
+        address.host = item.substr(0, colon);
+        if (colon != std::string::npos) {
+            const unsigned long port { std::stoul(item.substr(colon + 1)) };
+            if (port == 0 || port > 65535) {
+                throw std::invalid_argument("invalid worker port in '" + item + "'");
+            }
+            address.port = static_cast<std::uint16_t>(port);
+        }
+        if (address.host.empty()) {
+            throw std::invalid_argument("missing worker host in '" + item + "'");
+        }
+        workers.push_back(address);
+    }
+    return workers;
+}
+
+#ifdef _WIN32
+
+std::size_t accumulate_frames_remote(const std::vector<WorkerAddress>& /*workers*/,
+    const std::string& /*filename*/,
+    color_channel_t /*color_channel*/,
+    const Array2<double>& /*ref_frame*/,
+    std::size_t /*first_frame*/,
+    std::size_t /*count*/,
+    std::size_t /*chunk_size*/,
+    FrameAccumulator& /*accumulator*/,
+    std::chrono::milliseconds /*chunk_timeout*/)
+{
+    throw std::runtime_error("accumulate_frames_remote: TCP workers are not supported on this platform");
+}
+
+#else
+
+namespace {
+
+struct Chunk {
+    std::size_t first_frame {};
+    std::size_t count {};
+};
+
+struct WorkerConnection {
+    WorkerAddress address {};
+    TcpSocket socket {};
+    std::optional<Chunk> chunk {};
+    std::uint64_t job_id { 0 };
+    /*! time the outstanding chunk was sent */
+    std::chrono::steady_clock::time_point sent {};
+};
+
+std::string to_string(const WorkerAddress& address)
+{
+    return address.host + ":" + std::to_string(address.port);
+}
+
+} // namespace
+
+std::size_t accumulate_frames_remote(const std::vector<WorkerAddress>& workers,
+    const std::string& filename,
+    color_channel_t color_channel,
+    const Array2<double>& ref_frame,
+    std::size_t first_frame,
+    std::size_t count,
+    std::size_t chunk_size,
+    FrameAccumulator& accumulator,
+    std::chrono::milliseconds chunk_timeout)
+{
+    using clock = std::chrono::steady_clock;
+    if (chunk_size == 0) {
+        chunk_size = std::max<std::size_t>(1, count / (4 * std::max<std::size_t>(1, workers.size())));
+    }
+    std::deque<Chunk> pending {};
+    for (std::size_t frame { first_frame }; frame < first_frame + count; frame += chunk_size) {
+        pending.push_back({ frame, std::min(chunk_size, first_frame + count - frame) });
+    }
+
+    AccumulationJob job {};
+    job.filename = filename;
+    job.color_channel = color_channel;
+    job.bispectrum_depth = accumulator.bispectrum().dimsizes()[2];
+    job.upsampling = accumulator.upsampling();
+    job.pyramid_levels = accumulator.pyramid_levels();
+    job.single_precision = accumulator.single_precision();
+    job.with_bispectrum = accumulator.with_bispectrum();
+    job.ref_frame = ref_frame;
+
+    std::vector<WorkerConnection> connections {};
+    for (const auto& address : workers) {
+        try {
+            connections.push_back({ address, TcpSocket::connect(address.host, address.port) });
+            log::info() << "connected to worker " << to_string(address);
+        } catch (const ConnectionError& e) {
+            log::error() << "worker " << to_string(address) << ": " << e.what();
+        }
+    }
+
+    // drop a failed worker and requeue its outstanding chunk for the remaining workers
+    auto fail = [&](WorkerConnection& worker, const std::string& reason) {
+        log::error() << "worker " << to_string(worker.address) << " failed: " << reason;
+        if (worker.chunk) {
+            log::notice() << "resending frames " << worker.chunk->first_frame << "-"
+                          << worker.chunk->first_frame + worker.chunk->count - 1;
+            pending.push_front(*worker.chunk);
+            worker.chunk.reset();
+        }
+        worker.socket.close();
+    };
+    std::uint64_t next_job_id { 1 };
+    auto dispatch = [&]() {
+        for (auto& worker : connections) {
+            if (pending.empty()) {
+                return;
+            }
+            if (!worker.socket.is_open() || worker.chunk) {
+                continue;
+            }
+            worker.chunk = pending.front();
+            pending.pop_front();
+            job.id = worker.job_id = next_job_id++;
+            job.first_frame = worker.chunk->first_frame;
+            job.count = worker.chunk->count;
+            worker.sent = clock::now();
+            try {
+                worker.socket.send_message(MessageType::Job, serialize(job));
+                log::debug() << "sent job " << job.id << " (frames " << job.first_frame << "-"
+                             << job.first_frame + job.count - 1 << ") to " << to_string(worker.address);
+            } catch (const ConnectionError& e) {
+                fail(worker, e.what());
+            }
+        }
+    };
+
+    std::size_t merged { 0 };
+    for (dispatch();;) {
+        std::vector<pollfd> fds {};
+        std::vector<WorkerConnection*> busy {};
+        for (auto& worker : connections) {
+            if (worker.socket.is_open() && worker.chunk) {
+                fds.push_back({ worker.socket.fd(), POLLIN, 0 });
+                busy.push_back(&worker);
+            }
+        }
+        if (busy.empty()) {
+            break;
+        }
+        // wait at most until the earliest deadline of the outstanding chunks
+        clock::time_point deadline { clock::time_point::max() };
+        for (const WorkerConnection* worker : busy) {
+            deadline = std::min(deadline, worker->sent + chunk_timeout);
+        }
+        const auto wait { std::chrono::ceil<std::chrono::milliseconds>(std::max(deadline - clock::now(), clock::duration::zero())) };
+        const int timeout_ms { static_cast<int>(std::min<std::chrono::milliseconds::rep>(wait.count(), std::numeric_limits<int>::max())) };
+        if (::poll(fds.data(), fds.size(), timeout_ms) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("poll on worker connections failed: " + std::string(std::strerror(errno)));
+        }
+        for (std::size_t i { 0 }; i < fds.size(); ++i) {
+            WorkerConnection& worker { *busy[i] };
+            if (fds[i].revents == 0) {
+                if (clock::now() - worker.sent >= chunk_timeout) {
+                    fail(worker, "no result within " + std::to_string(chunk_timeout.count()) + " ms");
+                }
+                continue;
+            }
+            try {
+                auto msg { worker.socket.receive_message() };
+                if (!msg) {
+                    throw ConnectionError("connection closed");
+                }
+                if (msg->type == MessageType::Error) {
+                    throw ConnectionError(std::string(reinterpret_cast<const char*>(msg->payload.data()), msg->payload.size()));
+                }
+                if (msg->type != MessageType::Result) {
+                    throw ConnectionError("protocol error: unexpected message type");
+                }
+                AccumulationResult result { deserialize_result(msg->payload) };
+                if (result.job_id != worker.job_id) {
+                    throw ConnectionError("protocol error: result for unknown job " + std::to_string(result.job_id));
+                }
+                if (result.nframes != worker.chunk->count) {
+                    throw ConnectionError("incomplete result: " + std::to_string(result.nframes) + " of "
+                        + std::to_string(worker.chunk->count) + " frames accumulated");
+                }
+                log::info() << "merging " << result.nframes << " frames from worker " << to_string(worker.address);
+                accumulator.merge(result.bispectrum, result.powerspec, result.sum, result.nframes);
+                merged += result.nframes;
+                worker.chunk.reset();
+            } catch (const std::exception& e) {
+                fail(worker, e.what());
+            }
+        }
+        dispatch();
+    }
+    if (!pending.empty()) {
+        log::error() << "no workers left, " << pending.size() << " chunks of frames were not accumulated";
+    }
+    return merged;
+}
+
+#endif
+
+} // namespace smip::net
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <opencv2/core.hpp>
+
+#include "bispectrum.h"
+#include "fft_plans.h"
+#include "log.h"
+#include "shm_workers.h"
+#include "videoio.h"
+
+namespace smip {
+
+#ifdef _WIN32
+
+std::size_t accumulate_frames_forked(const std::string& /*filename*/,
+    color_channel_t /*color_channel*/,
+    const Array2<double>& /*ref_frame*/,
+    std::size_t /*first_frame*/,
+    std::size_t /*count*/,
+    std::size_t /*nprocesses*/,
+    FrameAccumulator& /*accumulator*/)
+{
+    throw std::runtime_error("accumulate_frames_forked: multi-process accumulation is not supported on this platform");
+}
+
+#else
+
+namespace {
+
+constexpr std::size_t c_alignment { 64 };
+
+constexpr std::size_t aligned(std::size_t bytes)
+{
+    return (bytes + c_alignment - 1) / c_alignment * c_alignment;
+}
+
+/*! per-worker bookkeeping at the start of each partition, written by the worker only */
+struct PartitionHeader {
+    std::size_t nframes { 0 };
+    int done { 0 };
+};
+
+/*! anonymous shared memory mapping, inherited by forked children */
+class SharedSegment {
+public:
+    explicit SharedSegment(std::size_t size)
+        : m_size(size)
+    {
+        static std::size_t counter { 0 };
+        const std::string name { "/smip-" + std::to_string(::getpid()) + "-" + std::to_string(counter++) };
+        int fd { ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600) };
+        if (fd < 0) {
+            throw std::runtime_error("shm_open failed: " + std::string(std::strerror(errno)));
+        }
+        // unlink immediately, the segment lives as long as it is mapped
+        ::shm_unlink(name.c_str());
+        if (::ftruncate(fd, static_cast<off_t>(m_size)) != 0) {
+            const int err { errno };
+            ::close(fd);
+            throw std::runtime_error("ftruncate of shared memory segment failed: " + std::string(std::strerror(err)));
+        }
+        void* addr { ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) };
+        const int err { errno };
+        ::close(fd);
+        if (addr == MAP_FAILED) {
+            throw std::runtime_error("mmap of shared memory segment failed: " + std::string(std::strerror(err)));
+        }
+        m_data = static_cast<std::byte*>(addr);
+    }
+    SharedSegment(const SharedSegment&) = delete;
+    SharedSegment& operator=(const SharedSegment&) = delete;
+    ~SharedSegment() { ::munmap(m_data, m_size); }
+
+    std::byte* data() const noexcept { return m_data; }
+
+private:
+    std::size_t m_size {};
+    std::byte* m_data { nullptr };
+};
+
+/*! non-owning view of a typed region within the shared segment */
+template <typename T>
+std::shared_ptr<T[]> view(std::byte* addr)
+{
+    return std::shared_ptr<T[]>(reinterpret_cast<T*>(addr), [](T*) {});
+}
+
+/*! layout of one worker partition: header | bispectrum | power spectrum | sum image */
+struct PartitionLayout {
+    std::size_t bispectrum_offset {};
+    std::size_t powerspec_offset {};
+    std::size_t sum_offset {};
+    std::size_t size {};
+
+    PartitionLayout(std::size_t bispectrum_size, std::size_t powerspec_size, std::size_t frame_size)
+        : bispectrum_offset(aligned(sizeof(PartitionHeader)))
+        , powerspec_offset(bispectrum_offset + aligned(bispectrum_size * sizeof(bispec_complex_t)))
+        , sum_offset(powerspec_offset + aligned(powerspec_size * sizeof(double)))
+        , size(sum_offset + aligned(frame_size * sizeof(double)))
+    {
+    }
+};
+
+} // namespace
+
+std::size_t accumulate_frames_forked(const std::string& filename,
+    color_channel_t color_channel,
+    const Array2<double>& ref_frame,
+    std::size_t first_frame,
+    std::size_t count,
+    std::size_t nprocesses,
+    FrameAccumulator& accumulator)
+{
+    nprocesses = std::clamp<std::size_t>(nprocesses, 1, std::max<std::size_t>(count, 1));
+    const bool with_bispectrum { accumulator.with_bispectrum() };
+    const Bispectrum<bispec_complex_t>::extents bs_extents { accumulator.bispectrum().dimsizes() };
+    const std::size_t bs_size { with_bispectrum ? Bispectrum<bispec_complex_t>::base_size(bs_extents) : 0 };
+    const std::size_t xsize { ref_frame.ncols() };
+    const std::size_t ysize { ref_frame.nrows() };
+    // the power spectrum is stored as real half-plane of xsize/2+1 columns
+    const std::size_t ps_xsize { xsize / 2 + 1 };
+    const PartitionLayout layout(bs_size, ps_xsize * ysize, xsize * ysize);
+
+    // ftruncate zero-fills the segment, which is the initial state of all partitions
+    SharedSegment segment(layout.size * nprocesses);
+    auto partition = [&](std::size_t index) { return segment.data() + index * layout.size; };
+    auto bispectrum_view = [&](std::size_t index) {
+        return with_bispectrum
+            ? Bispectrum<bispec_complex_t>(bs_extents, view<bispec_complex_t>(partition(index) + layout.bispectrum_offset))
+            : Bispectrum<bispec_complex_t>();
+    };
+
+    log::info() << "accumulating " << count << " frames in " << nprocesses << " worker processes ("
+                << layout.size / (1024 * 1024) << " MiB shared memory per worker)";
+    std::vector<pid_t> pids(nprocesses, -1);
+    for (std::size_t i { 0 }; i < nprocesses; ++i) {
+        const std::size_t chunk_begin { first_frame + count * i / nprocesses };
+        const std::size_t chunk_end { first_frame + count * (i + 1) / nprocesses };
+        pids[i] = ::fork();
+        if (pids[i] < 0) {
+            log::warning() << "fork of worker " << i << " failed: " << std::strerror(errno)
+                           << ", accumulating its frames in the calling process";
+            continue;
+        }
+        if (pids[i] > 0) {
+            log::debug() << "started worker " << i << " (pid " << pids[i] << ") for frames "
+                         << chunk_begin << "-" << chunk_end - 1;
+            continue;
+        }
+        // child process: never return into the caller's stack, leave through _exit only
+        int exit_code { 1 };
+        try {
+            cv::setNumThreads(1);
+            // the fftw threads of the parent are gone, the worker plans its own single-threaded transforms
+            FftPlanRegistry::instance().set_max_threads(1);
+            auto* header { reinterpret_cast<PartitionHeader*>(partition(i)) };
+            FrameExtractor fe(filename);
+            if (fe.is_valid()) {
+                FrameAccumulator worker(ref_frame,
+                    bispectrum_view(i),
+                    Array2<double>(ps_xsize, ysize, view<double>(partition(i) + layout.powerspec_offset)),
+                    Array2<double>(xsize, ysize, view<double>(partition(i) + layout.sum_offset)));
+                worker.set_upsampling(accumulator.upsampling());
+                worker.set_pyramid_levels(accumulator.pyramid_levels());
+                worker.set_single_precision(accumulator.single_precision());
+                worker.set_batch_size(accumulator.batch_size());
+                worker.set_prefetch_depth(accumulator.prefetch_depth());
+                header->nframes = accumulate_frames(fe, color_channel, chunk_begin, chunk_end - chunk_begin, worker);
+                header->done = 1;
+                exit_code = 0;
+            }
+        } catch (...) {
+            exit_code = 2;
+        }
+        ::_exit(exit_code);
+    }
+
+    // the chunks of workers which could not be started are accumulated here, while the others are running
+    std::size_t merged { 0 };
+    for (std::size_t i { 0 }; i < nprocesses; ++i) {
+        if (pids[i] >= 0) {
+            continue;
+        }
+        const std::size_t chunk_begin { first_frame + count * i / nprocesses };
+        const std::size_t chunk_end { first_frame + count * (i + 1) / nprocesses };
+        FrameExtractor fe(filename);
+        if (!fe.is_valid()) {
+            throw std::runtime_error("accumulate_frames_forked: file open error: " + filename);
+        }
+        merged += accumulate_frames(fe, color_channel, chunk_begin, chunk_end - chunk_begin, accumulator);
+    }
+    for (std::size_t i { 0 }; i < nprocesses; ++i) {
+        if (pids[i] < 0) {
+            continue;
+        }
+        int status { 0 };
+        while (::waitpid(pids[i], &status, 0) < 0 && errno == EINTR) { }
+        const auto* header { reinterpret_cast<const PartitionHeader*>(partition(i)) };
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || header->done == 0) {
+            if (WIFSIGNALED(status)) {
+                log::error() << "worker " << i << " (pid " << pids[i] << ") terminated by signal "
+                             << WTERMSIG(status) << ", discarding its frames";
+            } else {
+                log::error() << "worker " << i << " (pid " << pids[i] << ") failed, discarding its frames";
+            }
+            continue;
+        }
+        log::info() << "merging " << header->nframes << " frames of worker " << i;
+        accumulator.merge(bispectrum_view(i),
+            Array2<double>(ps_xsize, ysize, view<double>(partition(i) + layout.powerspec_offset)),
+            Array2<double>(xsize, ysize, view<double>(partition(i) + layout.sum_offset)),
+            header->nframes);
+        merged += header->nframes;
+    }
+    return merged;
+}
+
+#endif
+
+} // namespace smip
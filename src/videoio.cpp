@@ -51,6 +51,38 @@ Mat& FrameExtractor::extract_next_frame()
     return m_frame;
 }
 
+bool FrameExtractor::extract_next_frame(Mat& frame)
+{
+    if (!m_cap.read(frame) || frame.empty()) {
+        return false;
+    }
+    m_frameindex++;
+    return true;
+}
+
+void FrameExtractor::seek(std::size_t frame)
+{
+    if (frame == m_frameindex) {
+        return;
+    }
+    if (m_cap.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(frame))
+        && static_cast<std::size_t>(m_cap.get(cv::CAP_PROP_POS_FRAMES)) == frame) {
+        m_frameindex = frame;
+        return;
+    }
+    // the backend does not support (exact) seeking: rewind if necessary and skip frames without decoding
+    if (frame < m_frameindex) {
+        m_cap.release();
+        if (!m_cap.open(m_filename)) {
+            CV_Error(Error::StsObjectNotFound, "Can not reopen Video file " + m_filename);
+        }
+        m_frameindex = 0;
+    }
+    while (m_frameindex < frame && m_cap.grab()) {
+        m_frameindex++;
+    }
+}
+
 void save_frame(const Mat& frame, const std::string& outfilename)
 {
     std::vector<int> compression_params;
@@ -0,0 +1,458 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include "log.h"
+#include "worker_protocol.h"
+
+#if !defined(_WIN32) && !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace smip::net {
+
+namespace {
+
+constexpr std::uint32_t c_magic { 0x534d4950 }; // "SMIP"
+// upper limit of the payload size, protects against allocating memory for a corrupted header
+constexpr std::uint64_t c_max_payload { 1ULL << 36 };
+
+struct MessageHeader {
+    std::uint32_t magic { c_magic };
+    std::uint32_t type { 0 };
+    std::uint64_t size { 0 };
+};
+
+/*! appends trivially copyable values in host byte order */
+class ByteWriter {
+public:
+    explicit ByteWriter(std::vector<std::byte>& buffer)
+        : m_buffer(buffer)
+    {
+    }
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    void put(const T& value) { put_bytes(&value, sizeof(T)); }
+    void put_bytes(const void* data, std::size_t size)
+    {
+        const auto* first { static_cast<const std::byte*>(data) };
+        m_buffer.insert(m_buffer.end(), first, first + size);
+    }
+    void put_string(const std::string& str)
+    {
+        put<std::uint64_t>(str.size());
+        put_bytes(str.data(), str.size());
+    }
+    template <typename T>
+    void put_array(const Array2<T>& arr)
+    {
+        put<std::uint64_t>(arr.xsize());
+        put<std::uint64_t>(arr.ysize());
+        put_bytes(arr.data().get(), arr.size() * sizeof(T));
+    }
+
+private:
+    std::vector<std::byte>& m_buffer;
+};
+
+class ByteReader {
+public:
+    explicit ByteReader(const std::vector<std::byte>& buffer)
+        : m_buffer(buffer)
+    {
+    }
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    T get()
+    {
+        T value {};
+        get_bytes(&value, sizeof(T));
+        return value;
+    }
+    void get_bytes(void* data, std::size_t size)
+    {
+        if (size > m_buffer.size() - m_pos) {
+            throw ConnectionError("protocol error: truncated message payload");
+        }
+        std::memcpy(data, m_buffer.data() + m_pos, size);
+        m_pos += size;
+    }
+    std::string get_string()
+    {
+        std::string str(get_size(1), '\0');
+        get_bytes(str.data(), str.size());
+        return str;
+    }
+    template <typename T>
+    Array2<T> get_array()
+    {
+        const auto xsize { get<std::uint64_t>() };
+        const auto ysize { get<std::uint64_t>() };
+        if (xsize != 0 && ysize > (m_buffer.size() - m_pos) / sizeof(T) / xsize) {
+            throw ConnectionError("protocol error: truncated message payload");
+        }
+        Array2<T> arr(xsize, ysize);
+        get_bytes(arr.data().get(), arr.size() * sizeof(T));
+        return arr;
+    }
+    /*! read an element count and check it against the remaining payload */
+    std::size_t get_size(std::size_t element_size)
+    {
+        const auto n { get<std::uint64_t>() };
+        if (n > (m_buffer.size() - m_pos) / element_size) {
+            throw ConnectionError("protocol error: truncated message payload");
+        }
+        return n;
+    }
+
+private:
+    const std::vector<std::byte>& m_buffer;
+    std::size_t m_pos { 0 };
+};
+
+} // namespace
+
+std::vector<std::byte> serialize(const AccumulationJob& job)
+{
+    std::vector<std::byte> buffer {};
+    ByteWriter writer(buffer);
+    writer.put(job.id);
+    writer.put_string(job.filename);
+    writer.put(static_cast<std::uint8_t>(job.color_channel));
+    writer.put(job.first_frame);
+    writer.put(job.count);
+    writer.put(job.bispectrum_depth);
+    writer.put(static_cast<std::uint8_t>(job.with_bispectrum));
+    writer.put_array(job.ref_frame);
+    writer.put(job.upsampling);
+    writer.put(job.pyramid_levels);
+    writer.put(static_cast<std::uint8_t>(job.single_precision));
+    return buffer;
+}
+
+std::vector<std::byte> serialize(const AccumulationResult& result)
+{
+    std::vector<std::byte> buffer {};
+    ByteWriter writer(buffer);
+    writer.put(result.job_id);
+    writer.put(result.nframes);
+    const auto dims { result.bispectrum.dimsizes() };
+    for (std::size_t i { 0 }; i < 4; ++i) {
+        writer.put<std::uint64_t>(dims[i]);
+    }
+    writer.put<std::uint64_t>(result.bispectrum.size());
+    writer.put_bytes(result.bispectrum.data().get(), result.bispectrum.size() * sizeof(bispec_complex_t));
+    writer.put_array(result.powerspec);
+    writer.put_array(result.sum);
+    return buffer;
+}
+
+AccumulationJob deserialize_job(const std::vector<std::byte>& payload)
+{
+    ByteReader reader(payload);
+    AccumulationJob job {};
+    job.id = reader.get<std::uint64_t>();
+    job.filename = reader.get_string();
+    job.color_channel = static_cast<color_channel_t>(reader.get<std::uint8_t>());
+    job.first_frame = reader.get<std::uint64_t>();
+    job.count = reader.get<std::uint64_t>();
+    job.bispectrum_depth = reader.get<std::uint64_t>();
+    job.with_bispectrum = reader.get<std::uint8_t>() != 0;
+    job.ref_frame = reader.get_array<double>();
+    job.upsampling = reader.get<std::uint64_t>();
+    job.pyramid_levels = reader.get<std::uint64_t>();
+    job.single_precision = reader.get<std::uint8_t>() != 0;
+    return job;
+}
+
+AccumulationResult deserialize_result(const std::vector<std::byte>& payload)
+{
+    ByteReader reader(payload);
+    AccumulationResult result {};
+    result.job_id = reader.get<std::uint64_t>();
+    result.nframes = reader.get<std::uint64_t>();
+    Bispectrum<bispec_complex_t>::extents dims {};
+    for (std::size_t i { 0 }; i < 4; ++i) {
+        dims[i] = reader.get<std::uint64_t>();
+    }
+    const std::size_t bs_size { reader.get_size(sizeof(bispec_complex_t)) };
+    if (bs_size > 0) {
+        result.bispectrum = Bispectrum<bispec_complex_t>(dims);
+        if (result.bispectrum.size() != bs_size) {
+            throw ConnectionError("protocol error: bispectrum size does not match its dimensions");
+        }
+        reader.get_bytes(result.bispectrum.data().get(), bs_size * sizeof(bispec_complex_t));
+    }
+    result.powerspec = reader.get_array<double>();
+    result.sum = reader.get_array<double>();
+    return result;
+}
+
+#ifdef _WIN32
+
+TcpSocket::TcpSocket(int fd)
+    : m_fd(fd)
+{
+}
+
+TcpSocket::TcpSocket(TcpSocket&& other) noexcept
+    : m_fd(std::exchange(other.m_fd, -1))
+{
+}
+
+TcpSocket& TcpSocket::operator=(TcpSocket&& other) noexcept
+{
+    m_fd = std::exchange(other.m_fd, -1);
+    return *this;
+}
+
+TcpSocket::~TcpSocket() = default;
+
+TcpSocket TcpSocket::connect(const std::string& /*host*/, std::uint16_t /*port*/)
+{
+    throw ConnectionError("TCP workers are not supported on this platform");
+}
+
+void TcpSocket::send_message(MessageType /*type*/, const std::vector<std::byte>& /*payload*/)
+{
+    throw ConnectionError("TCP workers are not supported on this platform");
+}
+
+std::optional<Message> TcpSocket::receive_message()
+{
+    throw ConnectionError("TCP workers are not supported on this platform");
+}
+
+void TcpSocket::close()
+{
+    m_fd = -1;
+}
+
+TcpListener::TcpListener(std::uint16_t /*port*/)
+{
+    throw ConnectionError("TCP workers are not supported on this platform");
+}
+
+TcpListener::~TcpListener() = default;
+
+TcpSocket TcpListener::accept()
+{
+    throw ConnectionError("TCP workers are not supported on this platform");
+}
+
+#else
+
+namespace {
+
+void send_all(int fd, const void* data, std::size_t size)
+{
+    const auto* ptr { static_cast<const char*>(data) };
+    while (size > 0) {
+        const ssize_t n { ::send(fd, ptr, size, MSG_NOSIGNAL) };
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw ConnectionError("send failed: " + std::string(std::strerror(errno)));
+        }
+        ptr += n;
+        size -= static_cast<std::size_t>(n);
+    }
+}
+
+/*! receive exactly \e size bytes, returns false if the peer closed the connection before the first byte */
+bool receive_all(int fd, void* data, std::size_t size)
+{
+    auto* ptr { static_cast<char*>(data) };
+    const std::size_t total { size };
+    while (size > 0) {
+        const ssize_t n { ::recv(fd, ptr, size, 0) };
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw ConnectionError("recv failed: " + std::string(std::strerror(errno)));
+        }
+        if (n == 0) {
+            if (size == total) {
+                return false;
+            }
+            throw ConnectionError("connection closed by peer within a message");
+        }
+        ptr += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+TcpSocket::TcpSocket(int fd)
+    : m_fd(fd)
+{
+}
+
+TcpSocket::TcpSocket(TcpSocket&& other) noexcept
+    : m_fd(std::exchange(other.m_fd, -1))
+{
+}
+
+TcpSocket& TcpSocket::operator=(TcpSocket&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        m_fd = std::exchange(other.m_fd, -1);
+    }
+    return *this;
+}
+
+TcpSocket::~TcpSocket()
+{
+    close();
+}
+
+TcpSocket TcpSocket::connect(const std::string& host, std::uint16_t port)
+{
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses { nullptr };
+    const int err { ::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) };
+    if (err != 0) {
+        throw ConnectionError("can not resolve " + host + ": " + ::gai_strerror(err));
+    }
+    int fd { -1 };
+    for (addrinfo* addr { addresses }; addr != nullptr; addr = addr->ai_next) {
+        fd = ::socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (::connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) {
+            break;
+        }
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(addresses);
+    if (fd < 0) {
+        throw ConnectionError("can not connect to " + host + ":" + std::to_string(port));
+    }
+    return TcpSocket(fd);
+}
+
+void TcpSocket::send_message(MessageType type, const std::vector<std::byte>& payload)
+{
+    if (!is_open()) {
+        throw ConnectionError("send on closed socket");
+    }
+    const MessageHeader header { c_magic, static_cast<std::uint32_t>(type), payload.size() };
+    send_all(m_fd, &header, sizeof(header));
+    send_all(m_fd, payload.data(), payload.size());
+}
+
+std::optional<Message> TcpSocket::receive_message()
+{
+    if (!is_open()) {
+        throw ConnectionError("receive on closed socket");
+    }
+    MessageHeader header {};
+    if (!receive_all(m_fd, &header, sizeof(header))) {
+        return std::nullopt;
+    }
+    if (header.magic != c_magic) {
+        throw ConnectionError("protocol error: invalid message header");
+    }
+    if (header.size > c_max_payload) {
+        throw ConnectionError("protocol error: message payload too large");
+    }
+    Message msg { static_cast<MessageType>(header.type), std::vector<std::byte>(header.size) };
+    if (header.size > 0 && !receive_all(m_fd, msg.payload.data(), msg.payload.size())) {
+        throw ConnectionError("connection closed by peer within a message");
+    }
+    return msg;
+}
+
+void TcpSocket::close()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+TcpListener::TcpListener(std::uint16_t port)
+{
+    m_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (m_fd < 0) {
+        throw ConnectionError("socket failed: " + std::string(std::strerror(errno)));
+    }
+    const int reuse { 1 };
+    ::setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (::bind(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(m_fd, 4) != 0) {
+        const int err { errno };
+        ::close(m_fd);
+        throw ConnectionError("can not listen on port " + std::to_string(port) + ": " + std::strerror(err));
+    }
+    socklen_t len { sizeof(addr) };
+    ::getsockname(m_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    m_port = ntohs(addr.sin_port);
+}
+
+TcpListener::~TcpListener()
+{
+    ::close(m_fd);
+}
+
+TcpSocket TcpListener::accept()
+{
+    int fd { -1 };
+    while ((fd = ::accept(m_fd, nullptr, nullptr)) < 0) {
+        if (errno != EINTR) {
+            throw ConnectionError("accept failed: " + std::string(std::strerror(errno)));
+        }
+    }
+    return TcpSocket(fd);
+}
+
+#endif
+
+void serve_worker_session(TcpSocket& connection, const job_handler_t& handler)
+{
+    while (auto msg = connection.receive_message()) {
+        if (msg->type != MessageType::Job) {
+            throw ConnectionError("protocol error: unexpected message type");
+        }
+        const AccumulationJob job { deserialize_job(msg->payload) };
+        log::info() << "job " << job.id << ": frames " << job.first_frame << "-" << job.first_frame + job.count - 1
+                    << " of " << job.filename;
+        std::vector<std::byte> reply {};
+        MessageType reply_type { MessageType::Result };
+        try {
+            reply = serialize(handler(job));
+        } catch (const std::exception& e) {
+            log::error() << "job " << job.id << " failed: " << e.what();
+            reply_type = MessageType::Error;
+            const std::string what { e.what() };
+            reply.resize(what.size());
+            std::memcpy(reply.data(), what.data(), what.size());
+        }
+        connection.send_message(reply_type, reply);
+    }
+}
+
+} // namespace smip::net
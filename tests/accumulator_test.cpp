@@ -0,0 +1,192 @@
+#include "array2.h"
+#include "bispectrum.h"
+#include "frame_accumulator.h"
+#include "log.h"
+#include "test_fixtures.h"
+#include "test_macros.h"
+#include "types.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+using namespace smip;
+
+namespace {
+constexpr std::size_t c_size { 16 };
+constexpr std::size_t c_depth { 4 };
+
+/*! gaussian spot of width 2 centered at (\e cx, \e cy) */
+Array2<double> gaussian_frame(double cx, double cy)
+{
+    return test::gaussian_frame(c_size * 2, c_size * 2, cx, cy, 2., 255.);
+}
+} // namespace
+
+TEST(FrameAccumulatorTest, ExternalStorage)
+{
+    TEST_CASE("FrameAccumulator with External Storage");
+    const auto frames { test::random_frames(6, c_size, c_size, 4711) };
+    const Bispectrum<bispec_complex_t>::extents dims { c_size, c_size, c_depth, c_depth };
+    FrameAccumulator reference(frames[0], c_depth);
+
+    std::vector<bispec_complex_t> bs_storage(Bispectrum<bispec_complex_t>::base_size(dims));
+    std::vector<double> ps_storage((c_size / 2 + 1) * c_size);
+    std::vector<double> sum_storage(c_size * c_size);
+    auto no_delete = [](auto*) {};
+    FrameAccumulator external(frames[0],
+        Bispectrum<bispec_complex_t>(dims, std::shared_ptr<bispec_complex_t[]>(bs_storage.data(), no_delete)),
+        Array2<double>(c_size / 2 + 1, c_size, std::shared_ptr<double[]>(ps_storage.data(), no_delete)),
+        Array2<double>(c_size, c_size, std::shared_ptr<double[]>(sum_storage.data(), no_delete)));
+    for (const auto& frame : frames) {
+        reference.add_frame(frame);
+        external.add_frame(frame);
+    }
+    TEST_EQUAL(external.nframes(), frames.size());
+    TEST_EQUAL(external.with_bispectrum(), true);
+    // the accumulated sums must have been written to the external storage
+    TEST_EQUAL(external.bispectrum().data().get(), bs_storage.data());
+    TEST_NEAR(test::max_difference(external.bispectrum(), reference.bispectrum()), 0., 1e-12);
+    TEST_NEAR(test::max_difference(external.powerspectrum(), reference.powerspectrum()), 0., 1e-12);
+    TEST_NEAR(test::max_difference(external.sum_image(), reference.sum_image()), 0., 1e-12);
+}
+
+TEST(FrameAccumulatorTest, MergePartitions)
+{
+    TEST_CASE("FrameAccumulator Merge of Partitions");
+    const auto frames { test::random_frames(9, c_size, c_size, 4711) };
+    FrameAccumulator total(frames[0], c_depth);
+    FrameAccumulator first(frames[0], c_depth);
+    FrameAccumulator second(frames[0], c_depth);
+    for (std::size_t i { 0 }; i < frames.size(); ++i) {
+        total.add_frame(frames[i]);
+        if (i < frames.size() / 2) {
+            first.add_frame(frames[i]);
+        } else {
+            second.add_frame(frames[i]);
+        }
+    }
+    first.merge(second.bispectrum(), second.powerspectrum(), second.sum_image(), second.nframes());
+    TEST_EQUAL(first.nframes(), total.nframes());
+    const double bs_scale { static_cast<double>(std::abs(*std::max_element(total.bispectrum().begin(), total.bispectrum().end(),
+        [](const bispec_complex_t& a, const bispec_complex_t& b) { return std::abs(a) < std::abs(b); }))) };
+    TEST_NEAR(test::max_difference(first.bispectrum(), total.bispectrum()) / bs_scale, 0., 1e-6);
+    TEST_NEAR(test::max_difference(first.powerspectrum(), total.powerspectrum()) / std::abs(total.powerspectrum()[0][0]), 0., 1e-12);
+    TEST_NEAR(test::max_difference(first.sum_image(), total.sum_image()), 0., 1e-9);
+}
+
+TEST(FrameAccumulatorTest, BatchedFrames)
+{
+    TEST_CASE("FrameAccumulator with Batched Frames");
+    const auto frames { test::random_frames(7, c_size, c_size, 4711) };
+    FrameAccumulator single(frames[0], c_depth);
+    FrameAccumulator batched(frames[0], c_depth);
+    batched.set_batch_size(3);
+    TEST_EQUAL(batched.batch_size(), 3u);
+    FrameStack stack(c_size, c_size, batched.batch_size());
+    for (const auto& frame : frames) {
+        single.add_frame(frame);
+        stack.push_back(frame);
+        if (stack.full()) {
+            batched.add_frames(stack);
+            stack.clear();
+        }
+    }
+    // the remaining frame is transformed by the single frame plan
+    batched.add_frames(stack);
+    TEST_EQUAL(batched.nframes(), single.nframes());
+    const double bs_scale { static_cast<double>(std::abs(*std::max_element(single.bispectrum().begin(), single.bispectrum().end(),
+        [](const bispec_complex_t& a, const bispec_complex_t& b) { return std::abs(a) < std::abs(b); }))) };
+    TEST_NEAR(test::max_difference(batched.bispectrum(), single.bispectrum()) / bs_scale, 0., 1e-6);
+    TEST_NEAR(test::max_difference(batched.powerspectrum(), single.powerspectrum()) / std::abs(single.powerspectrum()[0][0]), 0., 1e-12);
+    TEST_NEAR(test::max_difference(batched.sum_image(), single.sum_image()), 0., 1e-9);
+    FrameStack mismatch(c_size / 2, c_size, 2);
+    TEST_THROW(batched.add_frames(mismatch), std::invalid_argument);
+}
+
+TEST(FrameAccumulatorTest, SinglePrecision)
+{
+    TEST_CASE("FrameAccumulator in Single Precision");
+    const auto frames { test::random_frames(5, c_size, c_size, 4711) };
+    FrameAccumulator full(frames[0], c_depth);
+    FrameAccumulator single(frames[0], c_depth);
+    single.set_single_precision(true);
+    TEST_EQUAL(single.single_precision(), true);
+    for (const auto& frame : frames) {
+        full.add_frame(frame);
+        single.add_frame(frame);
+    }
+    const double bs_scale { static_cast<double>(std::abs(*std::max_element(full.bispectrum().begin(), full.bispectrum().end(),
+        [](const bispec_complex_t& a, const bispec_complex_t& b) { return std::abs(a) < std::abs(b); }))) };
+    TEST_NEAR(test::max_difference(single.bispectrum(), full.bispectrum()) / bs_scale, 0., 1e-5);
+    TEST_NEAR(test::max_difference(single.powerspectrum(), full.powerspectrum()) / std::abs(full.powerspectrum()[0][0]), 0., 1e-6);
+    // the frames are registered alike, the sum image is accumulated from the original frames
+    TEST_EQUAL(test::max_difference(single.sum_image(), full.sum_image()), 0.);
+    single.set_single_precision(false);
+    TEST_EQUAL(single.single_precision(), false);
+}
+
+TEST(FrameAccumulatorTest, SubpixelRegistration)
+{
+    TEST_CASE("FrameAccumulator with Subpixel Registration");
+    const auto ref { gaussian_frame(c_size, c_size) };
+    // integer shifts are reproduced by the phase ramp, the spot is far from the (cyclic) borders
+    FrameAccumulator integer(ref, c_depth);
+    FrameAccumulator subpixel(ref, c_depth);
+    subpixel.set_upsampling(10);
+    TEST_EQUAL(subpixel.upsampling(), 10u);
+    for (const auto& [dx, dy] : { std::pair { 3, -2 }, std::pair { -1, 4 } }) {
+        integer.add_frame(gaussian_frame(c_size + dx, c_size + dy));
+        subpixel.add_frame(gaussian_frame(c_size + dx, c_size + dy));
+    }
+    TEST_NEAR(test::max_difference(subpixel.sum_image(), integer.sum_image()), 0., 1e-6);
+    TEST_NEAR(test::max_difference(subpixel.powerspectrum(), integer.powerspectrum()), 0., 1e-6);
+
+    // subpixel shifts are compensated in the sum image
+    FrameAccumulator integer_sum(ref, c_depth);
+    FrameAccumulator subpixel_sum(ref, c_depth);
+    subpixel_sum.set_upsampling(10);
+    for (const auto& [dx, dy] : { std::pair { 2.4, -1.5 }, std::pair { -0.6, 3.3 } }) {
+        integer_sum.add_frame(gaussian_frame(c_size + dx, c_size + dy));
+        subpixel_sum.add_frame(gaussian_frame(c_size + dx, c_size + dy));
+    }
+    Array2<double> expected { ref };
+    expected *= 2.;
+    TEST_NEAR(test::max_difference(subpixel_sum.sum_image(), expected), 0., 10.);
+    TEST_EQUAL(test::max_difference(subpixel_sum.sum_image(), expected) < test::max_difference(integer_sum.sum_image(), expected) / 4., true);
+}
+
+TEST(FrameAccumulatorTest, PyramidRegistration)
+{
+    TEST_CASE("FrameAccumulator with Coarse-to-fine Registration");
+    const auto ref { gaussian_frame(c_size, c_size) };
+    FrameAccumulator full(ref, c_depth);
+    FrameAccumulator pyramid(ref, c_depth);
+    pyramid.set_pyramid_levels(2);
+    TEST_EQUAL(pyramid.pyramid_levels(), 2u);
+    for (const auto& [dx, dy] : { std::pair { 3, -2 }, std::pair { -5, 4 }, std::pair { 0, 1 } }) {
+        full.add_frame(gaussian_frame(c_size + dx, c_size + dy));
+        pyramid.add_frame(gaussian_frame(c_size + dx, c_size + dy));
+    }
+    TEST_EQUAL(test::max_difference(pyramid.sum_image(), full.sum_image()), 0.);
+    TEST_EQUAL(test::max_difference(pyramid.powerspectrum(), full.powerspectrum()), 0.);
+    TEST_THROW(pyramid.set_pyramid_levels(4), std::invalid_argument);
+}
+
+int accumulator_test(int /*argc*/, char* /*argv*/[])
+{
+    log::system::setup(log::Level::Warning, [](int) {}, std::cerr);
+    RUN_TEST(FrameAccumulatorTest, ExternalStorage);
+    RUN_TEST(FrameAccumulatorTest, MergePartitions);
+    RUN_TEST(FrameAccumulatorTest, BatchedFrames);
+    RUN_TEST(FrameAccumulatorTest, SinglePrecision);
+    RUN_TEST(FrameAccumulatorTest, SubpixelRegistration);
+    RUN_TEST(FrameAccumulatorTest, PyramidRegistration);
+
+    Test::summary();
+    return 0;
+}
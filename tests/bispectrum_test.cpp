@@ -1,11 +1,14 @@
+#include "array2.h"
 #include "bispectrum.h"
 #include "test_macros.h"
 #include "types.h"
 #include <algorithm>
 #include <complex>
 #include <cstdio>
+#include <random>
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
 using namespace smip;
 
@@ -76,6 +79,7 @@ TEST(BispectrumTest, ZeroSize)
     Bispectrum<std::complex<double>> arr;
     TEST_EQUAL(arr.size(), 0);
     TEST_THROW([[maybe_unused]] auto unused = arr.get_element({ 0, 0, 0, 0 }), std::out_of_range);
+    TEST_EQUAL(arr.find_element({ 0, 0, 0, 0 }).has_value(), false);
 }
 
 TEST(BispectrumTest, ArithmeticOperators)
@@ -118,6 +122,97 @@ TYPED_TEST(BispectrumTest, Element_Multiple_Get)
     TEST_EQUAL_OR_NEAR(result[1], TypeParam(2.5, -1.0));
 }
 
+TYPED_TEST(BispectrumTest, Gather)
+{
+    TEST_CASE("Bispectrum Gather from Precomputed Locations");
+    Bispectrum<TypeParam> b({ 6, 5, 3, 3 });
+    std::size_t n { 0 };
+    for (auto& val : b) {
+        val = TypeParam(0.5 * n, 1.0 + n);
+        ++n;
+    }
+    std::vector<typename Bispectrum<TypeParam>::ElementLocation> locations {};
+    std::vector<TypeParam> expected {};
+    for (int u1 { -2 }; u1 <= 2; ++u1) {
+        for (int u0 { -3 }; u0 <= 2; ++u0) {
+            for (int v1 { -1 }; v1 <= 1; ++v1) {
+                for (int v0 { -1 }; v0 <= 1; ++v0) {
+                    const typename Bispectrum<TypeParam>::s_indices indices { u0, u1, v0, v1 };
+                    const auto location { b.find_element(indices) };
+                    bool thrown { false };
+                    try {
+                        static_cast<void>(b.locate_element(indices));
+                    } catch (const std::out_of_range&) {
+                        thrown = true;
+                    }
+                    TEST_EQUAL(thrown, !location.has_value());
+                    if (!location) {
+                        continue;
+                    }
+                    locations.push_back(*location);
+                    expected.push_back(b.get_element(indices));
+                }
+            }
+        }
+    }
+    TEST_EQUAL(std::any_of(locations.begin(), locations.end(), [](const auto& location) { return location.conjugate != 0; }), true);
+    std::vector<TypeParam> result(locations.size());
+    b.gather(locations.data(), locations.size(), result.data());
+    TEST_EQUAL(std::equal(result.begin(), result.end(), expected.begin()), true);
+}
+
+TEST(BispectrumTest, SymmetricEquivalents)
+{
+    TEST_CASE("Bispectrum Access through Symmetric Equivalents");
+    // random hermitian spectrum F(-x) = conj(F(x))
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<double> distrib(-1., 1.);
+    Array2<complex<double>> spectrum(12, 10, complex<double> {});
+    for (int y { spectrum.min_sindices()[1] }; y <= spectrum.max_sindices()[1]; ++y) {
+        for (int x { spectrum.min_sindices()[0] }; x <= spectrum.max_sindices()[0]; ++x) {
+            if (spectrum.at({ x, y }) == complex<double> {}) {
+                spectrum.at({ x, y }) = complex<double>(distrib(gen), distrib(gen));
+                spectrum.at({ -x, -y }) = std::conj(spectrum.at({ x, y }));
+            }
+        }
+    }
+    Bispectrum<complex<double>> b({ 12, 10, 6, 5 });
+    b.accumulate_from_fft(spectrum);
+    const auto low { b.min_indices() };
+    const auto high { b.max_indices() };
+    std::size_t nlocated { 0 };
+    double max_error { 0. };
+    Bispectrum<complex<double>>::s_indices uv {};
+    for (uv[3] = low[3]; uv[3] <= high[3]; ++uv[3]) {
+        for (uv[2] = low[2]; uv[2] <= high[2]; ++uv[2]) {
+            for (uv[1] = low[1]; uv[1] <= high[1]; ++uv[1]) {
+                for (uv[0] = low[0]; uv[0] <= high[0]; ++uv[0]) {
+                    const DimVector<int, 2> u { uv[0], uv[1] };
+                    const DimVector<int, 2> v { uv[2], uv[3] };
+                    if (!spectrum.range().contains(u) || !spectrum.range().contains(v) || !spectrum.range().contains(u + v)) {
+                        continue;
+                    }
+                    complex<double> element {};
+                    try {
+                        element = b.get_element(uv);
+                    } catch (const std::out_of_range&) {
+                        continue;
+                    }
+                    // elements only reachable through the positive nyquist frequency are not accumulated
+                    if (element == complex<double> {}) {
+                        continue;
+                    }
+                    nlocated++;
+                    const complex<double> expected { spectrum.at(u) * spectrum.at(v) * std::conj(spectrum.at(u + v)) };
+                    max_error = std::max(max_error, std::abs(element - expected));
+                }
+            }
+        }
+    }
+    TEST_EQUAL(nlocated > 0, true);
+    TEST_NEAR(max_error, 0., 1e-12);
+}
+
 TYPED_TEST(BispectrumTest, FillTest)
 {
     TEST_CASE("Bispectrum Fill");
@@ -181,6 +276,8 @@ int bispectrum_test(int /*argc*/, char* /*argv*/[])
     RUN_TYPED_TEST(BispectrumTest, ComplexConjugation);
     RUN_TEST(BispectrumTest, ArithmeticOperators);
     RUN_TYPED_TEST(BispectrumTest, Element_Multiple_Get);
+    RUN_TYPED_TEST(BispectrumTest, Gather);
+    RUN_TEST(BispectrumTest, SymmetricEquivalents);
     RUN_TYPED_TEST(BispectrumTest, FillTest);
     RUN_TYPED_TEST(BispectrumTest, IO_Write_And_Read);
 
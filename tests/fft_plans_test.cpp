@@ -0,0 +1,201 @@
+#include "array2.h"
+#include "fft_plans.h"
+#include "test_macros.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace smip;
+
+namespace {
+template <typename R>
+std::shared_ptr<R[]> random_buffer(std::size_t count, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<R> distrib(-1., 1.);
+    auto buffer { fft_buffer<R, R>(count) };
+    std::generate(buffer.get(), buffer.get() + count, [&] { return distrib(gen); });
+    return buffer;
+}
+
+/*! maximum deviation of the r2c and c2r round trip of a random frame from the (rescaled) frame */
+template <typename R>
+double roundtrip_error(std::size_t xsize, std::size_t ysize)
+{
+    FftPlanRegistry& registry { FftPlanRegistry::instance() };
+    const auto forward { registry.executor<R>({ xsize, ysize, FftKind::r2c }) };
+    const auto backward { registry.executor<R>({ xsize, ysize, FftKind::c2r }) };
+    const std::size_t size { xsize * ysize };
+    const auto frame { random_buffer<R>(size, 1) };
+    auto input { fft_buffer<R, R>(size) };
+    std::copy(frame.get(), frame.get() + size, input.get());
+    auto spectrum { fft_buffer<std::complex<R>, R>((xsize / 2 + 1) * ysize) };
+    auto output { fft_buffer<R, R>(size) };
+    forward.execute(input.get(), spectrum.get());
+    backward.execute(spectrum.get(), output.get());
+    double max_diff { 0. };
+    for (std::size_t i { 0 }; i < size; ++i) {
+        max_diff = std::max(max_diff, std::abs(static_cast<double>(output[i]) / size - frame[i]));
+    }
+    return max_diff;
+}
+} // namespace
+
+TEST(FftPlansTest, Registry)
+{
+    TEST_CASE("FftPlanRegistry Plan Reuse");
+    FftPlanRegistry& registry { FftPlanRegistry::instance() };
+    const std::size_t nplans { registry.size() };
+    const auto first { registry.executor<double>({ 12, 10, FftKind::r2c }) };
+    const auto second { registry.executor<double>({ 12, 10, FftKind::r2c }) };
+    TEST_EQUAL(first.valid(), true);
+    TEST_EQUAL(registry.size(), nplans + 1);
+    TEST_EQUAL(second.key() == first.key(), true);
+    const auto single { registry.executor<float>({ 12, 10, FftKind::r2c }) };
+    TEST_EQUAL(single.key().precision == FftPrecision::single_precision, true);
+    TEST_EQUAL(registry.size(), nplans + 2);
+    TEST_EQUAL(FftExecutor<double> {}.valid(), false);
+}
+
+TEST(FftPlansTest, RealRoundtrip)
+{
+    TEST_CASE("FftExecutor Real Roundtrip");
+    TEST_NEAR(roundtrip_error<double>(16, 9), 0., 1e-12);
+    TEST_NEAR(roundtrip_error<float>(16, 9), 0., 1e-5);
+}
+
+TEST(FftPlansTest, ComplexRoundtrip)
+{
+    TEST_CASE("FftExecutor Complex Roundtrip");
+    FftPlanRegistry& registry { FftPlanRegistry::instance() };
+    const auto forward { registry.executor<double>({ 8, 6, FftKind::forward, FftPrecision::double_precision, true, true }) };
+    const auto backward { registry.executor<double>({ 8, 6, FftKind::backward, FftPrecision::double_precision, true, true }) };
+    auto data { fft_buffer<std::complex<double>>(48) };
+    std::fill(data.get(), data.get() + 48, std::complex<double> {});
+    data[0] = { 1., 0. };
+    forward.execute(data.get(), data.get());
+    // the transform of a delta is constant
+    TEST_NEAR(std::abs(data[47] - std::complex<double> { 1., 0. }), 0., 1e-12);
+    backward.execute(data.get(), data.get());
+    TEST_NEAR(std::abs(data[0] - std::complex<double> { 48., 0. }), 0., 1e-12);
+    TEST_NEAR(std::abs(data[1]), 0., 1e-12);
+}
+
+TEST(FftPlansTest, Arguments)
+{
+    TEST_CASE("FftExecutor Buffer Checks");
+    FftPlanRegistry& registry { FftPlanRegistry::instance() };
+    const auto forward { registry.executor<double>({ 12, 10, FftKind::r2c }) };
+    auto input { fft_buffer<double>(121) };
+    auto spectrum { fft_buffer<std::complex<double>>(70) };
+    TEST_THROW(forward.execute(input.get() + 1, spectrum.get()), std::invalid_argument);
+    TEST_THROW(forward.execute(spectrum.get(), input.get()), std::invalid_argument);
+    TEST_THROW(forward.execute(reinterpret_cast<std::complex<double>*>(input.get()), spectrum.get()), std::invalid_argument);
+    const auto unaligned { registry.executor<double>({ 12, 10, FftKind::r2c, FftPrecision::double_precision, false }) };
+    unaligned.execute(input.get() + 1, spectrum.get());
+    TEST_THROW(static_cast<void>(registry.executor<double>({ 0, 10, FftKind::r2c })), std::runtime_error);
+}
+
+TEST(FftPlansTest, Wisdom)
+{
+    TEST_CASE("FftPlanRegistry Wisdom Import and Export");
+    FftPlanRegistry& registry { FftPlanRegistry::instance() };
+    static_cast<void>(registry.executor<float>({ 20, 14, FftKind::c2r }));
+    const std::string filename { (std::filesystem::temp_directory_path() / "smip_fft_plans_test.wisdom").string() };
+    TEST_EQUAL(registry.export_wisdom(filename), true);
+    TEST_EQUAL(std::filesystem::file_size(filename) > 0, true);
+    TEST_EQUAL(registry.import_wisdom(filename), true);
+    std::filesystem::remove(filename);
+    TEST_EQUAL(registry.import_wisdom(filename), false);
+}
+
+TEST(FftPlansTest, ThreadExecutors)
+{
+    TEST_CASE("Concurrent Execution of Thread-local Executors");
+    constexpr std::size_t c_xsize { 32 };
+    constexpr std::size_t c_ysize { 24 };
+    constexpr std::size_t c_nspectrum { (c_xsize / 2 + 1) * c_ysize };
+    const Array2<double> frame(c_xsize, c_ysize, random_buffer<double>(c_xsize * c_ysize, 7));
+    Array2<double> input { frame };
+    Array2<complex_t> reference(c_xsize / 2 + 1, c_ysize);
+    const auto unaligned { FftPlanRegistry::instance().executor<double>({ c_xsize, c_ysize, FftKind::r2c, FftPrecision::double_precision, false }) };
+    unaligned.execute(input.data().get(), reference.data().get());
+
+    constexpr std::size_t c_nthreads { 4 };
+    std::vector<double> max_diff(c_nthreads, 0.);
+    std::vector<std::thread> threads {};
+    for (std::size_t t { 0 }; t < c_nthreads; ++t) {
+        threads.emplace_back([&, t] {
+            auto in { fft_buffer<double>(c_xsize * c_ysize) };
+            auto out { fft_buffer<std::complex<double>>(c_nspectrum) };
+            for (int i { 0 }; i < 50; ++i) {
+                std::copy(frame.begin(), frame.end(), in.get());
+                FftPlanRegistry::instance().thread_executor<double>({ c_xsize, c_ysize, FftKind::r2c }).execute(in.get(), out.get());
+                for (std::size_t k { 0 }; k < c_nspectrum; ++k) {
+                    max_diff[t] = std::max(max_diff[t], std::abs(out[k] - reference.data()[k]));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // the unaligned plan of the reference may use other codelets
+    TEST_NEAR(*std::max_element(max_diff.begin(), max_diff.end()), 0., 1e-12);
+}
+
+TEST(FftPlansTest, ThreadCrossovers)
+{
+    TEST_CASE("FftPlanRegistry Threads per Transform Size");
+    FftPlanRegistry& registry { FftPlanRegistry::instance() };
+    const auto defaults { registry.thread_crossovers() };
+    TEST_EQUAL(registry.max_threads(), 1u);
+    TEST_EQUAL(registry.threads_for({ 1024, 1024, FftKind::r2c }), 1u);
+
+    registry.set_max_threads(4);
+    registry.set_thread_crossovers({ { 256 * 256, 0 }, { 0, 1 }, { 64 * 64, 2 } });
+    TEST_EQUAL(registry.thread_crossovers().front().min_elements, 0u);
+    const std::size_t max_threads { FftPlanRegistry::threads_supported() ? 4u : 1u };
+    TEST_EQUAL(registry.threads_for({ 32, 32, FftKind::r2c }), 1u);
+    TEST_EQUAL(registry.threads_for({ 64, 64, FftKind::c2r }), std::min<std::size_t>(2, max_threads));
+    TEST_EQUAL(registry.threads_for({ 512, 512, FftKind::r2c }), max_threads);
+    // the transforms of a batch count together
+    TEST_EQUAL(registry.threads_for({ 64, 64, FftKind::r2c, FftPrecision::double_precision, true, false, 16 }), max_threads);
+    TEST_EQUAL(registry.executor<double>({ 72, 64, FftKind::r2c }).key().threads, std::min<std::size_t>(2, max_threads));
+    TEST_NEAR(roundtrip_error<double>(72, 64), 0., 1e-12);
+    TEST_NEAR(roundtrip_error<float>(72, 64), 0., 1e-5);
+    // a change of the thread settings is seen by the cached executors of a thread as well
+    TEST_EQUAL(registry.thread_executor<double>({ 72, 64, FftKind::r2c }).key().threads, std::min<std::size_t>(2, max_threads));
+    registry.set_max_threads(1);
+    TEST_EQUAL(registry.thread_executor<double>({ 72, 64, FftKind::r2c }).key().threads, 1u);
+
+    registry.set_max_threads(2);
+    registry.calibrate_threads();
+    const auto calibrated { registry.thread_crossovers() };
+    TEST_EQUAL(calibrated.empty(), false);
+    TEST_EQUAL(calibrated.front().min_elements, 0u);
+    TEST_EQUAL(std::all_of(calibrated.begin(), calibrated.end(), [](const FftThreadCrossover& c) { return c.threads >= 1 && c.threads <= 2; }), true);
+
+    registry.set_max_threads(1);
+    registry.set_thread_crossovers(defaults);
+}
+
+int fft_plans_test(int /*argc*/, char* /*argv*/[])
+{
+    RUN_TEST(FftPlansTest, Registry);
+    RUN_TEST(FftPlansTest, RealRoundtrip);
+    RUN_TEST(FftPlansTest, ComplexRoundtrip);
+    RUN_TEST(FftPlansTest, Arguments);
+    RUN_TEST(FftPlansTest, Wisdom);
+    RUN_TEST(FftPlansTest, ThreadExecutors);
+    RUN_TEST(FftPlansTest, ThreadCrossovers);
+
+    Test::summary();
+    return 0;
+}
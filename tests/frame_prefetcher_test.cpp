@@ -0,0 +1,114 @@
+#include "array2.h"
+#include "frame_accumulator.h"
+#include "frame_prefetcher.h"
+#include "log.h"
+#include "test_macros.h"
+#include "testconfig.h"
+#include "types.h"
+#include "videoio.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace smip;
+
+namespace {
+const std::string c_filename { smip::test::datafile };
+
+/*! the frame at \e index of the test video decoded synchronously */
+Array2<double> decoded_frame(std::size_t index)
+{
+    FrameExtractor fe(c_filename);
+    fe.seek(index);
+    return Mat2Array<double>(fe.extract_next_frame(), color_channel_t::white);
+}
+
+bool equal(const Array2<double>& a, const Array2<double>& b)
+{
+    return a.ncols() == b.ncols() && a.nrows() == b.nrows() && std::equal(a.begin(), a.end(), b.begin());
+}
+} // namespace
+
+TEST(FramePrefetcherTest, Sequence)
+{
+    TEST_CASE("Prefetched Frame Sequence");
+    FrameExtractor fe(c_filename);
+    FramePrefetcher prefetcher(fe, 5, 12, 3);
+    TEST_EQUAL(prefetcher.capacity(), 3u);
+    for (std::size_t index { 5 }; index < 17; ++index) {
+        const auto handle { prefetcher.next() };
+        TEST_EQUAL(static_cast<bool>(handle), true);
+        TEST_EQUAL(handle.index(), index);
+        TEST_EQUAL(equal(Mat2Array<double>(handle.frame(), color_channel_t::white), decoded_frame(index)), true);
+    }
+    TEST_EQUAL(static_cast<bool>(prefetcher.next()), false);
+    TEST_EQUAL(static_cast<bool>(prefetcher.next()), false);
+}
+
+TEST(FramePrefetcherTest, Handles)
+{
+    TEST_CASE("Prefetched Frame Handles and Shutdown");
+    const std::size_t nframes { FrameExtractor(c_filename).nframes() };
+    {
+        // the range is truncated at the end of the video
+        FrameExtractor fe(c_filename);
+        FramePrefetcher prefetcher(fe, nframes - 2, 10, 2);
+        auto first { prefetcher.next() };
+        auto second { prefetcher.next() };
+        TEST_EQUAL(second.index(), nframes - 1);
+        // the assignment returns the buffer of the second frame to the pool
+        second = std::move(first);
+        TEST_EQUAL(static_cast<bool>(first), false);
+        TEST_EQUAL(second.index(), nframes - 2);
+        TEST_EQUAL(static_cast<bool>(prefetcher.next()), false);
+        TEST_THROW(static_cast<void>(first.frame()), std::logic_error);
+        second.release();
+        TEST_EQUAL(static_cast<bool>(second), false);
+    }
+    {
+        // all buffers held by the consumer: the decoder waits until one is released
+        FrameExtractor fe(c_filename);
+        FramePrefetcher prefetcher(fe, 0, nframes, 2);
+        auto first { prefetcher.next() };
+        auto second { prefetcher.next() };
+        first.release();
+        const auto third { prefetcher.next() };
+        TEST_EQUAL(third.index(), 2u);
+        TEST_EQUAL(equal(Mat2Array<double>(third.frame(), color_channel_t::white), decoded_frame(2)), true);
+        second.release();
+        // the destructor stops the decoder with frames still pending
+    }
+    FrameExtractor fe(c_filename);
+    TEST_THROW(FramePrefetcher(fe, 0, 1, 0), std::invalid_argument);
+}
+
+TEST(FramePrefetcherTest, Accumulation)
+{
+    TEST_CASE("Accumulation of Prefetched Frames");
+    FrameExtractor fe(c_filename);
+    const auto ref { Mat2Array<double>(fe.extract_next_frame(), color_channel_t::white) };
+    FrameAccumulator sync(ref, 4);
+    TEST_EQUAL(accumulate_frames(fe, color_channel_t::white, 1, 15, sync), 15u);
+    FrameAccumulator prefetched(ref, 4);
+    prefetched.set_prefetch_depth(4);
+    TEST_EQUAL(accumulate_frames(fe, color_channel_t::white, 1, 15, prefetched), 15u);
+    TEST_EQUAL(prefetched.nframes(), sync.nframes());
+    TEST_EQUAL(equal(prefetched.sum_image(), sync.sum_image()), true);
+    TEST_EQUAL(equal(prefetched.powerspectrum(), sync.powerspectrum()), true);
+    TEST_EQUAL(std::equal(prefetched.bispectrum().begin(), prefetched.bispectrum().end(), sync.bispectrum().begin()), true);
+    // the extractor continues after the last prefetched frame
+    TEST_EQUAL(fe.current_frame(), 16u);
+}
+
+int frame_prefetcher_test(int /*argc*/, char* /*argv*/[])
+{
+    log::system::setup(log::Level::Warning, [](int) {}, std::cerr);
+    RUN_TEST(FramePrefetcherTest, Sequence);
+    RUN_TEST(FramePrefetcherTest, Handles);
+    RUN_TEST(FramePrefetcherTest, Accumulation);
+
+    Test::summary();
+    return 0;
+}
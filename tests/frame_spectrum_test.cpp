@@ -0,0 +1,246 @@
+#include "array2.h"
+#include "bispectrum.h"
+#include "crosscorrel.h"
+#include "frame_spectrum.h"
+#include "test_fixtures.h"
+#include "test_macros.h"
+#include "types.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <fftw3.h>
+#include <random>
+#include <type_traits>
+#include <utility>
+
+using namespace smip;
+
+namespace {
+Array2<double> random_frame(std::size_t xsize, std::size_t ysize, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> distrib(0., 1.);
+    Array2<double> frame(xsize, ysize);
+    for (auto& val : frame) {
+        val = distrib(gen);
+    }
+    return frame;
+}
+
+Array2<complex_t> fft_of(const Array2<double>& frame)
+{
+    Array2<complex_t> fft(frame.ncols(), frame.nrows());
+    std::transform(frame.begin(), frame.end(), fft.begin(), [](double val) { return complex_t { val, 0. }; });
+    fftw_plan plan = fftw_plan_dft_2d(fft.nrows(), fft.ncols(),
+        reinterpret_cast<fftw_complex*>(fft.data().get()),
+        reinterpret_cast<fftw_complex*>(fft.data().get()),
+        FFTW_FORWARD, FFTW_ESTIMATE);
+    fftw_execute(plan);
+    fftw_destroy_plan(plan);
+    return fft;
+}
+
+Array2<complex_t> halfplane_fft_of(const Array2<double>& frame)
+{
+    Array2<double> input { frame };
+    Array2<complex_t> fft(frame.ncols() / 2 + 1, frame.nrows());
+    fftw_plan plan = fftw_plan_dft_r2c_2d(frame.nrows(), frame.ncols(),
+        input.data().get(),
+        reinterpret_cast<fftw_complex*>(fft.data().get()),
+        FFTW_ESTIMATE);
+    fftw_execute(plan);
+    fftw_destroy_plan(plan);
+    return fft;
+}
+} // namespace
+
+TEST(FrameSpectrumTest, Region)
+{
+    TEST_CASE("FrameSpectrum Region and Indexing");
+    const auto fft { fft_of(random_frame(10, 7, 1)) };
+    FrameSpectrum<bispec_complex_t> spectrum(fft, { 3, 20 });
+    TEST_EQUAL(spectrum.min_sindices()[0], -3);
+    TEST_EQUAL(spectrum.max_sindices()[0], 3);
+    TEST_EQUAL(spectrum.min_sindices()[1], fft.min_sindices()[1]);
+    TEST_EQUAL(spectrum.max_sindices()[1], fft.max_sindices()[1]);
+    TEST_EQUAL(spectrum.size(), 7 * 7);
+    // columns are contiguous in y
+    TEST_EQUAL(spectrum.column(1) + 2, &spectrum.at({ 1, 2 }));
+    TEST_EQUAL(spectrum.at({ -2, 3 }), static_cast<bispec_complex_t>(fft.at({ -2, 3 })));
+    // frequencies beyond the region are zero or taken from the hermitian symmetric element
+    TEST_EQUAL(spectrum.value({ 4, 1 }), bispec_complex_t {});
+    TEST_EQUAL(spectrum.contains({ -3, 3 }), true);
+    TEST_EQUAL(spectrum.contains({ -3, -4 }), false);
+    // the positive nyquist frequency of an even frame size is only stored with negative sign
+    const FrameSpectrum<bispec_complex_t> full_spectrum(fft, { 5, 3 });
+    TEST_EQUAL(full_spectrum.contains({ 5, 1 }), false);
+    TEST_EQUAL(full_spectrum.value({ 5, 1 }), std::conj(full_spectrum.at({ -5, -1 })));
+}
+
+TEST(FrameSpectrumTest, HalfPlane)
+{
+    TEST_CASE("FrameSpectrum from Half-Plane Spectrum");
+    for (const auto& sizes : { Array2<double>::extents { 10, 7 }, Array2<double>::extents { 9, 8 } }) {
+        const auto frame { random_frame(sizes[0], sizes[1], 5) };
+        const FrameSpectrum<bispec_complex_t> full(fft_of(frame), { sizes[0] / 2, sizes[1] / 2 });
+        FrameSpectrum<bispec_complex_t> half(sizes, { sizes[0] / 2, sizes[1] / 2 });
+        half.assign_halfplane(halfplane_fft_of(frame));
+        double max_diff { 0. };
+        for (std::size_t i { 0 }; i < full.size(); ++i) {
+            max_diff = std::max(max_diff, static_cast<double>(std::abs(full.data()[i] - half.data()[i])));
+        }
+        TEST_NEAR(max_diff, 0., 1e-5);
+    }
+}
+
+TEST(FrameSpectrumTest, BispectrumAccumulation)
+{
+    TEST_CASE("Bispectrum Accumulation from FrameSpectrum");
+    for (const auto& sizes : { Bispectrum<bispec_complex_t>::extents { 12, 12, 6, 6 }, Bispectrum<bispec_complex_t>::extents { 11, 8, 5, 4 } }) {
+        const auto fft { fft_of(random_frame(sizes[0], sizes[1], 2)) };
+        Bispectrum<bispec_complex_t> reference(sizes);
+        Bispectrum<bispec_complex_t> compact(sizes);
+        reference.accumulate_from_fft(fft);
+        compact.accumulate_from_fft(FrameSpectrum<bispec_complex_t>(fft, { sizes[0] / 2, sizes[1] / 2 }));
+        double max_diff { 0. };
+        for (std::size_t i { 0 }; i < reference.size(); ++i) {
+            max_diff = std::max(max_diff, static_cast<double>(std::abs(reference[i] - compact[i])));
+        }
+        TEST_NEAR(max_diff, 0., 1e-4);
+        compact.subtract_from_fft(FrameSpectrum<bispec_complex_t>(fft, { sizes[0] / 2, sizes[1] / 2 }));
+        max_diff = 0.;
+        for (const auto& val : compact) {
+            max_diff = std::max(max_diff, static_cast<double>(std::abs(val)));
+        }
+        TEST_NEAR(max_diff, 0., 1e-4);
+    }
+}
+
+TEST(FrameSpectrumTest, Registration)
+{
+    TEST_CASE("Cross Correlation from FrameSpectrum");
+    const auto ref { random_frame(32, 24, 3) };
+    const DimVector<int, 2> shift { 5, -3 };
+    const auto frame { ref.shifted(shift) };
+    CrossCorrelation<double> correl(ref);
+    const FrameSpectrum<bispec_complex_t> spectrum(fft_of(frame), { 16, 12 });
+    const auto displacement { correl(spectrum) };
+    TEST_EQUAL(displacement[0], shift[0]);
+    TEST_EQUAL(displacement[1], shift[1]);
+    const auto direct { correl(frame) };
+    TEST_EQUAL(direct[0], displacement[0]);
+    TEST_EQUAL(direct[1], displacement[1]);
+}
+
+TEST(FrameSpectrumTest, RepeatedRegistration)
+{
+    TEST_CASE("Repeated Cross Correlation with one Reference");
+    const auto ref { random_frame(32, 24, 3) };
+    CrossCorrelation<double> correl(ref);
+    for (const DimVector<int, 2>& shift : { DimVector<int, 2> { 5, -3 }, { -7, 2 }, { 0, 0 } }) {
+        const auto frame { ref.shifted(shift) };
+        const FrameSpectrum<bispec_complex_t> spectrum(fft_of(frame), { 16, 12 });
+        for (const bool from_spectrum : { true, false }) {
+            CrossCorrelation<double> fresh(ref);
+            const auto displacement { from_spectrum ? correl(spectrum) : correl(frame) };
+            const auto fresh_displacement { from_spectrum ? fresh(spectrum) : fresh(frame) };
+            TEST_EQUAL(displacement[0], shift[0]);
+            TEST_EQUAL(displacement[1], shift[1]);
+            TEST_EQUAL(fresh_displacement[0], displacement[0]);
+            TEST_EQUAL(fresh_displacement[1], displacement[1]);
+            const auto& correlation { correl.get_correlation_array() };
+            const auto& fresh_correlation { fresh.get_correlation_array() };
+            TEST_EQUAL(std::equal(correlation.begin(), correlation.end(), fresh_correlation.begin()), true);
+        }
+    }
+}
+
+TEST(FrameSpectrumTest, SubpixelRegistration)
+{
+    TEST_CASE("Subpixel Cross Correlation by Upsampled DFT");
+    const auto ref { test::gaussian_frame(32, 24, 15., 11., 2.5) };
+    CrossCorrelation<double> correl(ref);
+    correl.set_upsampling(20);
+    for (const auto& [dx, dy] : { std::pair { 2.3, -1.65 }, std::pair { -4.55, 0.4 }, std::pair { 0., 0. } }) {
+        const auto frame { test::gaussian_frame(32, 24, 15. + dx, 11. + dy, 2.5) };
+        const FrameSpectrum<bispec_complex_t> spectrum(fft_of(frame), { 16, 12 });
+        for (const bool from_spectrum : { true, false }) {
+            const auto displacement { from_spectrum ? correl(spectrum) : correl(frame) };
+            TEST_EQUAL(displacement[0], static_cast<int>(std::round(dx)));
+            TEST_EQUAL(displacement[1], static_cast<int>(std::round(dy)));
+            const auto subpixel { correl.get_subpixel_displacement() };
+            TEST_NEAR(subpixel[0], dx, 0.05);
+            TEST_NEAR(subpixel[1], dy, 0.05);
+        }
+    }
+    // without upsampling the subpixel displacement is the integer one
+    correl.set_upsampling(1);
+    const auto frame { test::gaussian_frame(32, 24, 17.3, 9.35, 2.5) };
+    const auto displacement { correl(frame) };
+    const auto subpixel { correl.get_subpixel_displacement() };
+    TEST_EQUAL(subpixel[0], static_cast<double>(displacement[0]));
+    TEST_EQUAL(subpixel[1], static_cast<double>(displacement[1]));
+}
+
+TEST(FrameSpectrumTest, SinglePrecisionRegistration)
+{
+    TEST_CASE("Cross Correlation in Single Precision");
+    static_assert(std::is_same_v<CrossCorrelation<float>::real_type, float>);
+    static_assert(std::is_same_v<CrossCorrelation<long double>::real_type, double>);
+    const Array2<double> ref { test::gaussian_frame(32, 24, 15., 11., 2.5) };
+    CrossCorrelation<double> correl(ref);
+    CrossCorrelation<float> single(Array2<float> { ref });
+    single.set_upsampling(20);
+    for (const auto& [dx, dy] : { std::pair { 2.3, -1.65 }, std::pair { -6., 4. } }) {
+        const auto frame { test::gaussian_frame(32, 24, 15. + dx, 11. + dy, 2.5) };
+        const FrameSpectrum<bispec_complex_t> spectrum(fft_of(frame), { 16, 12 });
+        for (const bool from_spectrum : { true, false }) {
+            const auto displacement { from_spectrum ? single(spectrum) : single(Array2<float> { frame }) };
+            const auto expected { correl(frame) };
+            TEST_EQUAL(displacement[0], expected[0]);
+            TEST_EQUAL(displacement[1], expected[1]);
+            TEST_NEAR(single.get_subpixel_displacement()[0], dx, 0.05);
+            TEST_NEAR(single.get_subpixel_displacement()[1], dy, 0.05);
+            const auto& correlation { correl.get_correlation_array() };
+            const auto& single_correlation { single.get_correlation_array() };
+            double max_diff { 0. };
+            for (std::size_t i { 0 }; i < correlation.size(); ++i) {
+                max_diff = std::max(max_diff, std::abs(correlation.data()[i] - single_correlation.data()[i]));
+            }
+            TEST_NEAR(max_diff / *std::max_element(correlation.begin(), correlation.end()), 0., 1e-5);
+        }
+    }
+}
+
+TEST(FrameSpectrumTest, PowerSpectrum)
+{
+    TEST_CASE("Power Spectrum from FrameSpectrum");
+    for (const auto& sizes : { Array2<double>::extents { 9, 6 }, Array2<double>::extents { 8, 7 } }) {
+        const auto fft { fft_of(random_frame(sizes[0], sizes[1], 4)) };
+        Array2<double> powerspec(sizes[0] / 2 + 1, sizes[1], 0.);
+        FrameSpectrum<bispec_complex_t>(fft, { sizes[0] / 2, sizes[1] / 2 }).add_powerspectrum_to(powerspec, 2.);
+        double max_diff { 0. };
+        for (std::size_t y { 0 }; y < powerspec.nrows(); ++y) {
+            for (std::size_t x { 0 }; x < powerspec.ncols(); ++x) {
+                const double ps { std::norm(fft(x, y)) };
+                max_diff = std::max(max_diff, std::abs(powerspec(x, y) - 2. * ps) / (1. + ps));
+            }
+        }
+        TEST_NEAR(max_diff, 0., 1e-5);
+    }
+}
+
+int frame_spectrum_test(int /*argc*/, char* /*argv*/[])
+{
+    RUN_TEST(FrameSpectrumTest, Region);
+    RUN_TEST(FrameSpectrumTest, HalfPlane);
+    RUN_TEST(FrameSpectrumTest, BispectrumAccumulation);
+    RUN_TEST(FrameSpectrumTest, Registration);
+    RUN_TEST(FrameSpectrumTest, RepeatedRegistration);
+    RUN_TEST(FrameSpectrumTest, SubpixelRegistration);
+    RUN_TEST(FrameSpectrumTest, SinglePrecisionRegistration);
+    RUN_TEST(FrameSpectrumTest, PowerSpectrum);
+
+    Test::summary();
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "array2.h"
+#include "fft_plans.h"
+#include "frame_stack.h"
+#include "test_fixtures.h"
+#include "test_macros.h"
+#include "types.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <vector>
+
+using namespace smip;
+
+namespace {
+constexpr std::size_t c_xsize { 18 };
+constexpr std::size_t c_ysize { 11 };
+
+/*! maximum deviation of the spectra in \e stack from the spectra of the single frame plan */
+double max_spectrum_error(const FrameStack& stack)
+{
+    const auto plan { FftPlanRegistry::instance().executor<double>({ c_xsize, c_ysize, FftKind::r2c }) };
+    Array2<double> frame(c_xsize, c_ysize, fft_buffer<double>(c_xsize * c_ysize));
+    Array2<complex_t> spectrum(c_xsize / 2 + 1, c_ysize, fft_buffer<complex_t>((c_xsize / 2 + 1) * c_ysize));
+    double max_diff { 0. };
+    for (std::size_t i { 0 }; i < stack.size(); ++i) {
+        std::copy(stack.frame(i).begin(), stack.frame(i).end(), frame.begin());
+        plan.execute(frame.data().get(), spectrum.data().get());
+        max_diff = std::inner_product(spectrum.begin(), spectrum.end(), stack.spectrum(i).begin(), max_diff,
+            [](double a, double b) { return std::max(a, b); },
+            [](const complex_t& a, const complex_t& b) { return std::abs(a - b); });
+    }
+    return max_diff;
+}
+} // namespace
+
+TEST(FrameStackTest, BatchedTransform)
+{
+    TEST_CASE("FrameStack Batched Transform");
+    const auto frames { test::random_frames(4, c_xsize, c_ysize, 815) };
+    FrameStack stack(c_xsize, c_ysize, 4);
+    TEST_EQUAL(stack.empty(), true);
+    for (const auto& frame : frames) {
+        stack.push_back(frame);
+    }
+    TEST_EQUAL(stack.full(), true);
+    TEST_EQUAL(stack.transformed(), false);
+    // consecutive frames are padded, such that every frame starts aligned
+    TEST_EQUAL(stack.frame(1).data().get() - stack.frame(0).data().get(), static_cast<std::ptrdiff_t>(fft_batch_distance(c_xsize * c_ysize)));
+    TEST_EQUAL(std::equal(frames[2].begin(), frames[2].end(), stack.frame(2).begin()), true);
+    stack.transform();
+    TEST_EQUAL(stack.transformed(), true);
+    TEST_EQUAL(stack.spectrum(3).ncols(), c_xsize / 2 + 1);
+    TEST_NEAR(max_spectrum_error(stack), 0., 1e-9);
+}
+
+TEST(FrameStackTest, PartialStack)
+{
+    TEST_CASE("FrameStack Partially Filled");
+    const auto frames { test::random_frames(5, c_xsize, c_ysize, 815) };
+    FrameStack stack(c_xsize, c_ysize, 3);
+    stack.push_back(frames[0]);
+    stack.push_back(frames[1]);
+    stack.push_back(frames[2]);
+    TEST_THROW(stack.push_back(frames[3]), std::length_error);
+    stack.clear();
+    TEST_EQUAL(stack.empty(), true);
+    stack.push_back(frames[3]);
+    stack.push_back(frames[4]);
+    stack.transform();
+    TEST_EQUAL(stack.size(), 2u);
+    TEST_EQUAL(std::equal(frames[4].begin(), frames[4].end(), stack.frame(1).begin()), true);
+    TEST_NEAR(max_spectrum_error(stack), 0., 1e-9);
+}
+
+TEST(FrameStackTest, Arguments)
+{
+    TEST_CASE("FrameStack Arguments");
+    TEST_THROW(FrameStack(c_xsize, c_ysize, 0), std::invalid_argument);
+    FrameStack stack(c_xsize, c_ysize, 2);
+    TEST_THROW(stack.push_back(Array2<double>(c_ysize, c_xsize)), std::invalid_argument);
+    TEST_THROW(static_cast<void>(FftPlanRegistry::instance().executor<double>({ c_xsize, c_ysize, FftKind::r2c, FftPrecision::double_precision, true, true, 2 })), std::runtime_error);
+}
+
+int frame_stack_test(int /*argc*/, char* /*argv*/[])
+{
+    RUN_TEST(FrameStackTest, BatchedTransform);
+    RUN_TEST(FrameStackTest, PartialStack);
+    RUN_TEST(FrameStackTest, Arguments);
+
+    Test::summary();
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include "array2.h"
+#include "bispectrum.h"
+#include "constants.h"
+#include "incremental_reco.h"
+#include "phasemap.h"
+#include "phasereco.h"
+#include "reconstruction_plan.h"
+#include "test_fixtures.h"
+#include "test_macros.h"
+#include "types.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <random>
+#include <stdexcept>
+
+using namespace smip;
+using namespace smip::test;
+
+namespace {
+/*! accumulates \e nframes frames of a fixed object spectrum with additive complex noise of modulus \e noise */
+class NoisyFrames {
+public:
+    explicit NoisyFrames(double noise)
+        : m_noise(noise)
+        , m_object(c_size, c_size, complex_t {})
+        , m_bispectrum({ c_size, c_size, c_depth, c_depth })
+    {
+        std::uniform_real_distribution<double> phase(-constants::pi<double>, constants::pi<double>);
+        for (auto& val : m_object) {
+            val = std::polar(1., phase(m_gen));
+        }
+    }
+    void accumulate(std::size_t nframes)
+    {
+        std::uniform_real_distribution<double> phase(-constants::pi<double>, constants::pi<double>);
+        for (std::size_t frame { 0 }; frame < nframes; ++frame) {
+            Array2<complex_t> spectrum(c_size, c_size, complex_t {});
+            for (int y { spectrum.min_sindices()[1] }; y <= spectrum.max_sindices()[1]; ++y) {
+                for (int x { spectrum.min_sindices()[0] }; x <= spectrum.max_sindices()[0]; ++x) {
+                    if (spectrum.at({ x, y }) != complex_t {}) {
+                        continue;
+                    }
+                    spectrum.at({ x, y }) = m_object.at({ x, y }) + std::polar(m_noise, phase(m_gen));
+                    if (spectrum.range().contains({ -x, -y })) {
+                        spectrum.at({ -x, -y }) = std::conj(spectrum.at({ x, y }));
+                    }
+                }
+            }
+            m_bispectrum.accumulate_from_fft(spectrum);
+            ++m_nframes;
+        }
+    }
+    /*! the bispectrum normalized to the number of accumulated frames */
+    [[nodiscard]] Bispectrum<bispec_complex_t> normalized() const
+    {
+        Bispectrum<bispec_complex_t> bispectrum { m_bispectrum };
+        bispectrum /= bispec_complex_t(static_cast<float>(m_nframes), 0.f);
+        return bispectrum;
+    }
+
+private:
+    std::mt19937 m_gen { 815 };
+    double m_noise { 0. };
+    Array2<complex_t> m_object;
+    Bispectrum<bispec_complex_t> m_bispectrum;
+    std::size_t m_nframes { 0 };
+};
+
+double max_difference(const Array2<complex_t>& phases, const Array2<complex_t>& reference)
+{
+    double max_diff { 0. };
+    for (std::size_t i { 0 }; i < phases.size(); ++i) {
+        max_diff = std::max(max_diff, std::abs(phases.data()[i] - reference.data()[i]));
+    }
+    return max_diff;
+}
+} // namespace
+
+TEST(IncrementalRecoTest, FullUpdate)
+{
+    TEST_CASE("Incremental Reconstruction without Threshold");
+    const auto bispectrum { random_bispectrum(4711) };
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    IncrementalReconstruction<complex_t> incremental(plan, 0.);
+    for (const unsigned int seed : { 4711u, 42u }) {
+        const auto current { random_bispectrum(seed) };
+        PhaseMap ref_pm;
+        const auto ref_phases { reconstruct_phases<complex_t>(current, plan, &ref_pm) };
+        TEST_EQUAL(incremental.update(current) > 0, true);
+        TEST_EQUAL(incremental.phasemap() == ref_pm, true);
+        TEST_EQUAL(max_difference(incremental.phases(), ref_phases), 0.);
+    }
+    TEST_EQUAL(incremental.nupdates(), 2u);
+}
+
+TEST(IncrementalRecoTest, Unchanged)
+{
+    TEST_CASE("Incremental Reconstruction of an Unchanged Bispectrum");
+    const auto bispectrum { random_bispectrum(4711) };
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    IncrementalReconstruction<complex_t> incremental(plan);
+    incremental.update(bispectrum);
+    const Array2<complex_t> phases { incremental.phases() };
+    const PhaseMap pm { incremental.phasemap() };
+    TEST_EQUAL(incremental.update(bispectrum), 0u);
+    TEST_EQUAL(incremental.phasemap() == pm, true);
+    TEST_EQUAL(max_difference(incremental.phases(), phases), 0.);
+}
+
+TEST(IncrementalRecoTest, CancellingChanges)
+{
+    TEST_CASE("Incremental Reconstruction of Opposite Element Changes");
+    const auto bispectrum { random_bispectrum(4711) };
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    IncrementalReconstruction<complex_t> incremental(plan);
+    incremental.update(bispectrum);
+    // shift two elements of the last target in opposite directions, their sum stays the same
+    const ReconstructionPlan::Target& target { plan.targets()[plan.visit_order().back()] };
+    const BispectrumLocation* const locations { plan.locations().data() + target.first_pair };
+    const std::size_t second { static_cast<std::size_t>(std::find_if(locations + 1, locations + target.npairs,
+                                   [&](const BispectrumLocation& location) { return location.offset != locations[0].offset; })
+        - locations) };
+    TEST_EQUAL(second < target.npairs, true);
+    auto changed { bispectrum };
+    changed.data()[locations[0].offset] += bispec_complex_t { 0.5f, 0.f };
+    changed.data()[locations[second].offset] -= bispec_complex_t { 0.5f, 0.f };
+    TEST_EQUAL(incremental.update(changed) > 0, true);
+    PhaseMap ref_pm;
+    const auto ref_phases { reconstruct_phases<complex_t>(changed, plan, &ref_pm) };
+    TEST_EQUAL(incremental.phasemap() == ref_pm, true);
+    TEST_EQUAL(max_difference(incremental.phases(), ref_phases), 0.);
+}
+
+TEST(IncrementalRecoTest, GrowingBispectrum)
+{
+    TEST_CASE("Incremental Reconstruction of a Growing Bispectrum");
+    NoisyFrames frames(0.5);
+    frames.accumulate(100);
+    const ReconstructionPlan plan(frames.normalized(), c_size, c_size, c_radius);
+    IncrementalReconstruction<complex_t> incremental(plan, 0.02);
+    const std::size_t nfirst { incremental.update(frames.normalized()) };
+    frames.accumulate(5);
+    const auto bispectrum { frames.normalized() };
+    const std::size_t nrecomputed { incremental.update(bispectrum) };
+    TEST_EQUAL(nrecomputed > 0, true);
+    TEST_EQUAL(nrecomputed < nfirst, true);
+    PhaseMap ref_pm;
+    const auto ref_phases { reconstruct_phases<complex_t>(bispectrum, plan, &ref_pm) };
+    TEST_EQUAL(incremental.phasemap().same_flags(ref_pm), true);
+    TEST_NEAR(max_difference(incremental.phases(), ref_phases), 0., 0.1);
+}
+
+TEST(IncrementalRecoTest, Arguments)
+{
+    TEST_CASE("Incremental Reconstruction Arguments");
+    const auto bispectrum { random_bispectrum(4711) };
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    IncrementalReconstruction<complex_t> incremental(plan);
+    const Bispectrum<bispec_complex_t> other({ c_size, c_size, c_depth + 2, c_depth + 2 });
+    TEST_THROW(incremental.update(other), std::invalid_argument);
+    TEST_EQUAL(incremental.nupdates(), 0u);
+}
+
+int incremental_reco_test(int /*argc*/, char* /*argv*/[])
+{
+    RUN_TEST(IncrementalRecoTest, FullUpdate);
+    RUN_TEST(IncrementalRecoTest, Unchanged);
+    RUN_TEST(IncrementalRecoTest, CancellingChanges);
+    RUN_TEST(IncrementalRecoTest, GrowingBispectrum);
+    RUN_TEST(IncrementalRecoTest, Arguments);
+
+    Test::summary();
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "array2.h"
+#include "bispectrum.h"
+#include "multires_reco.h"
+#include "phasemap.h"
+#include "phasereco.h"
+#include "reconstruction_plan.h"
+#include "test_fixtures.h"
+#include "test_macros.h"
+#include "types.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+
+using namespace smip;
+using namespace smip::test;
+
+namespace {
+// a larger frame than in the other reconstruction tests, for three lattice levels
+constexpr std::size_t c_lattice_size { 32 };
+constexpr std::size_t c_lattice_depth { 8 };
+constexpr double c_lattice_radius { 14. };
+
+Array2<complex_t> lattice_spectrum() { return object_spectrum(7, c_lattice_size); }
+} // namespace
+
+TEST(MultiresRecoTest, SingleLevel)
+{
+    TEST_CASE("Multi-resolution Reconstruction with a Single Level");
+    const auto bispectrum { object_bispectrum(lattice_spectrum(), 0., c_lattice_depth) };
+    PhaseMap ref_pm;
+    const auto ref_phases { reconstruct_phases<complex_t>(bispectrum, c_lattice_size, c_lattice_size, c_lattice_radius, &ref_pm) };
+    PhaseMap pm;
+    const auto phases { reconstruct_phases_multires<complex_t>(bispectrum, c_lattice_size, c_lattice_size, c_lattice_radius, { 1, 2, 1 }, &pm) };
+    // same pairs as the recursive reconstruction, only summed in a different order
+    TEST_EQUAL(pm.same_flags(ref_pm), true);
+    double max_error { 0. };
+    for (std::size_t i { 0 }; i < phases.size(); ++i) {
+        max_error = std::max(max_error, std::abs(phases.data()[i] - ref_phases.data()[i]));
+    }
+    TEST_NEAR(max_error, 0., 1e-6);
+}
+
+TEST(MultiresRecoTest, CoarseToFine)
+{
+    TEST_CASE("Coarse-to-fine Reconstruction of Consistent Phases");
+    const auto spectrum { lattice_spectrum() };
+    const auto bispectrum { object_bispectrum(spectrum, 0., c_lattice_depth) };
+    PhaseMap ref_pm;
+    reconstruct_phases<complex_t>(bispectrum, c_lattice_size, c_lattice_size, c_lattice_radius, &ref_pm);
+    for (const unsigned int levels : { 2u, 3u }) {
+        for (const unsigned int sweeps : { 0u, 2u }) {
+            PhaseMap pm;
+            const auto phases { reconstruct_phases_multires<complex_t>(bispectrum, c_lattice_size, c_lattice_size, c_lattice_radius, { levels, 1, sweeps }, &pm) };
+            TEST_EQUAL(pm.same_flags(ref_pm), true);
+            TEST_NEAR(max_phase_error(phases, spectrum, pm), 0., 1e-5);
+            TEST_NEAR(pm.at({ 9, -5 }).consistency, 1., 1e-5);
+        }
+    }
+}
+
+TEST(MultiresRecoTest, Arguments)
+{
+    TEST_CASE("Multi-resolution Reconstruction Arguments");
+    const auto bispectrum { object_bispectrum(lattice_spectrum(), 0., c_lattice_depth) };
+    TEST_THROW(reconstruct_phases_multires<complex_t>(bispectrum, c_lattice_size, c_lattice_size, c_lattice_radius, { 0, 2, 1 }), std::invalid_argument);
+    TEST_THROW(reconstruct_phases_multires<complex_t>(bispectrum, c_lattice_size, c_lattice_size, c_lattice_radius, { 2, 0, 1 }), std::invalid_argument);
+    // a lattice spacing of 8 does not fit into the v-range [-4, 4]
+    TEST_THROW(reconstruct_phases_multires<complex_t>(bispectrum, c_lattice_size, c_lattice_size, c_lattice_radius, { 4, 2, 1 }), std::invalid_argument);
+}
+
+int multires_reco_test(int /*argc*/, char* /*argv*/[])
+{
+    RUN_TEST(MultiresRecoTest, SingleLevel);
+    RUN_TEST(MultiresRecoTest, CoarseToFine);
+    RUN_TEST(MultiresRecoTest, Arguments);
+
+    Test::summary();
+    return 0;
+}
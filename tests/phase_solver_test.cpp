@@ -0,0 +1,123 @@
+#include "array2.h"
+#include "bispectrum.h"
+#include "phase_solver.h"
+#include "phasemap.h"
+#include "phasereco.h"
+#include "reconstruction_plan.h"
+#include "test_fixtures.h"
+#include "test_macros.h"
+#include "types.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+
+using namespace smip;
+using namespace smip::test;
+
+namespace {
+/*! rms deviation of the reconstructed phasors from the true ones */
+double phase_error(const Array2<complex_t>& phases, const Array2<complex_t>& spectrum, const PhaseMap& pm)
+{
+    double sum { 0. };
+    std::size_t n { 0 };
+    for (std::size_t i { 0 }; i < phases.size(); ++i) {
+        if (pm.flag(i)) {
+            const complex_t truth { spectrum.data()[i] / std::abs(spectrum.data()[i]) };
+            sum += std::norm(phases.data()[i] - truth);
+            n++;
+        }
+    }
+    return std::sqrt(sum / n);
+}
+} // namespace
+
+TEST(PhaseSolverTest, Consistent)
+{
+    TEST_CASE("Phase Refinement of Consistent Phases");
+    const auto spectrum { object_spectrum(2024) };
+    const auto bispectrum { object_bispectrum(spectrum, 0.) };
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    PhaseMap pm;
+    auto phases { reconstruct_phases<complex_t>(bispectrum, plan, &pm) };
+    TEST_NEAR(phase_error(phases, spectrum, pm), 0., 1e-5);
+    const std::size_t iterations { refine_phases(bispectrum, plan, phases, pm, { 20, 1e-4, 2 }) };
+    TEST_EQUAL(iterations < 20, true);
+    TEST_NEAR(phase_error(phases, spectrum, pm), 0., 1e-5);
+    TEST_NEAR(pm.at({ 3, 4 }).consistency, 1., 1e-5);
+}
+
+TEST(PhaseSolverTest, Noisy)
+{
+    TEST_CASE("Phase Refinement of Noisy Phases");
+    const auto spectrum { object_spectrum(2024) };
+    const auto bispectrum { object_bispectrum(spectrum, 1.) };
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    PhaseMap pm;
+    const auto phases { reconstruct_phases<complex_t>(bispectrum, plan, &pm) };
+    const double recursive_error { phase_error(phases, spectrum, pm) };
+
+    auto refined = [&](unsigned int nthreads, PhaseMap& refined_pm) {
+        auto refined_phases { phases };
+        refined_pm = pm;
+        refine_phases(bispectrum, plan, refined_phases, refined_pm, { 30, 0., nthreads });
+        return refined_phases;
+    };
+    PhaseMap pm1;
+    const auto phases1 { refined(1, pm1) };
+    PhaseMap pm3;
+    const auto phases3 { refined(3, pm3) };
+    TEST_EQUAL(phase_error(phases1, spectrum, pm1) < recursive_error, true);
+    // the jacobi iteration does not depend on the partitioning
+    TEST_EQUAL(std::equal(phases1.begin(), phases1.end(), phases3.begin()), true);
+    TEST_EQUAL(pm1.at({ 3, 4 }).consistency, pm3.at({ 3, 4 }).consistency);
+}
+
+TEST(PhaseSolverTest, Standalone)
+{
+    TEST_CASE("Standalone Phase Solver");
+    const auto spectrum { object_spectrum(2024) };
+    const auto consistent { object_bispectrum(spectrum, 0.) };
+    const ReconstructionPlan plan(consistent, c_size, c_size, c_radius);
+    std::size_t iterations { 0 };
+    PhaseMap pm;
+    const auto phases { solve_phases<complex_t>(consistent, plan, &pm, { 20, 1e-4, 2 }, &iterations) };
+    TEST_EQUAL(iterations < 20, true);
+    TEST_NEAR(phase_error(phases, spectrum, pm), 0., 1e-5);
+
+    // iterated to convergence, the solver beats the recursive reconstruction of noisy phases on its own
+    const auto bispectrum { object_bispectrum(spectrum, 1.) };
+    PhaseMap recursive_pm;
+    const auto recursive_phases { reconstruct_phases<complex_t>(bispectrum, plan, &recursive_pm) };
+    PhaseMap solved_pm;
+    const auto solved_phases { solve_phases<complex_t>(bispectrum, plan, &solved_pm, { 1000, 0., 3 }) };
+    TEST_EQUAL(phase_error(solved_phases, spectrum, solved_pm) < 0.8 * phase_error(recursive_phases, spectrum, recursive_pm), true);
+}
+
+TEST(PhaseSolverTest, Arguments)
+{
+    TEST_CASE("Phase Refinement Arguments");
+    const auto bispectrum { object_bispectrum(object_spectrum(2024), 0.) };
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    PhaseMap pm;
+    auto phases { reconstruct_phases<complex_t>(bispectrum, plan, &pm) };
+    const auto unchanged { phases };
+    TEST_EQUAL(refine_phases(bispectrum, plan, phases, pm, { 0, 0., 1 }), 0);
+    TEST_EQUAL(std::equal(phases.begin(), phases.end(), unchanged.begin()), true);
+    Array2<complex_t> wrong_size(c_size / 2, c_size / 2);
+    TEST_THROW(refine_phases(bispectrum, plan, wrong_size, pm), std::invalid_argument);
+    const ReconstructionPlan other_plan(Bispectrum<bispec_complex_t>({ c_size, c_size, c_depth + 2, c_depth + 2 }), c_size, c_size, c_radius);
+    TEST_THROW(refine_phases(bispectrum, other_plan, phases, pm), std::invalid_argument);
+    TEST_THROW(solve_phases<complex_t>(bispectrum, other_plan), std::invalid_argument);
+}
+
+int phase_solver_test(int /*argc*/, char* /*argv*/[])
+{
+    RUN_TEST(PhaseSolverTest, Consistent);
+    RUN_TEST(PhaseSolverTest, Noisy);
+    RUN_TEST(PhaseSolverTest, Standalone);
+    RUN_TEST(PhaseSolverTest, Arguments);
+
+    Test::summary();
+    return 0;
+}
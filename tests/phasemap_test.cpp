@@ -0,0 +1,67 @@
+#include "array2.h"
+#include "phasemap.h"
+#include "test_macros.h"
+#include <cstddef>
+
+using namespace smip;
+
+TEST(PhaseMapTest, Elements)
+{
+    TEST_CASE("PhaseMap Element Access");
+    // odd size, the flags of the last row span a partial bitmap word
+    PhaseMap pm(13, 11);
+    TEST_EQUAL(pm.size(), 143);
+    TEST_EQUAL(pm.range().contains({ -6, -5 }), true);
+    TEST_EQUAL(pm.range().contains({ 7, 0 }), false);
+    TEST_EQUAL(pm.flag({ 0, 0 }), false);
+
+    // address offsets follow the signed indices of Array2
+    Array2<int> offsets(13, 11);
+    for (std::size_t i { 0 }; i < offsets.size(); ++i) {
+        offsets.data()[i] = static_cast<int>(i);
+    }
+    for (int y { pm.min_sindices()[1] }; y <= pm.max_sindices()[1]; ++y) {
+        for (int x { pm.min_sindices()[0] }; x <= pm.max_sindices()[0]; ++x) {
+            TEST_EQUAL(pm.offset({ x, y }), static_cast<std::size_t>(offsets.at({ x, y })));
+        }
+    }
+
+    pm.set({ -6, -5 }, { true, 0.25 });
+    pm.set(63, { true, 0.5 });
+    pm.set(64, { true, 0.75 });
+    TEST_EQUAL(pm.flag({ -6, -5 }), true);
+    TEST_EQUAL(pm.at({ -6, -5 }).consistency, 0.25);
+    TEST_EQUAL(pm.flag(62), false);
+    TEST_EQUAL(pm.flag(63), true);
+    TEST_EQUAL(pm.flag(64), true);
+    TEST_EQUAL(pm.flag(65), false);
+    pm.set(63, { false, 0. });
+    TEST_EQUAL(pm.flag(63), false);
+    TEST_EQUAL(pm.flag(64), true);
+    pm.set_consistency(64, 1.);
+    TEST_EQUAL(pm[64].flag, true);
+    TEST_EQUAL(pm[64].consistency, 1.);
+
+    const auto arr { pm.to_array() };
+    TEST_EQUAL(arr.at({ -6, -5 }).flag, true);
+    TEST_EQUAL(arr.at({ -6, -5 }).consistency, 0.25);
+    TEST_EQUAL(arr.data()[64].consistency, 1.);
+    TEST_EQUAL(arr.data()[63].flag, false);
+
+    PhaseMap copy { pm };
+    TEST_EQUAL(copy == pm, true);
+    copy.set_consistency(64, 0.5);
+    TEST_EQUAL(copy == pm, false);
+    TEST_EQUAL(copy.same_flags(pm), true);
+    copy.set(0, { true, 0.5 });
+    TEST_EQUAL(copy.same_flags(pm), false);
+    TEST_EQUAL(PhaseMap(13, 11).same_flags(PhaseMap(11, 13)), false);
+}
+
+int phasemap_test(int /*argc*/, char* /*argv*/[])
+{
+    RUN_TEST(PhaseMapTest, Elements);
+
+    Test::summary();
+    return 0;
+}
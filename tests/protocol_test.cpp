@@ -0,0 +1,182 @@
+#include "array2.h"
+#include "bispectrum.h"
+#include "frame_accumulator.h"
+#include "log.h"
+#include "remote_workers.h"
+#include "test_fixtures.h"
+#include "test_macros.h"
+#include "types.h"
+#include "worker_protocol.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <iostream>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace smip;
+
+namespace {
+constexpr std::size_t c_size { 16 };
+constexpr std::size_t c_depth { 4 };
+
+/*! worker job handler accumulating from an in-memory frame list instead of a video */
+net::AccumulationResult accumulate_job(const net::AccumulationJob& job, const std::vector<Array2<double>>& frames)
+{
+    FrameAccumulator accumulator(job.ref_frame, job.bispectrum_depth, job.with_bispectrum);
+    accumulator.set_upsampling(job.upsampling);
+    accumulator.set_pyramid_levels(job.pyramid_levels);
+    accumulator.set_single_precision(job.single_precision);
+    for (std::size_t i { job.first_frame }; i < job.first_frame + job.count; ++i) {
+        accumulator.add_frame(frames.at(i));
+    }
+    return { job.id, accumulator.nframes(), std::move(accumulator.bispectrum()),
+        std::move(accumulator.powerspectrum()), std::move(accumulator.sum_image()) };
+}
+} // namespace
+
+TEST(WorkerProtocolTest, Serialization)
+{
+    TEST_CASE("Worker Protocol Serialization");
+    const auto frames { test::random_frames(3, c_size, c_size, 815) };
+    net::AccumulationJob job { 17, "/data/video.avi", color_channel_t::green, 100, 25, c_depth, true, frames[0], 4, 2, true };
+    const auto job_copy { net::deserialize_job(net::serialize(job)) };
+    TEST_EQUAL(job_copy.id, job.id);
+    TEST_EQUAL(job_copy.filename, job.filename);
+    TEST_EQUAL(job_copy.color_channel, job.color_channel);
+    TEST_EQUAL(job_copy.first_frame, job.first_frame);
+    TEST_EQUAL(job_copy.count, job.count);
+    TEST_EQUAL(job_copy.bispectrum_depth, job.bispectrum_depth);
+    TEST_EQUAL(job_copy.with_bispectrum, job.with_bispectrum);
+    TEST_EQUAL(std::equal(job_copy.ref_frame.begin(), job_copy.ref_frame.end(), job.ref_frame.begin()), true);
+    TEST_EQUAL(job_copy.upsampling, job.upsampling);
+    TEST_EQUAL(job_copy.pyramid_levels, job.pyramid_levels);
+    TEST_EQUAL(job_copy.single_precision, job.single_precision);
+
+    job.first_frame = 0;
+    job.count = frames.size();
+    const auto result { accumulate_job(job, frames) };
+    const auto result_copy { net::deserialize_result(net::serialize(result)) };
+    TEST_EQUAL(result_copy.job_id, result.job_id);
+    TEST_EQUAL(result_copy.nframes, frames.size());
+    TEST_EQUAL(result_copy.bispectrum.dimsizes() == result.bispectrum.dimsizes(), true);
+    TEST_EQUAL(std::equal(result_copy.bispectrum.begin(), result_copy.bispectrum.end(), result.bispectrum.begin()), true);
+    TEST_EQUAL(std::equal(result_copy.powerspec.begin(), result_copy.powerspec.end(), result.powerspec.begin()), true);
+    TEST_EQUAL(std::equal(result_copy.sum.begin(), result_copy.sum.end(), result.sum.begin()), true);
+
+    // a truncated payload must be rejected
+    auto payload { net::serialize(result) };
+    payload.resize(payload.size() / 2);
+    bool thrown { false };
+    try {
+        static_cast<void>(net::deserialize_result(payload));
+    } catch (const net::ConnectionError&) {
+        thrown = true;
+    }
+    TEST_EQUAL(thrown, true);
+}
+
+#ifndef _WIN32
+TEST(WorkerProtocolTest, LocalhostWorkers)
+{
+    TEST_CASE("Accumulation on Localhost Workers with Failing Worker");
+    const auto frames { test::random_frames(23, c_size, c_size, 815) };
+    net::TcpListener good_listener(0);
+    net::TcpListener bad_listener(0);
+    std::atomic<std::size_t> failed_jobs { 0 };
+    std::thread good_worker([&]() {
+        net::TcpSocket connection { good_listener.accept() };
+        net::serve_worker_session(connection, [&](const net::AccumulationJob& job) { return accumulate_job(job, frames); });
+    });
+    // the bad worker fails on its first job, after which its chunk has to be resent to the good worker
+    std::thread bad_worker([&]() {
+        net::TcpSocket connection { bad_listener.accept() };
+        net::serve_worker_session(connection, [&](const net::AccumulationJob&) -> net::AccumulationResult {
+            failed_jobs++;
+            throw std::runtime_error("simulated decoder failure");
+        });
+    });
+
+    FrameAccumulator remote(frames[0], c_depth);
+    remote.add_frame(frames[0]);
+    const std::size_t merged { net::accumulate_frames_remote(
+        { { "localhost", bad_listener.port() }, { "localhost", good_listener.port() } },
+        "frames", color_channel_t::white, frames[0], 1, frames.size() - 1, 3, remote) };
+    good_worker.join();
+    bad_worker.join();
+
+    FrameAccumulator local(frames[0], c_depth);
+    for (const auto& frame : frames) {
+        local.add_frame(frame);
+    }
+    TEST_EQUAL(failed_jobs.load(), 1);
+    TEST_EQUAL(merged, frames.size() - 1);
+    TEST_EQUAL(remote.nframes(), local.nframes());
+    TEST_NEAR(test::max_difference(remote.sum_image(), local.sum_image()), 0., 1e-9);
+    const double bs_scale { std::accumulate(local.bispectrum().begin(), local.bispectrum().end(), 0.,
+        [](double a, const bispec_complex_t& b) { return std::max(a, static_cast<double>(std::abs(b))); }) };
+    TEST_NEAR(test::max_difference(remote.bispectrum(), local.bispectrum()) / bs_scale, 0., 1e-6);
+}
+
+TEST(WorkerProtocolTest, StalledWorkers)
+{
+    TEST_CASE("Accumulation on Localhost Workers with Hanging and Incomplete Workers");
+    const auto frames { test::random_frames(23, c_size, c_size, 815) };
+    net::TcpListener good_listener(0);
+    net::TcpListener hanging_listener(0);
+    net::TcpListener short_listener(0);
+    auto serve = [](net::TcpListener& listener, const net::job_handler_t& handler) {
+        return std::thread([&listener, handler]() {
+            net::TcpSocket connection { listener.accept() };
+            try {
+                net::serve_worker_session(connection, handler);
+            } catch (const net::ConnectionError&) {
+                // the coordinator closed the connection of a dropped worker
+            }
+        });
+    };
+    std::thread good_worker { serve(good_listener, [&](const net::AccumulationJob& job) { return accumulate_job(job, frames); }) };
+    // the hanging worker answers long after the chunk timeout, its chunk has to be resent
+    std::thread hanging_worker { serve(hanging_listener, [&](const net::AccumulationJob& job) {
+        std::this_thread::sleep_for(std::chrono::seconds { 1 });
+        return accumulate_job(job, frames);
+    }) };
+    // the incomplete worker skips the last frame of its chunk, its result must not be merged
+    std::thread short_worker { serve(short_listener, [&](net::AccumulationJob job) {
+        job.count--;
+        return accumulate_job(job, frames);
+    }) };
+
+    FrameAccumulator remote(frames[0], c_depth);
+    remote.add_frame(frames[0]);
+    const std::size_t merged { net::accumulate_frames_remote(
+        { { "localhost", hanging_listener.port() }, { "localhost", short_listener.port() }, { "localhost", good_listener.port() } },
+        "frames", color_channel_t::white, frames[0], 1, frames.size() - 1, 3, remote, std::chrono::milliseconds { 300 }) };
+    good_worker.join();
+    hanging_worker.join();
+    short_worker.join();
+
+    FrameAccumulator local(frames[0], c_depth);
+    for (const auto& frame : frames) {
+        local.add_frame(frame);
+    }
+    TEST_EQUAL(merged, frames.size() - 1);
+    TEST_EQUAL(remote.nframes(), local.nframes());
+    TEST_NEAR(test::max_difference(remote.sum_image(), local.sum_image()), 0., 1e-9);
+}
+#endif
+
+int protocol_test(int /*argc*/, char* /*argv*/[])
+{
+    log::system::setup(log::Level::Warning, [](int) {}, std::cerr);
+    RUN_TEST(WorkerProtocolTest, Serialization);
+#ifndef _WIN32
+    RUN_TEST(WorkerProtocolTest, LocalhostWorkers);
+    RUN_TEST(WorkerProtocolTest, StalledWorkers);
+#endif
+
+    Test::summary();
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "array2.h"
+#include "crosscorrel.h"
+#include "dimvector.h"
+#include "pyramid_correl.h"
+#include "test_fixtures.h"
+#include "test_macros.h"
+#include "types.h"
+#include <cmath>
+#include <functional>
+#include <random>
+#include <stdexcept>
+
+using namespace smip;
+
+namespace {
+constexpr std::size_t c_xsize { 256 };
+constexpr std::size_t c_ysize { 192 };
+
+/*! test frame with the bright object at (140, 90) */
+Array2<double> spotted_frame(unsigned seed)
+{
+    return test::spotted_frame(c_xsize, c_ysize, 140., 90., seed);
+}
+} // namespace
+
+TEST(PyramidCorrelationTest, Registration)
+{
+    TEST_CASE("Coarse-to-fine Registration");
+    const auto ref { spotted_frame(42) };
+    PyramidCorrelation<double> pyramid(ref, 2);
+    CrossCorrelation<double> correl(ref);
+    TEST_EQUAL(pyramid.binning(), 4u);
+    TEST_EQUAL(pyramid.window(), 2);
+    for (const DimVector<int, 2>& shift : { DimVector<int, 2> { 5, -3 }, { -13, 7 }, { 0, 0 }, { 22, -17 }, { 1, 2 } }) {
+        const auto frame { ref.shifted(shift) };
+        const auto displacement { pyramid(frame) };
+        TEST_EQUAL(displacement[0], shift[0]);
+        TEST_EQUAL(displacement[1], shift[1]);
+        TEST_EQUAL(pyramid.get_displacement()[0], correl(frame)[0]);
+        TEST_EQUAL(pyramid.get_displacement()[1], correl.get_displacement()[1]);
+        TEST_EQUAL(pyramid.window() >= 2, true);
+    }
+}
+
+TEST(PyramidCorrelationTest, NoisyFrames)
+{
+    TEST_CASE("Coarse-to-fine Registration of Noisy Frames");
+    const auto ref { spotted_frame(4711) };
+    std::mt19937 gen(815);
+    std::normal_distribution<double> noise(0., 5.);
+    std::uniform_int_distribution<int> offset(-20, 20);
+    PyramidCorrelation<double> pyramid(ref, 3, 96);
+    for (int i { 0 }; i < 10; ++i) {
+        const DimVector<int, 2> shift { offset(gen), offset(gen) };
+        auto frame { ref.shifted(shift) };
+        for (auto& val : frame) {
+            val += noise(gen);
+        }
+        const auto displacement { pyramid(frame) };
+        TEST_EQUAL(displacement[0], shift[0]);
+        TEST_EQUAL(displacement[1], shift[1]);
+    }
+}
+
+TEST(PyramidCorrelationTest, Arguments)
+{
+    TEST_CASE("Coarse-to-fine Registration Arguments");
+    const auto ref { spotted_frame(42) };
+    TEST_THROW(PyramidCorrelation<double>(ref, 0), std::invalid_argument);
+    TEST_THROW(PyramidCorrelation<double>(ref, 6), std::invalid_argument);
+    PyramidCorrelation<double> pyramid(ref);
+    TEST_THROW(static_cast<void>(pyramid.get_displacement()), std::bad_function_call);
+    TEST_THROW(pyramid(Array2<double>(c_xsize / 2, c_ysize)), std::invalid_argument);
+}
+
+int pyramid_correl_test(int /*argc*/, char* /*argv*/[])
+{
+    RUN_TEST(PyramidCorrelationTest, Registration);
+    RUN_TEST(PyramidCorrelationTest, NoisyFrames);
+    RUN_TEST(PyramidCorrelationTest, Arguments);
+
+    Test::summary();
+    return 0;
+}
@@ -0,0 +1,311 @@
+#include "array2.h"
+#include "bispectrum.h"
+#include "constants.h"
+#include "phasemap.h"
+#include "phasereco.h"
+#include "reconstruction_plan.h"
+#include "test_fixtures.h"
+#include "test_macros.h"
+#include "types.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace smip;
+using namespace smip::test;
+
+namespace {
+/*! reference reconstruction evaluating calc_phase() along the visit order of NextRecoIndex() */
+Array2<complex_t> reference_phases(const Bispectrum<bispec_complex_t>& bispectrum, PhaseMap& pm)
+{
+    pm = PhaseMap(c_size, c_size);
+    Array2<complex_t> phases(c_size, c_size);
+    for (const DimVector<int, 2>& indices : { DimVector<int, 2> { 0, 0 }, { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } }) {
+        phases.at(indices) = complex_t { 1., 0. };
+        pm.set(indices, { true, 1.0 });
+    }
+    double r { 0. };
+    double phi { 0. };
+    DimVector<int, 2> w { 0, 0 };
+    while (r <= c_radius) {
+        NextRecoIndex(r, phi, w[0], w[1]);
+        if (pm.range().contains(w) && !pm.flag(w)) {
+            calc_phase(bispectrum, phases, pm, w);
+        }
+    }
+    return phases;
+}
+
+/*! reference shell by shell reconstruction: each target of a shell sees only the phases known at the shell start */
+Array2<complex_t> reference_shell_phases(const Bispectrum<bispec_complex_t>& bispectrum, PhaseMap& pm)
+{
+    pm = PhaseMap(c_size, c_size);
+    Array2<complex_t> phases(c_size, c_size);
+    for (const DimVector<int, 2>& indices : { DimVector<int, 2> { 0, 0 }, { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } }) {
+        phases.at(indices) = complex_t { 1., 0. };
+        pm.set(indices, { true, 1.0 });
+    }
+    double r { 0. };
+    double phi { 0. };
+    DimVector<int, 2> w { 0, 0 };
+    std::vector<DimVector<int, 2>> shell {};
+    auto reconstruct_shell = [&]() {
+        const PhaseMap shell_pm { pm };
+        const Array2<complex_t> shell_phases { phases };
+        for (const auto& target : shell) {
+            PhaseMap target_pm { shell_pm };
+            Array2<complex_t> target_phases { shell_phases };
+            calc_phase(bispectrum, target_phases, target_pm, target);
+            pm.set(target, target_pm.at(target));
+            phases.at(target) = target_phases.at(target);
+        }
+        shell.clear();
+    };
+    while (r <= c_radius) {
+        const double shell_radius { r };
+        NextRecoIndex(r, phi, w[0], w[1]);
+        if (r != shell_radius) {
+            reconstruct_shell();
+        }
+        if (pm.range().contains(w) && !pm.flag(w)) {
+            shell.push_back(w);
+        }
+    }
+    reconstruct_shell();
+    return phases;
+}
+
+/*! bispectrum of \e nframes frames of an object with fixed phases up to \e radius and random phases beyond */
+Bispectrum<bispec_complex_t> seeing_limited_bispectrum(double radius, std::size_t nframes)
+{
+    std::mt19937 gen(815);
+    std::uniform_real_distribution<double> distrib(-constants::pi<double>, constants::pi<double>);
+    Array2<complex_t> object(c_size, c_size, complex_t {});
+    for (auto& val : object) {
+        val = std::polar(1., distrib(gen));
+    }
+    Bispectrum<bispec_complex_t> bispectrum({ c_size, c_size, c_depth, c_depth });
+    for (std::size_t frame { 0 }; frame < nframes; ++frame) {
+        Array2<complex_t> spectrum(c_size, c_size, complex_t {});
+        for (int y { spectrum.min_sindices()[1] }; y <= spectrum.max_sindices()[1]; ++y) {
+            for (int x { spectrum.min_sindices()[0] }; x <= spectrum.max_sindices()[0]; ++x) {
+                if (spectrum.at({ x, y }) != complex_t {}) {
+                    continue;
+                }
+                const bool resolved { std::sqrt(static_cast<double>(x * x + y * y)) <= radius };
+                spectrum.at({ x, y }) = resolved ? object.at({ x, y }) : std::polar(1., distrib(gen));
+                if (spectrum.range().contains({ -x, -y })) {
+                    spectrum.at({ -x, -y }) = std::conj(spectrum.at({ x, y }));
+                }
+            }
+        }
+        bispectrum.accumulate_from_fft(spectrum);
+    }
+    return bispectrum;
+}
+} // namespace
+
+TEST(ReconstructionPlanTest, MatchesCalcPhase)
+{
+    TEST_CASE("Planned Reconstruction vs. calc_phase");
+    const auto bispectrum { random_bispectrum(4711) };
+    PhaseMap ref_pm;
+    const auto ref_phases { reference_phases(bispectrum, ref_pm) };
+
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    TEST_EQUAL(plan.matches(bispectrum.dimsizes(), c_size, c_size, c_radius), true);
+    TEST_EQUAL(plan.matches(bispectrum.dimsizes(), c_size, c_size, c_radius + 1.), false);
+    PhaseMap pm;
+    const auto phases { reconstruct_phases<complex_t, bispec_complex_t>(bispectrum, plan, &pm) };
+    TEST_EQUAL(std::equal(phases.begin(), phases.end(), ref_phases.begin()), true);
+    TEST_EQUAL(pm == ref_pm, true);
+
+    // a plan of different bispectrum extents must be rejected
+    const ReconstructionPlan other_plan(Bispectrum<bispec_complex_t>({ c_size, c_size, c_depth - 2, c_depth - 2 }), c_size, c_size, c_radius);
+    bool thrown { false };
+    try {
+        static_cast<void>(reconstruct_phases<complex_t, bispec_complex_t>(bispectrum, other_plan));
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    TEST_EQUAL(thrown, true);
+}
+
+TEST(ReconstructionPlanTest, ShellParallel)
+{
+    TEST_CASE("Shell by Shell Reconstruction");
+    const auto bispectrum { random_bispectrum(4711) };
+    PhaseMap ref_pm;
+    const auto ref_phases { reference_shell_phases(bispectrum, ref_pm) };
+
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    for (const unsigned int nthreads : { 1u, 2u, 5u }) {
+        PhaseMap pm;
+        const auto phases { reconstruct_phases_by_shell<complex_t, bispec_complex_t>(bispectrum, plan, nthreads, &pm) };
+        TEST_EQUAL(std::equal(phases.begin(), phases.end(), ref_phases.begin()), true);
+        TEST_EQUAL(pm == ref_pm, true);
+    }
+}
+
+TEST(ReconstructionPlanTest, CappedPairs)
+{
+    TEST_CASE("Reconstruction from the Highest Weighted Pairs");
+    const auto bispectrum { random_bispectrum(4711) };
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    PhaseMap ref_pm;
+    const auto ref_phases { reconstruct_phases<complex_t, bispec_complex_t>(bispectrum, plan, &ref_pm) };
+    PhaseMap ref_shell_pm;
+    const auto ref_shell_phases { reconstruct_phases_by_shell<complex_t, bispec_complex_t>(bispectrum, plan, 2, &ref_shell_pm) };
+
+    // a cap above the largest number of pairs leaves the reconstruction unchanged
+    PhaseMap pm;
+    auto phases { reconstruct_phases<complex_t, bispec_complex_t>(bispectrum, plan, &pm, plan.max_npairs()) };
+    TEST_EQUAL(std::equal(phases.begin(), phases.end(), ref_phases.begin()), true);
+    TEST_EQUAL(pm == ref_pm, true);
+    phases = reconstruct_phases_by_shell<complex_t, bispec_complex_t>(bispectrum, plan, 3, &pm, plan.max_npairs());
+    TEST_EQUAL(std::equal(phases.begin(), phases.end(), ref_shell_phases.begin()), true);
+    TEST_EQUAL(pm == ref_shell_pm, true);
+
+    // a single pair per target: the same frequencies are reconstructed, each from one unit phasor
+    phases = reconstruct_phases<complex_t, bispec_complex_t>(bispectrum, plan, &pm, 1);
+    TEST_EQUAL(pm.same_flags(ref_pm), true);
+    TEST_EQUAL(std::equal(phases.begin(), phases.end(), ref_phases.begin()), false);
+    TEST_NEAR(pm.at({ 3, 4 }).consistency, 1., 1e-9);
+    PhaseMap shell_pm;
+    const auto shell_phases { reconstruct_phases_by_shell<complex_t, bispec_complex_t>(bispectrum, plan, 3, &shell_pm, 1) };
+    TEST_EQUAL(shell_pm.same_flags(ref_shell_pm), true);
+    TEST_NEAR(shell_pm.at({ 3, 4 }).consistency, 1., 1e-9);
+}
+
+TEST(ReconstructionPlanTest, AdaptiveRadius)
+{
+    TEST_CASE("Adaptive Reconstruction Radius");
+    const auto bispectrum { seeing_limited_bispectrum(5., 32) };
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    PhaseMap ref_pm;
+    const auto ref_phases { reconstruct_phases<complex_t, bispec_complex_t>(bispectrum, plan, &ref_pm) };
+
+    // without collapse the reconstruction is complete
+    AdaptiveRadius adaptive { 0., 3 };
+    PhaseMap pm;
+    auto phases { reconstruct_phases<complex_t, bispec_complex_t>(bispectrum, plan, &pm, 0, &adaptive) };
+    TEST_EQUAL(std::equal(phases.begin(), phases.end(), ref_phases.begin()), true);
+    TEST_EQUAL(pm == ref_pm, true);
+    TEST_EQUAL(adaptive.radius, plan.reco_radius());
+
+    // the consistency collapses beyond the resolved frequencies
+    adaptive = { 0.5, 2 };
+    phases = reconstruct_phases<complex_t, bispec_complex_t>(bispectrum, plan, &pm, 0, &adaptive);
+    TEST_EQUAL(adaptive.radius >= 5. && adaptive.radius < c_radius - 2., true);
+    TEST_EQUAL(pm.at({ 2, 2 }).flag, true);
+    TEST_EQUAL(phases.at({ 2, 2 }), ref_phases.at({ 2, 2 }));
+    // only the collapsed shells up to the termination are reconstructed beyond the radius
+    auto max_radius = [](const PhaseMap& phasemap) {
+        double radius { 0. };
+        for (int y { phasemap.min_sindices()[1] }; y <= phasemap.max_sindices()[1]; ++y) {
+            for (int x { phasemap.min_sindices()[0] }; x <= phasemap.max_sindices()[0]; ++x) {
+                if (phasemap.at({ x, y }).flag) {
+                    radius = std::max(radius, std::sqrt(static_cast<double>(x * x + y * y)));
+                }
+            }
+        }
+        return radius;
+    };
+    TEST_EQUAL(max_radius(pm) < adaptive.radius + 3., true);
+    TEST_EQUAL(max_radius(pm) < max_radius(ref_pm), true);
+    AdaptiveRadius shell_adaptive { 0.5, 2 };
+    PhaseMap shell_pm;
+    static_cast<void>(reconstruct_phases_by_shell<complex_t, bispec_complex_t>(bispectrum, plan, 1, &shell_pm, 0, &shell_adaptive));
+    TEST_EQUAL(shell_adaptive.radius >= 5. && shell_adaptive.radius < c_radius - 2., true);
+    TEST_EQUAL(shell_pm.at({ 2, 2 }).flag, true);
+    TEST_EQUAL(max_radius(shell_pm) < shell_adaptive.radius + 3., true);
+    AdaptiveRadius threaded_adaptive { 0.5, 2 };
+    PhaseMap threaded_pm;
+    static_cast<void>(reconstruct_phases_by_shell<complex_t, bispec_complex_t>(bispectrum, plan, 3, &threaded_pm, 0, &threaded_adaptive));
+    TEST_EQUAL(threaded_adaptive.radius, shell_adaptive.radius);
+    TEST_EQUAL(threaded_pm == shell_pm, true);
+}
+
+TEST(ReconstructionPlanTest, SinglePrecision)
+{
+    TEST_CASE("Single Precision Reconstruction");
+    const auto bispectrum { seeing_limited_bispectrum(2. * c_radius, 1) };
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    auto max_difference = [](const Array2<complex_t>& a, const Array2<std::complex<float>>& b) {
+        double difference { 0. };
+        for (std::size_t i { 0 }; i < a.size(); ++i) {
+            difference = std::max(difference, std::abs(a.data()[i] - complex_t { b.data()[i] }));
+        }
+        return difference;
+    };
+    PhaseMap pm;
+    const auto phases { reconstruct_phases<complex_t, bispec_complex_t>(bispectrum, plan, &pm) };
+    PhaseMap single_pm;
+    const auto single_phases { reconstruct_phases<std::complex<float>, bispec_complex_t>(bispectrum, plan, &single_pm) };
+    TEST_EQUAL(single_pm.same_flags(pm), true);
+    TEST_NEAR(max_difference(phases, single_phases), 0., 1e-5);
+    TEST_NEAR(single_pm.at({ 3, 4 }).consistency, pm.at({ 3, 4 }).consistency, 1e-5);
+
+    const auto shell_phases { reconstruct_phases_by_shell<complex_t, bispec_complex_t>(bispectrum, plan, 2, &pm) };
+    const auto single_shell_phases { reconstruct_phases_by_shell<std::complex<float>, bispec_complex_t>(bispectrum, plan, 2, &single_pm) };
+    TEST_EQUAL(single_pm.same_flags(pm), true);
+    TEST_NEAR(max_difference(shell_phases, single_shell_phases), 0., 1e-5);
+}
+
+TEST(ReconstructionPlanTest, FileCache)
+{
+    TEST_CASE("ReconstructionPlan File Cache");
+    const auto bispectrum { random_bispectrum(4711) };
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    const std::string filename { (std::filesystem::temp_directory_path() / "smip_reconstruction_plan_test.bin").string() };
+    plan.write_to_file(filename);
+
+    ReconstructionPlan cached {};
+    cached.read_from_file(filename);
+    TEST_EQUAL(cached.matches(bispectrum.dimsizes(), c_size, c_size, c_radius), true);
+    TEST_EQUAL(cached.visit_order() == plan.visit_order(), true);
+    TEST_EQUAL(cached.targets().size(), plan.targets().size());
+    TEST_EQUAL(cached.pairs().size(), plan.pairs().size());
+    TEST_EQUAL(std::equal(cached.targets().begin(), cached.targets().end(), plan.targets().begin(),
+                   [](const auto& a, const auto& b) { return a.phase_offset == b.phase_offset && a.npairs == b.npairs && a.first_pair == b.first_pair; }),
+        true);
+    TEST_EQUAL(std::equal(cached.pairs().begin(), cached.pairs().end(), plan.pairs().begin(),
+                   [](const auto& a, const auto& b) { return a.u_offset == b.u_offset && a.v_offset == b.v_offset; }),
+        true);
+    TEST_EQUAL(std::equal(cached.locations().begin(), cached.locations().end(), plan.locations().begin(),
+                   [](const auto& a, const auto& b) { return a.offset == b.offset && a.conjugate == b.conjugate; }),
+        true);
+    TEST_EQUAL(std::any_of(plan.locations().begin(), plan.locations().end(), [](const auto& location) { return location.conjugate != 0; }), true);
+    TEST_EQUAL(cached.shell_offsets() == plan.shell_offsets(), true);
+    const auto phases { reconstruct_phases<complex_t, bispec_complex_t>(bispectrum, plan) };
+    const auto cached_phases { reconstruct_phases<complex_t, bispec_complex_t>(bispectrum, cached) };
+    TEST_EQUAL(std::equal(phases.begin(), phases.end(), cached_phases.begin()), true);
+
+    // a truncated file must be rejected
+    std::filesystem::resize_file(filename, std::filesystem::file_size(filename) / 2);
+    bool thrown { false };
+    try {
+        cached.read_from_file(filename);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    TEST_EQUAL(thrown, true);
+    std::filesystem::remove(filename);
+}
+
+int reconstruction_plan_test(int /*argc*/, char* /*argv*/[])
+{
+    RUN_TEST(ReconstructionPlanTest, MatchesCalcPhase);
+    RUN_TEST(ReconstructionPlanTest, ShellParallel);
+    RUN_TEST(ReconstructionPlanTest, CappedPairs);
+    RUN_TEST(ReconstructionPlanTest, AdaptiveRadius);
+    RUN_TEST(ReconstructionPlanTest, SinglePrecision);
+    RUN_TEST(ReconstructionPlanTest, FileCache);
+
+    Test::summary();
+    return 0;
+}
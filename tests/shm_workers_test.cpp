@@ -0,0 +1,87 @@
+#include "array2.h"
+#include "fft_plans.h"
+#include "frame_accumulator.h"
+#include "log.h"
+#include "shm_workers.h"
+#include "test_fixtures.h"
+#include "test_macros.h"
+#include "testconfig.h"
+#include "types.h"
+#include "videoio.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <numeric>
+#include <string>
+
+using namespace smip;
+
+namespace {
+const std::string c_filename { smip::test::datafile };
+constexpr std::size_t c_depth { 4 };
+} // namespace
+
+#ifndef _WIN32
+TEST(ShmWorkersTest, ForkedAccumulation)
+{
+    TEST_CASE("Accumulation in Forked Worker Processes");
+    FrameExtractor fe(c_filename);
+    const std::size_t nframes { fe.nframes() };
+    const auto ref { Mat2Array<double>(fe.extract_next_frame(), color_channel_t::white) };
+
+    FrameAccumulator local(ref, c_depth);
+    local.add_frame(ref);
+    TEST_EQUAL(accumulate_frames(fe, color_channel_t::white, 1, nframes - 1, local), nframes - 1);
+
+    FrameAccumulator forked(ref, c_depth);
+    forked.add_frame(ref);
+    TEST_EQUAL(accumulate_frames_forked(c_filename, color_channel_t::white, ref, 1, nframes - 1, 3, forked), nframes - 1);
+    TEST_EQUAL(forked.nframes(), local.nframes());
+    TEST_NEAR(test::max_difference(forked.sum_image(), local.sum_image()), 0., 1e-9);
+    TEST_NEAR(test::max_difference(forked.powerspectrum(), local.powerspectrum()) / *std::max_element(local.powerspectrum().begin(), local.powerspectrum().end()), 0., 1e-12);
+    const double bs_scale { std::accumulate(local.bispectrum().begin(), local.bispectrum().end(), 0.,
+        [](double a, const bispec_complex_t& b) { return std::max(a, static_cast<double>(std::abs(b))); }) };
+    TEST_NEAR(test::max_difference(forked.bispectrum(), local.bispectrum()) / bs_scale, 0., 1e-6);
+}
+
+TEST(ShmWorkersTest, ThreadedParent)
+{
+    TEST_CASE("Forked Accumulation after Multi-threaded Transforms");
+    FftPlanRegistry& registry { FftPlanRegistry::instance() };
+    const std::size_t max_threads { registry.max_threads() };
+    const auto crossovers { registry.thread_crossovers() };
+    // all transforms of the parent run multi-threaded, as with the -T option of the cli
+    registry.set_max_threads(4);
+    registry.set_thread_crossovers({ { 0, 4 } });
+    FrameExtractor fe(c_filename);
+    const std::size_t nframes { fe.nframes() };
+    const auto ref { Mat2Array<double>(fe.extract_next_frame(), color_channel_t::white) };
+
+    FrameAccumulator local(ref, c_depth);
+    local.add_frame(ref);
+    TEST_EQUAL(accumulate_frames(fe, color_channel_t::white, 1, nframes - 1, local), nframes - 1);
+
+    // the workers must not execute the multi-threaded plans inherited from the parent
+    FrameAccumulator forked(ref, c_depth);
+    forked.add_frame(ref);
+    TEST_EQUAL(accumulate_frames_forked(c_filename, color_channel_t::white, ref, 1, nframes - 1, 3, forked), nframes - 1);
+    TEST_EQUAL(registry.max_threads(), 4u);
+    TEST_NEAR(test::max_difference(forked.sum_image(), local.sum_image()), 0., 1e-9);
+    TEST_NEAR(test::max_difference(forked.powerspectrum(), local.powerspectrum()) / *std::max_element(local.powerspectrum().begin(), local.powerspectrum().end()), 0., 1e-12);
+    registry.set_max_threads(max_threads);
+    registry.set_thread_crossovers(crossovers);
+}
+#endif
+
+int shm_workers_test(int /*argc*/, char* /*argv*/[])
+{
+    log::system::setup(log::Level::Warning, [](int) {}, std::cerr);
+#ifndef _WIN32
+    RUN_TEST(ShmWorkersTest, ForkedAccumulation);
+    RUN_TEST(ShmWorkersTest, ThreadedParent);
+#endif
+
+    Test::summary();
+    return 0;
+}
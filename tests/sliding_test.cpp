@@ -0,0 +1,108 @@
+#include "array2.h"
+#include "bispectrum.h"
+#include "sliding_bispectrum.h"
+#include "test_macros.h"
+#include "types.h"
+#include <algorithm>
+#include <complex>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace smip;
+
+namespace {
+/*! random hermitian spectra, i.e. spectra of real frames */
+std::vector<Array2<bispec_complex_t>> random_spectra(std::size_t n, std::size_t xsize, std::size_t ysize)
+{
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> distrib(-1.f, 1.f);
+    std::vector<Array2<bispec_complex_t>> spectra {};
+    for (std::size_t i { 0 }; i < n; ++i) {
+        Array2<bispec_complex_t> fft(xsize, ysize);
+        for (auto& val : fft) {
+            val = bispec_complex_t { distrib(gen), distrib(gen) };
+        }
+        Array2<bispec_complex_t> hermitian(xsize, ysize);
+        for (std::size_t y { 0 }; y < ysize; ++y) {
+            for (std::size_t x { 0 }; x < xsize; ++x) {
+                hermitian(x, y) = 0.5f * (fft(x, y) + std::conj(fft((xsize - x) % xsize, (ysize - y) % ysize)));
+            }
+        }
+        spectra.push_back(hermitian);
+    }
+    return spectra;
+}
+} // namespace
+
+TEST(SlidingBispectrumTest, WindowCompletion)
+{
+    TEST_CASE("SlidingBispectrum Window Completion");
+    constexpr std::size_t window { 4 };
+    constexpr std::size_t step { 3 };
+    const auto spectra { random_spectra(12, 8, 8) };
+    SlidingBispectrum<bispec_complex_t> sliding({ 8, 8, 4, 4 }, window, step);
+    std::vector<std::size_t> completed {};
+    for (const auto& fft : spectra) {
+        sliding.add_frame(fft);
+        if (sliding.window_complete()) {
+            completed.push_back(sliding.first_frame());
+        }
+    }
+    TEST_EQUAL(sliding.nframes(), window);
+    TEST_EQUAL(sliding.frames_total(), spectra.size());
+    TEST_EQUAL(completed.size(), 3);
+    TEST_EQUAL(completed[0], 0);
+    TEST_EQUAL(completed[1], 3);
+    TEST_EQUAL(completed[2], 6);
+}
+
+TEST(SlidingBispectrumTest, MatchesWindowAccumulation)
+{
+    TEST_CASE("SlidingBispectrum vs. Accumulation of Window");
+    constexpr std::size_t window { 5 };
+    const Bispectrum<bispec_complex_t>::extents dims { 8, 8, 4, 4 };
+    const auto spectra { random_spectra(17, 8, 8) };
+    SlidingBispectrum<bispec_complex_t> sliding(dims, window, 1);
+    for (const auto& fft : spectra) {
+        sliding.add_frame(fft);
+    }
+
+    Bispectrum<bispec_complex_t> reference(dims);
+    // the power spectrum is the half-plane x <= xsize/2 of the full power spectrum
+    Array2<double> ref_powerspec(8 / 2 + 1, 8, 0.);
+    for (std::size_t i { spectra.size() - window }; i < spectra.size(); ++i) {
+        reference.accumulate_from_fft(spectra[i]);
+        for (std::size_t y { 0 }; y < ref_powerspec.nrows(); ++y) {
+            for (std::size_t x { 0 }; x < ref_powerspec.ncols(); ++x) {
+                ref_powerspec(x, y) += std::norm(spectra[i](x, y));
+            }
+        }
+    }
+    reference /= bispec_complex_t(window, 0.);
+    ref_powerspec /= static_cast<double>(window * 8 * 8);
+
+    const auto bs { sliding.bispectrum() };
+    const auto ps { sliding.powerspectrum() };
+    TEST_EQUAL(bs.size(), reference.size());
+    TEST_EQUAL(ps.ncols(), ref_powerspec.ncols());
+    TEST_EQUAL(ps.nrows(), ref_powerspec.nrows());
+    double max_diff { 0. };
+    for (std::size_t i { 0 }; i < bs.size(); ++i) {
+        max_diff = std::max(max_diff, static_cast<double>(std::abs(bs[i] - reference[i])));
+    }
+    TEST_NEAR(max_diff, 0., 1e-4);
+    max_diff = std::inner_product(ps.begin(), ps.end(), ref_powerspec.begin(), 0.,
+        [](double a, double b) { return std::max(a, b); },
+        [](double a, double b) { return std::abs(a - b); });
+    TEST_NEAR(max_diff, 0., 1e-9);
+}
+
+int sliding_test(int /*argc*/, char* /*argv*/[])
+{
+    RUN_TEST(SlidingBispectrumTest, WindowCompletion);
+    RUN_TEST(SlidingBispectrumTest, MatchesWindowAccumulation);
+
+    Test::summary();
+    return 0;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "array2.h"
+#include "bispectrum.h"
+#include "constants.h"
+#include "math_functions.h"
+#include "phasemap.h"
+#include "types.h"
+
+/*! synthetic spectra, bispectra and comparisons shared by the tests */
+namespace smip::test {
+
+/*! frame size, bispectrum depth and reconstruction radius of the phase reconstruction tests */
+constexpr std::size_t c_size { 24 };
+constexpr std::size_t c_depth { 6 };
+constexpr double c_radius { 10. };
+
+/*! hermitian object spectrum of \e size x \e size with random phases (generator seed \e seed),
+ * zero at the start values of the reconstruction
+ */
+inline Array2<complex_t> object_spectrum(unsigned int seed, std::size_t size = c_size)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> phase(-constants::pi<double>, constants::pi<double>);
+    std::uniform_real_distribution<double> modulus(0.5, 2.);
+    Array2<complex_t> spectrum(size, size, complex_t {});
+    for (int y { spectrum.min_sindices()[1] }; y <= spectrum.max_sindices()[1]; ++y) {
+        for (int x { spectrum.min_sindices()[0] }; x <= spectrum.max_sindices()[0]; ++x) {
+            if (spectrum.at({ x, y }) != complex_t {}) {
+                continue;
+            }
+            const bool start_value { std::abs(x) + std::abs(y) <= 1 };
+            spectrum.at({ x, y }) = std::polar(modulus(gen), start_value ? 0. : phase(gen));
+            spectrum.at({ -x, -y }) = std::conj(spectrum.at({ x, y }));
+        }
+    }
+    return spectrum;
+}
+
+/*! bispectrum of depth \e depth of \e spectrum, with the phase of each element disturbed by up to +-\e noise */
+inline Bispectrum<bispec_complex_t> object_bispectrum(const Array2<complex_t>& spectrum, double noise = 0., std::size_t depth = c_depth)
+{
+    Bispectrum<bispec_complex_t> bispectrum({ spectrum.ncols(), spectrum.nrows(), depth, depth });
+    bispectrum.accumulate_from_fft(spectrum);
+    if (noise > 0.) {
+        std::mt19937 gen(99);
+        std::uniform_real_distribution<float> distrib(static_cast<float>(-noise), static_cast<float>(noise));
+        for (auto& element : bispectrum) {
+            element *= std::polar(1.f, distrib(gen));
+        }
+    }
+    return bispectrum;
+}
+
+/*! c_size x c_size bispectrum of depth c_depth with uniformly distributed random elements (generator seed \e seed) */
+inline Bispectrum<bispec_complex_t> random_bispectrum(unsigned int seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> distrib(-1.f, 1.f);
+    Bispectrum<bispec_complex_t> bispectrum({ c_size, c_size, c_depth, c_depth });
+    for (auto& val : bispectrum) {
+        val = bispec_complex_t { distrib(gen), distrib(gen) };
+    }
+    return bispectrum;
+}
+
+/*! \e n frames of \e xsize x \e ysize with uniformly distributed random pixel values in [0, 255) (generator seed \e seed) */
+inline std::vector<Array2<double>> random_frames(std::size_t n, std::size_t xsize, std::size_t ysize, unsigned int seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> distrib(0., 255.);
+    std::vector<Array2<double>> frames {};
+    for (std::size_t i { 0 }; i < n; ++i) {
+        Array2<double> frame(xsize, ysize);
+        for (auto& val : frame) {
+            val = distrib(gen);
+        }
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+/*! add a gaussian spot of width \e sigma and peak \e amplitude centered at (\e cx, \e cy) to \e frame */
+inline void add_gaussian_spot(Array2<double>& frame, double cx, double cy, double sigma, double amplitude = 1.)
+{
+    for (std::size_t y { 0 }; y < frame.nrows(); ++y) {
+        for (std::size_t x { 0 }; x < frame.ncols(); ++x) {
+            frame(x, y) += amplitude * std::exp(-(sqr(x - cx) + sqr(y - cy)) / (2. * sqr(sigma)));
+        }
+    }
+}
+
+/*! \e xsize x \e ysize frame with a single gaussian spot, see add_gaussian_spot() */
+inline Array2<double> gaussian_frame(std::size_t xsize, std::size_t ysize, double cx, double cy, double sigma, double amplitude = 1.)
+{
+    Array2<double> frame(xsize, ysize, 0.);
+    add_gaussian_spot(frame, cx, cy, sigma, amplitude);
+    return frame;
+}
+
+/*! \e xsize x \e ysize frame with a bright object of width 8 at (\e cx, \e cy) and 40 fainter spots of random
+ * position, amplitude and width (generator seed \e seed)
+ */
+inline Array2<double> spotted_frame(std::size_t xsize, std::size_t ysize, double cx, double cy, unsigned int seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> xpos(0., static_cast<double>(xsize));
+    std::uniform_real_distribution<double> ypos(0., static_cast<double>(ysize));
+    std::uniform_real_distribution<double> amplitude(10., 60.);
+    std::uniform_real_distribution<double> width(1.5, 6.);
+    Array2<double> frame(xsize, ysize, 0.);
+    add_gaussian_spot(frame, cx, cy, 8., 255.);
+    for (int i { 0 }; i < 40; ++i) {
+        const double x { xpos(gen) };
+        const double y { ypos(gen) };
+        const double amp { amplitude(gen) };
+        add_gaussian_spot(frame, x, y, width(gen), amp);
+    }
+    return frame;
+}
+
+/*! maximum absolute difference of the elements of \e a and \e b */
+template <typename Container>
+double max_difference(const Container& a, const Container& b)
+{
+    return std::inner_product(a.begin(), a.end(), b.begin(), 0.,
+        [](double x, double y) { return std::max(x, y); },
+        [](const auto& x, const auto& y) { return static_cast<double>(std::abs(x - y)); });
+}
+
+/*! maximum deviation of the \e phases flagged in \e pm from the phasors of \e reference */
+inline double max_phase_error(const Array2<complex_t>& phases, const Array2<complex_t>& reference, const PhaseMap& pm)
+{
+    double max_error { 0. };
+    for (std::size_t i { 0 }; i < phases.size(); ++i) {
+        if (pm.flag(i)) {
+            const complex_t& value { reference.data()[i] };
+            const complex_t expected { (std::abs(value) > 0.) ? value / std::abs(value) : value };
+            max_error = std::max(max_error, std::abs(phases.data()[i] - expected));
+        }
+    }
+    return max_error;
+}
+
+} // namespace smip::test
@@ -0,0 +1,160 @@
+#include "array2.h"
+#include "bispectrum.h"
+#include "constants.h"
+#include "phasemap.h"
+#include "phasereco.h"
+#include "reconstruction_plan.h"
+#include "test_fixtures.h"
+#include "test_macros.h"
+#include "types.h"
+#include "unit_phase_bispectrum.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+
+using namespace smip;
+using namespace smip::test;
+
+namespace {
+/*! phases of an object with hermitian spectrum, zero at the start values of the reconstruction */
+Array2<double> random_object_phases()
+{
+    std::mt19937 gen(815);
+    std::uniform_real_distribution<double> distrib(-constants::pi<double>, constants::pi<double>);
+    Array2<double> phi(c_size, c_size, 0.);
+    const int half { static_cast<int>(c_size) / 2 };
+    for (int y { -half + 1 }; y < half; ++y) {
+        for (int x { 0 }; x < half; ++x) {
+            if ((x == 0 && y <= 0) || std::abs(x) + std::abs(y) <= 1) {
+                continue;
+            }
+            phi.at({ x, y }) = distrib(gen);
+            phi.at({ -x, -y }) = -phi.at({ x, y });
+        }
+    }
+    return phi;
+}
+
+/*! bispectrum of the object phases \e phi with random moduli, some elements below the threshold */
+Bispectrum<bispec_complex_t> phase_bispectrum(const Array2<double>& phi)
+{
+    std::mt19937 gen(4711);
+    std::uniform_real_distribution<double> distrib(0., 2.);
+    Bispectrum<bispec_complex_t> bispectrum({ c_size, c_size, c_depth, c_depth });
+    const auto low { bispectrum.min_indices() };
+    const auto high { bispectrum.max_indices() };
+    Bispectrum<bispec_complex_t>::s_indices uv {};
+    for (uv[3] = low[3]; uv[3] <= high[3]; ++uv[3]) {
+        for (uv[2] = low[2]; uv[2] <= high[2]; ++uv[2]) {
+            for (uv[1] = low[1]; uv[1] <= high[1]; ++uv[1]) {
+                for (uv[0] = low[0]; uv[0] <= high[0]; ++uv[0]) {
+                    const DimVector<int, 2> u { uv[0], uv[1] };
+                    const DimVector<int, 2> v { uv[2], uv[3] };
+                    // the sum frequency must not wrap around, elements only reachable that way stay zero
+                    if (!phi.range().contains(u + v)) {
+                        continue;
+                    }
+                    const auto location { bispectrum.find_element(uv) };
+                    if (!location) {
+                        continue;
+                    }
+                    const double modulus { distrib(gen) };
+                    auto value { std::polar(modulus < 0.1 ? 0. : modulus, phi.at(u) + phi.at(v) - phi.at(u + v)) };
+                    bispectrum.data()[location->offset] = static_cast<bispec_complex_t>(location->conjugate ? std::conj(value) : value);
+                }
+            }
+        }
+    }
+    return bispectrum;
+}
+
+} // namespace
+
+TEST(UnitPhaseBispectrumTest, Encoding)
+{
+    TEST_CASE("UnitPhaseBispectrum Phase Encoding");
+    for (const double angle : { -3.1, -1., 0., 0.5, 2., constants::pi<double> }) {
+        const complex_t phasor { std::polar(1., angle) };
+        TEST_NEAR(std::abs(UnitPhaseBispectrum<bispec_complex_t>::decode(UnitPhaseBispectrum<bispec_complex_t>::encode(phasor)) - phasor), 0., 1e-6);
+        TEST_NEAR(std::abs(UnitPhaseBispectrum<float>::decode(UnitPhaseBispectrum<float>::encode(phasor)) - phasor), 0., 1e-6);
+        TEST_NEAR(std::abs(UnitPhaseBispectrum<std::uint16_t>::decode(UnitPhaseBispectrum<std::uint16_t>::encode(phasor)) - phasor), 0., 1e-4);
+    }
+    TEST_EQUAL(UnitPhaseBispectrum<bispec_complex_t>::decode(UnitPhaseBispectrum<bispec_complex_t>::encode({})), complex_t {});
+    TEST_EQUAL(UnitPhaseBispectrum<float>::decode(UnitPhaseBispectrum<float>::encode({})), complex_t {});
+    TEST_EQUAL(UnitPhaseBispectrum<std::uint16_t>::decode(UnitPhaseBispectrum<std::uint16_t>::encode({})), complex_t {});
+    // the invalid marker of the float store is an ordinary value, so that it is detected with -ffast-math as well
+    const float invalid_angle { UnitPhaseBispectrum<float>::encode({}) };
+    TEST_EQUAL(invalid_angle == invalid_angle, true);
+    TEST_EQUAL(invalid_angle > constants::pi<float>, true);
+    TEST_EQUAL(UnitPhaseBispectrum<float>::decode(static_cast<float>(constants::pi<double>)) != complex_t {}, true);
+}
+
+TEST(UnitPhaseBispectrumTest, Elements)
+{
+    TEST_CASE("UnitPhaseBispectrum Elements");
+    const auto bispectrum { phase_bispectrum(random_object_phases()) };
+    const UnitPhaseBispectrum<float> unit_phases(bispectrum, 3);
+    TEST_EQUAL(unit_phases.size(), bispectrum.size());
+    TEST_EQUAL(unit_phases.memory_size() * 2, bispectrum.size() * sizeof(bispec_complex_t));
+    TEST_EQUAL(UnitPhaseBispectrum<std::uint16_t>(bispectrum).memory_size() * 4, bispectrum.size() * sizeof(bispec_complex_t));
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    std::vector<complex_t> gathered(plan.locations().size());
+    unit_phases.gather(plan.locations().data(), plan.locations().size(), gathered.data());
+    double max_error { 0. };
+    std::size_t ninvalid { 0 };
+    for (std::size_t i { 0 }; i < plan.locations().size(); ++i) {
+        complex_t expected { bispectrum.element_at(plan.locations()[i]) };
+        if (std::abs(expected) > constants::c_epsilon<double>) {
+            expected = std::conj(expected / std::abs(expected));
+        } else {
+            expected = {};
+            ninvalid++;
+        }
+        max_error = std::max(max_error, std::abs(gathered[i] - expected));
+        max_error = std::max(max_error, std::abs(unit_phases.element_at(plan.locations()[i]) - expected));
+    }
+    TEST_EQUAL(ninvalid > 0, true);
+    TEST_NEAR(max_error, 0., 1e-6);
+}
+
+TEST(UnitPhaseBispectrumTest, Reconstruction)
+{
+    TEST_CASE("Reconstruction from UnitPhaseBispectrum");
+    const auto bispectrum { phase_bispectrum(random_object_phases()) };
+    const ReconstructionPlan plan(bispectrum, c_size, c_size, c_radius);
+    PhaseMap ref_pm;
+    const auto ref_phases { reconstruct_phases<complex_t>(bispectrum, plan, &ref_pm) };
+    PhaseMap ref_shell_pm;
+    const auto ref_shell_phases { reconstruct_phases_by_shell<complex_t>(bispectrum, plan, 1, &ref_shell_pm) };
+
+    auto check = [&](const auto& unit_phases, double tolerance) {
+        PhaseMap pm;
+        const auto phases { reconstruct_phases<complex_t>(unit_phases, plan, &pm) };
+        TEST_EQUAL(pm.same_flags(ref_pm), true);
+        TEST_NEAR(max_phase_error(phases, ref_phases, pm), 0., tolerance);
+        PhaseMap shell_pm;
+        const auto shell_phases { reconstruct_phases_by_shell<complex_t>(unit_phases, plan, 2, &shell_pm) };
+        TEST_EQUAL(shell_pm.same_flags(ref_shell_pm), true);
+        TEST_NEAR(max_phase_error(shell_phases, ref_shell_phases, shell_pm), 0., tolerance);
+        // the closure phases of the object are consistent, so any selection of pairs yields the same phases
+        const auto capped_phases { reconstruct_phases<complex_t>(unit_phases, plan, &pm, 3) };
+        TEST_EQUAL(pm.same_flags(ref_pm), true);
+        TEST_NEAR(max_phase_error(capped_phases, ref_phases, pm), 0., tolerance);
+    };
+    check(UnitPhaseBispectrum<bispec_complex_t>(bispectrum), 1e-5);
+    check(UnitPhaseBispectrum<float>(bispectrum), 1e-5);
+    check(UnitPhaseBispectrum<std::uint16_t>(bispectrum), 1e-3);
+}
+
+int unit_phase_bispectrum_test(int /*argc*/, char* /*argv*/[])
+{
+    RUN_TEST(UnitPhaseBispectrumTest, Encoding);
+    RUN_TEST(UnitPhaseBispectrumTest, Elements);
+    RUN_TEST(UnitPhaseBispectrumTest, Reconstruction);
+
+    Test::summary();
+    return 0;
+}